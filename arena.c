@@ -0,0 +1,90 @@
+#include "nanocc.h"
+// スレッドから同時に更新するカウンター
+#include <stdatomic.h>
+
+// アリーナ (まとめて解放できるメモリー領域)
+// 大きな塊を確保しておき、その中でポインターを進めるだけで割り当てる。
+// 個々のオブジェクトは解放せず、arena_release でアリーナごと解放する
+
+// 塊の大きさ。最初は小さい塊から始めて、確保するたびに倍にしていく。
+// 小さな関数がたくさんあっても、関数ごとのアリーナが大きくなりすぎないようにする。
+// 最大の大きさより大きい割り当てには専用の塊を用意する
+#define ARENA_MIN_BLOCK_SIZE (4 * 1024)
+#define ARENA_BLOCK_SIZE (64 * 1024)
+
+// アリーナの塊
+struct ArenaBlock {
+  ArenaBlock *next; // 前に確保した塊
+  size_t size;      // data の大きさ
+  size_t used;      // data のうち割り当て済みの大きさ
+  char data[];
+};
+
+// 翻訳単位全体で使うアリーナ の定義
+Arena tu_arena;
+
+// いま割り当てに使うアリーナ の定義
+_Thread_local Arena *cur_arena = &tu_arena;
+
+// すべてのアリーナが確保している大きさの合計と、その最大値
+// 関数のアリーナは複数のスレッドから同時に確保されるので、アトミックに数える
+static _Atomic size_t total_reserved;
+static _Atomic size_t peak_reserved;
+
+// アリーナから size バイトの 0 で埋めた領域を割り当てる
+void *arena_alloc(Arena *arena, size_t size) {
+  // 8 バイト境界に揃える
+  size = (size + 7) & ~(size_t)7;
+  ArenaBlock *block = arena->head;
+  if (!block || block->size - block->used < size) {
+    // 塊が足りなければ新しく確保する。calloc なので中身は 0 になっている
+    size_t block_size = arena->reserved;
+    if (block_size < ARENA_MIN_BLOCK_SIZE)
+      block_size = ARENA_MIN_BLOCK_SIZE;
+    if (block_size > ARENA_BLOCK_SIZE)
+      block_size = ARENA_BLOCK_SIZE;
+    if (block_size < size)
+      block_size = size;
+    block = calloc(1, sizeof(ArenaBlock) + block_size);
+    if (!block)
+      error("out of memory");
+    block->size = block_size;
+    block->next = arena->head;
+    arena->head = block;
+    arena->reserved += block_size;
+    size_t total = atomic_fetch_add(&total_reserved, block_size) + block_size;
+    size_t peak = atomic_load(&peak_reserved);
+    while (peak < total &&
+           !atomic_compare_exchange_weak(&peak_reserved, &peak, total))
+      ;
+  }
+  void *ptr = block->data + block->used;
+  block->used += size;
+  arena->used += size;
+  return ptr;
+}
+
+// アリーナの塊をすべて解放する。アリーナから割り当てた領域はすべて無効になる
+void arena_release(Arena *arena) {
+  ArenaBlock *block = arena->head;
+  while (block) {
+    ArenaBlock *next = block->next;
+    free(block);
+    block = next;
+  }
+  atomic_fetch_sub(&total_reserved, arena->reserved);
+  arena->head = NULL;
+  arena->reserved = 0;
+  arena->used = 0;
+}
+
+// アリーナの使用状況を標準エラー出力に表示する
+void print_arena_stats(char *name, Arena *arena) {
+  fprintf(stderr, "arena %-16s reserved %10zu bytes, used %10zu bytes\n",
+          name, arena->reserved, arena->used);
+}
+
+// すべてのアリーナが同時に確保していた大きさの最大値を表示する
+void print_arena_peak() {
+  fprintf(stderr, "arena peak reserved %zu bytes\n", atomic_load(&peak_reserved));
+}
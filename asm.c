@@ -0,0 +1,155 @@
+#include "nanocc.h"
+
+// 出力するアセンブリを、行の並びとしてためておく
+// コード生成は printf の代わりに println で1行ずつ足していき、ためた行は
+// ピープホール最適化 (peephole.c) をかけてから書き出す。
+// ピープホール最適化はラベルやディレクティブを越えないので、それらが来るたびに
+// そこまでを書き出す。ためておくのは基本ブロック1つの分で済む
+
+// 真なら、書き出す前にピープホール最適化をする
+bool use_peephole = true;
+
+// ためている行の並び。書き出した後も領域は使い回す
+static AsmLine *lines;
+static int num_lines;
+static int cap_lines;
+// ためている行の文字列を置くアリーナ。書き出すたびに解放する
+static Arena asm_arena;
+// 関数の中でピープホール最適化が取り除いた命令の数
+static int num_eliminated;
+
+// 文字列の前後の空白を除く。s は書き換える
+static char *trim(char *s) {
+  while (*s == ' ')
+    s++;
+  char *end = s + strlen(s);
+  while (end > s && end[-1] == ' ')
+    end--;
+  *end = '\0';
+  return s;
+}
+
+// 行の種類を決め、命令なら名前とオペランドに分ける
+// 行頭から書くのはラベルとディレクティブ、字下げした行は命令かディレクティブかコメント
+static void parse_line(AsmLine *line) {
+  char *text = line->text;
+  if (text[0] != ' ') {
+    line->kind = text[0] && text[strlen(text) - 1] == ':' ? ASM_LABEL : ASM_DIRECTIVE;
+    return;
+  }
+  char *p = text;
+  while (*p == ' ')
+    p++;
+  if (*p == '#') {
+    line->kind = ASM_COMMENT;
+    return;
+  }
+  if (*p == '.') {
+    line->kind = ASM_DIRECTIVE;
+    return;
+  }
+  line->kind = ASM_INST;
+
+  // 書き換えながら分けるので、写しを作る
+  char *s = arena_alloc(cur_arena, strlen(p) + 1);
+  strcpy(s, p);
+  char *comment = strchr(s, '#');
+  if (comment) {
+    *comment = '\0';
+    line->comment = trim(comment + 1);
+  }
+  char *args = strchr(s, ' ');
+  if (args)
+    *args++ = '\0';
+  line->op = s;
+  while (args && *(args = trim(args))) {
+    char *comma = strchr(args, ',');
+    if (comma)
+      *comma = '\0';
+    if (line->num_args == MAX_ASM_ARGS)
+      error("unreachable: parse_line: %s", text);
+    line->args[line->num_args++] = trim(args);
+    args = comma ? comma + 1 : NULL;
+  }
+}
+
+// 1行を書き出す。書き換えた命令は、分けたものから組み立てる
+static void print_line(AsmLine *line) {
+  if (line->text) {
+    puts(line->text);
+    return;
+  }
+  fputs("  ", stdout);
+  fputs(line->op, stdout);
+  for (int i = 0; i < line->num_args; i++) {
+    fputs(i ? ", " : " ", stdout);
+    fputs(line->args[i], stdout);
+  }
+  if (line->comment) {
+    fputs(" # ", stdout);
+    fputs(line->comment, stdout);
+  }
+  putchar('\n');
+}
+
+// ためている行を、ピープホール最適化をかけてから書き出して空にする
+static void flush_lines() {
+  if (use_peephole) {
+    // 分けたオペランドや書き換えた文字列も、行と一緒に解放する
+    Arena *arena = cur_arena;
+    cur_arena = &asm_arena;
+    for (int i = 0; i < num_lines; i++)
+      parse_line(&lines[i]);
+    optimize_peephole(lines, num_lines);
+    for (int i = 0; i < num_lines; i++)
+      if (lines[i].dead)
+        num_eliminated++;
+    cur_arena = arena;
+  }
+  for (int i = 0; i < num_lines; i++)
+    if (!lines[i].dead)
+      print_line(&lines[i]);
+  num_lines = 0;
+  arena_release(&asm_arena);
+}
+
+// アセンブリを1行ためる。fmt は printf と同じ書式で、末尾の改行はつけない
+// 行を分けるのは、ピープホール最適化をするときだけ
+void println(char *fmt, ...) {
+  // たいていの行は短いので、いったん手元に書いてから必要な分だけ割り当てる
+  char tmp[256];
+  va_list ap;
+  va_start(ap, fmt);
+  int len = vsnprintf(tmp, sizeof(tmp), fmt, ap);
+  va_end(ap);
+
+  // 行頭から書くラベルやディレクティブの前で、そこまでを書き出す
+  if (tmp[0] != ' ' && num_lines > 0)
+    flush_lines();
+
+  char *text = arena_alloc(&asm_arena, len + 1);
+  if (len < sizeof(tmp)) {
+    memcpy(text, tmp, len + 1);
+  } else {
+    va_start(ap, fmt);
+    vsnprintf(text, len + 1, fmt, ap);
+    va_end(ap);
+  }
+
+  if (num_lines == cap_lines) {
+    cap_lines = cap_lines ? cap_lines * 2 : 64;
+    lines = realloc(lines, sizeof(AsmLine) * cap_lines);
+    if (!lines)
+      error("out of memory");
+  }
+  lines[num_lines++] = (AsmLine){.text = text};
+}
+
+// 関数の残りの行を書き出す
+// 関数の中でピープホール最適化が取り除いた命令の数を返す
+int flush_asm() {
+  flush_lines();
+  int n = num_eliminated;
+  num_eliminated = 0;
+  return n;
+}
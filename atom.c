@@ -0,0 +1,129 @@
+#include "nanocc.h"
+
+// 識別子の表 (atom table)
+// 同じ綴りの名前には同じ番号 (atom) をつけるので、名前の比較は整数の比較で済む。
+// 名前の文字列は1か所にだけ置いておく
+//
+// 関数の本体をパーズする前に入力全体を一度トークナイズするので、本体を並行して
+// パーズするときには、名前はすべて登録済みになっている。登録済みの名前を引くときは
+// 表を書き換えないので、複数のスレッドから同時に intern を呼んでもよい
+//
+// パイプラインでは、字句解析のスレッドが名前を登録している間に、ほかのスレッドが
+// atom_name で名前を引く。登録した名前は動かさないように、名前は決まった大きさの
+// 塊に入れていき、塊の表も作り直さない
+
+// 登録された名前
+typedef struct {
+  char *str;     // 名前の文字列。'\0' で終わる
+  int len;       // 名前の長さ
+  uint32_t hash; // 名前のハッシュ値
+} Atom;
+
+// atom の番号で引く名前の表。ATOM_CHUNK_SIZE 個ずつの塊に分けて持つ
+#define ATOM_CHUNK_SIZE 1024
+#define MAX_ATOM_CHUNKS (64 * 1024)
+static Atom *atom_chunks[MAX_ATOM_CHUNKS];
+static int num_atoms;
+
+// 番号が atom の名前
+static Atom *get_atom(int atom) {
+  return &atom_chunks[atom / ATOM_CHUNK_SIZE][atom % ATOM_CHUNK_SIZE];
+}
+
+// 名前から atom を引くためのオープンアドレス法のハッシュ表
+// 各要素は atom の番号 + 1 で、0 なら空き
+static int *buckets;
+static int num_buckets;
+
+// 名前の文字列を置いておく領域。足りなくなったら新しい塊を確保する
+#define STR_CHUNK_SIZE (64 * 1024)
+static char *str_chunk;
+static int str_chunk_used = STR_CHUNK_SIZE;
+
+// FNV-1a ハッシュ
+static uint32_t hash_name(char *str, int len) {
+  uint32_t h = 2166136261u;
+  for (int i = 0; i < len; i++) {
+    h ^= (unsigned char)str[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+// 名前の文字列の置き場所に str から len 文字をコピーして返す
+static char *store_name(char *str, int len) {
+  if (STR_CHUNK_SIZE - str_chunk_used < len + 1) {
+    if (len + 1 > STR_CHUNK_SIZE / 4) {
+      // 長すぎる名前は専用の領域に置く
+      char *buf = malloc(len + 1);
+      memcpy(buf, str, len);
+      buf[len] = '\0';
+      return buf;
+    }
+    str_chunk = malloc(STR_CHUNK_SIZE);
+    str_chunk_used = 0;
+  }
+  char *buf = str_chunk + str_chunk_used;
+  memcpy(buf, str, len);
+  buf[len] = '\0';
+  str_chunk_used += len + 1;
+  return buf;
+}
+
+// ハッシュ表を倍の大きさにして作り直す
+static void grow_buckets() {
+  num_buckets = num_buckets ? num_buckets * 2 : 1024;
+  free(buckets);
+  buckets = calloc(num_buckets, sizeof(int));
+  for (int i = 0; i < num_atoms; i++) {
+    int b = get_atom(i)->hash & (num_buckets - 1);
+    while (buckets[b])
+      b = (b + 1) & (num_buckets - 1);
+    buckets[b] = i + 1;
+  }
+}
+
+// str から len 文字の名前の atom を返す。初めて見る名前なら登録する
+int intern(char *str, int len) {
+  if (!num_buckets)
+    grow_buckets();
+
+  uint32_t hash = hash_name(str, len);
+  int b = hash & (num_buckets - 1);
+  while (buckets[b]) {
+    Atom *atom = get_atom(buckets[b] - 1);
+    if (atom->hash == hash && atom->len == len && !memcmp(atom->str, str, len))
+      return buckets[b] - 1;
+    b = (b + 1) & (num_buckets - 1);
+  }
+
+  // 見つからなければ新しく登録する
+  // 表の半分が埋まったら広げて、入れる位置を探し直す
+  if (num_atoms * 2 >= num_buckets) {
+    grow_buckets();
+    b = hash & (num_buckets - 1);
+    while (buckets[b])
+      b = (b + 1) & (num_buckets - 1);
+  }
+  if (num_atoms % ATOM_CHUNK_SIZE == 0) {
+    if (num_atoms / ATOM_CHUNK_SIZE == MAX_ATOM_CHUNKS)
+      error("名前が多すぎます");
+    atom_chunks[num_atoms / ATOM_CHUNK_SIZE] = malloc(sizeof(Atom) * ATOM_CHUNK_SIZE);
+  }
+  Atom *atom = get_atom(num_atoms);
+  atom->str = store_name(str, len);
+  atom->len = len;
+  atom->hash = hash;
+  buckets[b] = num_atoms + 1;
+  return num_atoms++;
+}
+
+// atom の名前の文字列を返す
+char *atom_name(int atom) {
+  return get_atom(atom)->str;
+}
+
+// atom の名前の長さを返す
+int atom_len(int atom) {
+  return get_atom(atom)->len;
+}
@@ -0,0 +1,142 @@
+#!/bin/bash
+# ベンチマーク用のプログラムを生成して nanocc を動かす
+# 使い方: ./bench.sh lex|symtab|scale|stream [MB]
+
+# コメントばかりのプログラム
+gen_comments() {
+  awk 'BEGIN {
+    for (i = 0; i < 100000; i++) {
+      print "// line comment " i " with some ordinary words in it to skip over"
+      print "/* block comment " i " that spans"
+      print "   more than one line of text */"
+    }
+    print "int main() { return 0; }"
+  }'
+}
+
+# 長い識別子ばかりのプログラム
+gen_idents() {
+  awk 'BEGIN {
+    print "int main() {"
+    print "  int abcdefghijklmnopqrstuvwxyz;"
+    for (i = 0; i < 100000; i++)
+      print "  abcdefghijklmnopqrstuvwxyz = abcdefghijklmnopqrstuvwxyz + abcdefghijklmnopqrstuvwxyz;"
+    print "  return 0;"
+    print "}"
+  }'
+}
+
+# n 個のグローバル変数と、それを1つずつ使う main
+# 識別子には英小文字しか使えないので、番号は a-j の並びにする
+gen_globals() {
+  awk -v n=$1 '
+  function name(i,   s) {
+    s = ""
+    do { s = substr("abcdefghij", i % 10 + 1, 1) s; i = int(i / 10) } while (i > 0)
+    return "g" s
+  }
+  BEGIN {
+    for (i = 0; i < n; i++) print "int " name(i) ";"
+    print "int main() {"
+    for (i = 0; i < n; i++) print "  " name(i) " = " name(i) " + 1;"
+    print "  return 0;"
+    print "}"
+  }'
+}
+
+# n 個の小さな関数と、最後の関数を呼ぶ main
+# 引数とローカル変数をそれぞれ 8 個ずつ持たせる
+gen_funcs() {
+  awk -v n=$1 '
+  function name(i,   s) {
+    s = ""
+    do { s = substr("abcdefghij", i % 10 + 1, 1) s; i = int(i / 10) } while (i > 0)
+    return "f" s
+  }
+  BEGIN {
+    for (i = 0; i < n; i++) {
+      print "int " name(i) "(int a, int b, int c, int d, int e, int f, int g, int h) {"
+      print "  int p; int q; int r; int s; int t; int u; int v; int w;"
+      print "  p = a + b; q = c + d; r = e + f; s = g + h;"
+      print "  t = p * q; u = r * s; v = t - u; w = v / 2;"
+      print "  if (w < 0) w = 0 - w;"
+      print "  return w;"
+      print "}"
+    }
+    print "int main() {"
+    print "  return " name(n - 1) "(1, 2, 3, 4, 5, 6, 7, 8);"
+    print "}"
+  }'
+}
+
+# 本体が m 行ずつある n 個の大きな関数と、最後の関数を呼ぶ main
+gen_big_funcs() {
+  awk -v n=$1 -v m=$2 '
+  function name(i,   s) {
+    s = ""
+    do { s = substr("abcdefghij", i % 10 + 1, 1) s; i = int(i / 10) } while (i > 0)
+    return "f" s
+  }
+  BEGIN {
+    for (i = 0; i < n; i++) {
+      print "int " name(i) "(int a, int b) {"
+      print "  int p; int q;"
+      for (j = 0; j < m; j++)
+        print "  p = a + b * 3; q = p - a / 2; a = q + p;"
+      print "  return a;"
+      print "}"
+    }
+    print "int main() {"
+    print "  return " name(n - 1) "(1, 2);"
+    print "}"
+  }'
+}
+
+bench_symtab() {
+  TIMEFORMAT=%R
+  for n in 4000 8000 16000 32000 64000 128000; do
+    gen_globals $n > tmp_bench.nanoc
+    echo -n "$n globals: "
+    { time ./nanocc tmp_bench.nanoc > /dev/null; } 2>&1
+  done
+}
+
+bench_scale() {
+  TIMEFORMAT=%R
+  for n in 1000 10000 100000; do
+    gen_funcs $n > tmp_bench.nanoc
+    echo -n "$n functions ($(wc -c < tmp_bench.nanoc) bytes): "
+    { time ./nanocc tmp_bench.nanoc > /dev/null; } 2>&1
+  done
+}
+
+# 1 MB ずつの関数を並べた、合わせて MB メガバイト (既定は 100) のプログラムを、
+# 関数ごとにコードを生成して解放するとき (-f -j1) と、すべての関数を
+# パーズしてからコードを生成するとき (-f -j2) とで比べる
+bench_stream() {
+  TIMEFORMAT=%R
+  gen_big_funcs ${1:-100} 24000 > tmp_bench.nanoc
+  echo "$(wc -c < tmp_bench.nanoc) bytes"
+  for j in 1 2; do
+    echo -n "-f -j$j: "
+    { time ./nanocc tmp_bench.nanoc -f -j$j -s 2>&1 >/dev/null | grep "peak RSS"; } 2>&1 | tr '\n' ' '
+    echo
+  done
+}
+
+bench_lex() {
+  gen_comments > tmp_bench.nanoc
+  echo "comment-heavy ($(wc -c < tmp_bench.nanoc) bytes)"
+  ./nanocc tmp_bench.nanoc -b
+  gen_idents > tmp_bench.nanoc
+  echo "identifier-heavy ($(wc -c < tmp_bench.nanoc) bytes)"
+  ./nanocc tmp_bench.nanoc -b
+}
+
+case "$1" in
+  lex) bench_lex ;;
+  symtab) bench_symtab ;;
+  scale) bench_scale ;;
+  stream) bench_stream $2 ;;
+  *) echo "usage: $0 lex|symtab|scale|stream [MB]"; exit 1 ;;
+esac
@@ -10,11 +10,11 @@ void load(Type *type) {
     type = type->ptr_to;
   }
   if (type_size(type) == 4) {
-    printf("  mov eax, DWORD PTR [rax]\n");
+    println("  mov eax, DWORD PTR [rax]");
   } else if (type_size(type) == 1) {
-    printf("  movsx rax, BYTE PTR [rax]\n");
+    println("  movsx rax, BYTE PTR [rax]");
   } else {
-    printf("  mov rax, [rax]\n");
+    println("  mov rax, [rax]");
   }
 }
 
@@ -25,27 +25,55 @@ void store(Type *type) {
     type = type->ptr_to;
   }  
   if (type_size(type) == 4) {
-    printf("  mov DWORD PTR [rax], edi\n");
+    println("  mov DWORD PTR [rax], edi");
   } else if (type_size(type) == 1) {
-    printf("  mov BYTE PTR [rax], dil\n");
+    println("  mov BYTE PTR [rax], dil");
   } else {
-    printf("  mov [rax], rdi\n");
+    println("  mov [rax], rdi");
   }
 }
 
+// 条件式 cond が偽なら .L<name><id> に飛ぶコードを出力する
+// 条件式が比較なら、0 か 1 の値を作って積まずに、cmp と条件つきジャンプだけにする。
+// cmp の直後の条件つきジャンプは、CPU が1つの命令にまとめて (macro-fusion) 実行する
+static void gen_branch_if_false(Node *cond, char *name, int id) {
+  // 比較が成り立たないときに飛ぶ命令
+  char *jcc = NULL;
+  switch (cond->kind) {
+  case ND_EQ: jcc = "jne"; break;
+  case ND_NEQ: jcc = "je"; break;
+  case ND_LT: jcc = "jge"; break;
+  case ND_LTE: jcc = "jg"; break;
+  }
+  if (jcc) {
+    gen(cond->lhs);
+    gen(cond->rhs);
+    println("  pop rdi"); // 右辺
+    println("  pop rax"); // 左辺
+    println("  cmp rax, rdi");
+    println("  %s .L%s%d", jcc, name, id);
+    return;
+  }
+  // 条件式の値を 0 と比較する
+  gen(cond);
+  println("  pop rax");
+  println("  cmp rax, 0");
+  println("  je .L%s%d", name, id);
+}
+
 // 左辺値の表すアドレスをスタックに積むコードを出力する
 void gen_lval(Node *node) {
   if (node->kind == ND_LVAR) {
     // ローカル変数の場合
     // ベースポインタからその変数へのオフセットを引くことで、変数のアドレスを得る
-    printf("  lea rax, -%d[rbp]\n", node->offset);
+    println("  lea rax, -%d[rbp]", node->var->offset);
     // 変数のアドレスをスタックに積む
-    printf("  push rax # address of %s\n", node->var->name);
+    println("  push rax # address of %s", atom_name(node->var->name));
   } else if (node->kind == ND_GVAR) {
     // グローバル変数の場合
     // ripからその変数へのオフセットを引くことで、変数のアドレスを得る
-    printf("  lea rax, %s[rip]\n", node->var->name);
-    printf("  push rax # address of %s\n", node->var->name);
+    println("  lea rax, %s[rip]", atom_name(node->var->name));
+    println("  push rax # address of %s", atom_name(node->var->name));
   } else if (node->kind == ND_DEREF) {
     // * の右側を普通の値だと思ってコンパイルする
     gen(node->lhs);
@@ -55,20 +83,41 @@ void gen_lval(Node *node) {
   }
 }
 
+// レジスターで渡せる引数の個数。それより後ろの引数はスタックに積んで渡す
+#define NUM_ARG_REGISTERS 6
+
 char *arg_registers(int i, size_t size) {
   // ABI に定められた引数を格納するべきレジスター群
-  char *arg_registers_8[6] = {
+  char *arg_registers_8[NUM_ARG_REGISTERS] = {
     "rdi", "rsi", "rdx", "rcx", "r8", "r9"
   };
-  char *arg_registers_4[6] = {
-    "edi", "esi", "edx", "ecx", "e8", "e9"
+  char *arg_registers_4[NUM_ARG_REGISTERS] = {
+    "edi", "esi", "edx", "ecx", "r8d", "r9d"
+  };
+  char *arg_registers_1[NUM_ARG_REGISTERS] = {
+    "dil", "sil", "dl", "cl", "r8b", "r9b"
   };
+  if (size == 1) {
+    return arg_registers_1[i];
+  }
   if (size == 4) {
     return arg_registers_4[i];
   }
   if (size == 8) {
     return arg_registers_8[i];
   }
+  error("unreachable: arg_registers");
+}
+
+// rax の下位 size バイトの名前
+char *rax_register(size_t size) {
+  if (size == 1) {
+    return "al";
+  }
+  if (size == 4) {
+    return "eax";
+  }
+  return "rax";
 }
 
 // ASTからアセンブリを出力する
@@ -76,13 +125,15 @@ void gen(Node *node) {
   // ブロック中の現在注目する文
   Node *cur_stmt;
   // 関数名
-  char func_name[255];
+  char *func_name;
+  // 関数定義
+  Function *fn;
 
   // 値なら push する
   switch (node->kind) {
   // 数値
   case ND_NUM:
-    printf("  push %d\n", node->val);
+    println("  push %d", node->val);
     return;
   // グローバル変数
   case ND_GVAR:
@@ -94,7 +145,7 @@ void gen(Node *node) {
     }
     // 配列以外ならアドレスの指す値を持ってくる
     // 左辺値の指すアドレスを rax に持ってくる
-    printf("  pop rax\n");
+    println("  pop rax");
     // rax の指すアドレスにある値を、変数の型に応じたバイト数だけ rax に持ってくる
     load(node->type);
   // ローカル変数
@@ -107,37 +158,37 @@ void gen(Node *node) {
     }
     // 配列以外ならアドレスの指す値を持ってくる
     // 左辺値の指すアドレスを rax に持ってくる
-    printf("  pop rax\n");
+    println("  pop rax");
     // rax の指すアドレスにある値を、変数の型に応じたバイト数だけ rax に持ってくる
     load(node->type);
     // 持ってきた値をスタックに積む
-    printf("  push rax\n");
+    println("  push rax");
     return;
   // 代入式
   case ND_ASSIGN:
-    printf("  # %s\n", source_code(node->src_pos));
+    println("  # %s", source_code(node_src_pos(node)));
     // まず左辺のアドレスをスタックに積む
     gen_lval(node->lhs);
     // 右辺値をスタックに積む
     gen(node->rhs);
 
     // 右辺値を rdi に持ってくる
-    printf("  pop rdi\n");
+    println("  pop rdi");
     // 左辺値のアドレスを rax に持ってくる
-    printf("  pop rax\n");
+    println("  pop rax");
     // 左辺値のアドレスに右辺値の値を入れる
     // rax の指すアドレスに、変数の型に応じたバイト数だけ rdi の値を入れる
     store(node->lhs->type);
     // 右辺値をスタックに積む。つまり代入式の値は右辺値。
-    printf("  push rdi\n");
+    println("  push rdi");
     return; 
   // return
   case ND_RETURN:
-    printf("  # %s\n", source_code(node->str));
+    println("  # %s", source_code(node_src_pos(node)));
     // return 式 の 式を積む
     gen(node->lhs);
     // 返すべき値を rax に取ってきて
-    printf("  pop rax\n");
+    println("  pop rax");
     // ここからエピローグ。スタックは現時点でこうなっている。
     // 戻りアドレス
     // 呼び出し時点の rbp <- rbp
@@ -146,84 +197,93 @@ void gen(Node *node) {
     // 返すべき式
     
     // 関数呼び出し時点のベースポインタをスタックポインタが指すようにして
-    printf("  mov rsp, rbp\n");
+    println("  mov rsp, rbp");
     // ベースポインタを呼び出し時点のものに戻す
-    printf("  pop rbp\n");
+    println("  pop rbp");
     // rax に持っている値を返し、戻りアドレスに戻る
-    printf("  ret\n");
+    println("  ret");
     return;
   // if
-  case ND_IF:
-    printf("  # if\n");
-    // 条件式 をコンパイルしてスタックトップに積む
-    gen(node->cond);
-    // 条件式を 0 と比較する
-    printf("  pop rax\n");
-    printf("  cmp rax, 0\n");
+  case ND_IF: {
+    println("  # if");
+    // 中の文の if や while も通し番号を使うので、先に取っておく
+    int id = label_id++;
     // else がない場合
     if (node->rhs == NULL) {
-      // 条件が偽ならなにもせず抜ける
-      printf("  je .Lend%d\n", label_id);
-      // 条件が真なら then 部分を計算
+      // 条件が偽なら else へジャンプ
+      gen_branch_if_false(node->cond, "else", id);
+      // 条件が真なら then 部分を計算して抜ける
       gen(node->lhs);
+      println("  jmp .Lend%d", id);
+      // 偽の場合も文として何かを積む約束なので 0 を積む
+      println(".Lelse%d:", id);
+      println("  push 0");
     } else {
       // else がある場合
       // 条件が偽なら else へジャンプ
-      printf("  je .Lelse%d\n", label_id);
+      gen_branch_if_false(node->cond, "else", id);
       // 条件が真なら then 部分を計算して抜ける
       gen(node->lhs);
-      printf("  jmp .Lend%d\n", label_id);
+      println("  jmp .Lend%d", id);
       // 偽の場合は else 部分を計算する
-      printf(".Lelse%d:\n", label_id);
+      println(".Lelse%d:", id);
       gen(node->rhs);
     }
-    printf(".Lend%d:\n", label_id);
-    // 通し番号を足しておく
-    label_id++;
+    println(".Lend%d:", id);
     return;
+  }
   // while
-  case ND_WHILE:
-    printf(".Lbegin%d:\n", label_id);
-    // 条件式をコンパイル
-    gen(node->cond);
-    // 条件式を 0 と比較する
-    printf("  pop rax\n");
-    printf("  cmp rax, 0\n");
+  case ND_WHILE: {
+    int id = label_id++;
+    println(".Lbegin%d:", id);
     // 条件が偽なら end へジャンプ
-    printf("  je .Lend%d\n", label_id);
-    // 本体をコンパイル
+    gen_branch_if_false(node->cond, "end", id);
+    // 本体をコンパイルし、積んだ値を捨てる
     gen(node->lhs);
+    println("  pop rax");
     // whileの最初に戻る
-    printf("  jmp .Lbegin%d\n", label_id);
-    printf(".Lend%d:\n", label_id);
-    // 通し番号を足しておく
-    label_id++;
+    println("  jmp .Lbegin%d", id);
+    println(".Lend%d:", id);
+    // 文として何かを積む約束なので 0 を積む
+    println("  push 0");
     return;
+  }
   // for
-  case ND_FOR:
+  case ND_FOR: {
+    int id = label_id++;
     // 初期化式をコンパイル
-    gen(node->lhs); 
-    printf(".Lbegin%d:\n", label_id);
-    // 条件式をコンパイル
-    gen(node->cond);
-    // 条件式を 0 と比較する
-    printf("  pop rax\n");
-    printf("  cmp rax, 0\n");
-    // 条件が偽なら end へジャンプ
-    printf("  je .Lend%d\n", label_id);
+    // 初期化式、本体、増加式が積んだ値は使わないので、そのつど捨てる。
+    // 捨てないと、回るたびにスタックが伸びていく
+    if (node->lhs) {
+      gen(node->lhs);
+      println("  pop rax");
+    }
+    println(".Lbegin%d:", id);
+    // 条件が偽なら end へジャンプ。条件式がなければずっと回る
+    if (node->cond)
+      gen_branch_if_false(node->cond, "end", id);
     // 本体をコンパイル
     gen(node->body);
+    println("  pop rax");
     // 増加式をコンパイル
-    gen(node->rhs);
+    if (node->rhs) {
+      gen(node->rhs);
+      println("  pop rax");
+    }
     // ループの最初に戻る
-    printf("  jmp .Lbegin%d\n", label_id);
-    printf(".Lend%d:\n", label_id);
-    label_id++;
+    println("  jmp .Lbegin%d", id);
+    println(".Lend%d:", id);
+    // 文として何かを積む約束なので 0 を積む
+    println("  push 0");
     return;
+  }
   // ブロック
   case ND_BLOCK:
+    // 空のブロックも、文として何かを積む約束なので 0 を積む
+    if (node->body == NULL)
+      println("  push 0");
     // いま注目している文を指しておく
-    cur_stmt = node->next;
+    cur_stmt = node->body;
     while (cur_stmt != NULL) {
       // 文を1つコンパイルする
       gen(cur_stmt);
@@ -231,87 +291,105 @@ void gen(Node *node) {
       cur_stmt = cur_stmt->next;
       if (cur_stmt != NULL) {
         // 最後の文以外では、積んだ値はムダなので捨てる
-        printf("  pop rax\n");
+        println("  pop rax");
       }
     }
     return;
   // 関数呼び出し
   case ND_CALL:
-    printf("  # %s\n", source_code(node->src_pos));
-    // 引数を順にコンパイルする
-    for (int i = 0; i < node->argc; i++) {
+    println("  # %s", source_code(node_src_pos(node)));
+    // レジスターに入りきらない引数は、後ろから順にスタックに積む
+    // 最後に積んだ 7 番目の引数が、call の時点でスタックの先頭に来る
+    for (int i = node->argc - 1; i >= NUM_ARG_REGISTERS; i--) {
+      gen(node->args[i]);
+    }
+    // レジスターで渡す引数を順にコンパイルする
+    int num_reg_args = node->argc < NUM_ARG_REGISTERS ? node->argc : NUM_ARG_REGISTERS;
+    for (int i = 0; i < num_reg_args; i++) {
       gen(node->args[i]);
     }
     // ABIで定められた各レジスタに pop する
-    for (int i = node->argc - 1; i >= 0; i--) {
-      printf("  pop %s\n", arg_registers(i, 8));
+    for (int i = num_reg_args - 1; i >= 0; i--) {
+      println("  pop %s", arg_registers(i, 8));
     }
     // rax には引数の個数を入れる
-    printf("  mov rax, %d\n", node->argc);
-    // 関数名をコピーしてくる
-    strncpy(func_name, node->str, node->len);
-    func_name[node->len] = '\0';
+    println("  mov rax, %d", node->argc);
+    // 関数名を持ってくる
+    func_name = atom_name(node->name);
     // todo: rsp が16の倍数になっていなければ調整、のコードを入れる
     // 可変長引数を取る関数を呼ぶときは、浮動小数点数の引数の個数をALに入れておく
     // さしあたりつねに al を 0 にセットしておく
-    printf("  mov al, 0\n");
-    printf("  call %s\n", func_name);
+    println("  mov al, 0");
+    println("  call %s", func_name);
+    // スタックで渡した引数を捨てる
+    if (node->argc > NUM_ARG_REGISTERS) {
+      println("  add rsp, %d", (node->argc - NUM_ARG_REGISTERS) * 8);
+    }
     // 関数の戻り値が rax に入っているのでスタックに積む
-    printf("  push rax\n");
+    println("  push rax");
     return;
   // 関数定義
   case ND_FUNC_DEF:
-    // 関数名をコピーしてくる
-    strncpy(func_name, node->str, node->len);
-    func_name[node->len] = '\0';
+    fn = node->func;
+    // 関数名を持ってくる
+    func_name = atom_name(fn->name);
     // 関数をリンク時に外のファイルから見れるようにする
-    printf(".globl %s\n", func_name);
+    println(".globl %s", func_name);
     // ラベルを出力する
-    printf("%s:\n", func_name);
+    println("%s:", func_name);
     // プロローグ
     // 現時点のスタックベースポインタをスタックに積む
-    printf("  # prologue\n");
-    printf("  push rbp\n");
+    println("  # prologue");
+    println("  push rbp");
     // 現在のスタックの先頭をベースポインタとする
-    printf("  mov rbp, rsp\n");
+    println("  mov rbp, rsp");
     // レジスタにある引数を、引数の個数分だけ、定められたオフセットに割り当てる
-    LVar *cur = node->locals;
+    LVar *cur;
     // ローカル変数のリストを、ローカル変数、実引数の順で逆順に持たせる
-    LVar *vars[255];
+    // 配列は本体と一緒に解放されるように関数のアリーナに置く
     int num_locals = 0;
-    while (cur) {
-      vars[num_locals] = cur;
-      cur = cur->next;
+    for (cur = fn->locals; cur; cur = cur->next) {
       num_locals++;
     }
+    LVar **vars = arena_alloc(&fn->arena, sizeof(LVar *) * num_locals);
+    num_locals = 0;
+    for (cur = fn->locals; cur; cur = cur->next) {
+      vars[num_locals++] = cur;
+    }
     for (int i = num_locals - 1; i >= 0; i--) {
-      printf("  # offset %s %d\n", vars[i]->name, vars[i]->offset);
+      println("  # offset %s %d", atom_name(vars[i]->name), vars[i]->offset);
     }
     // 引数の個数分だけ、スタックに値を割り当てる
-    for (int i = 0; i < node->argc; i++) {
-      printf("  mov rbx, rsp\n");
-      printf("  sub rbx, %d\n", vars[num_locals - 1 - i]->offset);
+    for (int i = 0; i < fn->argc; i++) {
+      println("  mov rbx, rsp");
+      println("  sub rbx, %d", vars[num_locals - 1 - i]->offset);
       int size = type_size(vars[num_locals - 1 - i]->type);
-      printf("  mov [rbx], %s\n", arg_registers(i, size));
+      if (i < NUM_ARG_REGISTERS) {
+        println("  mov [rbx], %s", arg_registers(i, size));
+      } else {
+        // 7 番目からの引数は、戻りアドレスと呼び出し時点の rbp の上に積まれている
+        println("  mov rax, %d[rbp]", 16 + (i - NUM_ARG_REGISTERS) * 8);
+        println("  mov [rbx], %s", rax_register(size));
+      }
     }
     // 引数とローカル変数の全体分の領域を確保する        
-    if (node->locals) {
-      // node->locals は最後に登録された変数を指す
-      printf("  mov rsp, rbp\n");
-      printf("  sub rsp, %d\n", node->locals->offset);
+    if (fn->locals) {
+      // fn->locals は最後に登録された変数を指す
+      println("  mov rsp, rbp");
+      println("  sub rsp, %d", fn->locals->offset);
     }
 
     // 本体であるブロックをコンパイルする
-    printf("  # function body\n");
-    gen(node->body);
+    println("  # function body");
+    gen(fn->body);
     // エピローグ
     // 関数呼び出し時点のベースポインタをスタックから取得し
-    printf("  # epilogue\n");
-    printf("  mov rsp, rbp\n");
+    println("  # epilogue");
+    println("  mov rsp, rbp");
     // ベースポインタをそれに戻す
-    printf("  pop rbp\n");
+    println("  pop rbp");
     // 最後の式の結果がRAXに残っているのでそれが返り値になる  
-    printf("  ret\n");
+    println("  ret");
     return;
   // & 変数名のアドレス
   case ND_ADDR:
@@ -324,22 +402,22 @@ void gen(Node *node) {
     // 値は lhs に入っている
     gen(node->lhs);
     // 値を rax に持ってくる
-    printf("  pop rax\n");
+    println("  pop rax");
     // rax の指すアドレスにある値を、ポインターの指す型に応じたバイト数だけ rax に持ってくる
     load(node->lhs->type->ptr_to);
     // rax をスタックに積む
-    printf("  push rax\n");
+    println("  push rax");
     return;
   // 変数宣言
   case ND_DECL:
     // なにもしないが、何かを積む約束になっているので 0 を積む
-    printf("  push 0 # do nothing\n");
+    println("  push 0 # do nothing");
     return;
   // 文字列
   case ND_STRING:
     // 文字列のアドレスを rax に load する
-    printf("  lea rax, .LC%d[rip]\n", node->string->index);
-    printf("  push rax\n");
+    println("  lea rax, .LC%d[rip]", node->string->index);
+    println("  push rax");
     return;
   }
 
@@ -352,8 +430,8 @@ void gen(Node *node) {
   // 左辺、右辺の順でコード生成しているので、先頭が右辺で、2番めが左辺になる
   // 64bitレジスタは rax, rdi, rsi, rdx, rcx, rbp, rsp, rbx, r8, r9, ..
   // のような順序で使うらしい
-  printf("  pop rdi\n"); // 右辺
-  printf("  pop rax\n"); // 左辺
+  println("  pop rdi"); // 右辺
+  println("  pop rax"); // 左辺
 
   switch (node->kind) {
   case ND_ADD:
@@ -362,10 +440,10 @@ void gen(Node *node) {
         || node->lhs->kind == ND_ADDR ) {
       // 足し算の左辺が変数のときだけ
       if (node->lhs->type->kind == PTR || node->lhs->type->kind == ARRAY) {
-        printf("  imul rdi, %d\n", type_size(node->lhs->type->ptr_to));
+        println("  imul rdi, %d", type_size(node->lhs->type->ptr_to));
       }
     }
-    printf("  add rax, rdi\n");
+    println("  add rax, rdi");
     break;
   case ND_SUB:
     // 左辺 - 右辺
@@ -374,15 +452,15 @@ void gen(Node *node) {
         || node->lhs->kind == ND_ADDR ) {
       // 足し算の左辺が変数のときだけ
       if (node->lhs->type->kind == PTR || node->lhs->type->kind == ARRAY) {
-        printf("  imul rdi, %d\n", type_size(node->lhs->type->ptr_to));
+        println("  imul rdi, %d", type_size(node->lhs->type->ptr_to));
       }
     }    
-    printf("  sub rax, rdi\n");
+    println("  sub rax, rdi");
     break;
   case ND_MUL:
     // imul は素直な掛け算
     // mul は mul src	=> RDX:RAX = RAX * src となる128bitの掛け算
-    printf("  imul rax, rdi\n");
+    println("  imul rax, rdi");
     break;
   case ND_DIV:
     // 割り算は 128bit に拡張するやつしかない
@@ -390,42 +468,48 @@ void gen(Node *node) {
     // RAX = RDX:RAX / r64
     // RDX = RDX:RAX % r64
     // なので cqo で RAXを128ビットに符号拡張してRDX:RAXにストア する
-    printf("  cqo\n");
-    printf("  idiv rdi\n");
+    // int は上位 32 ビットが 0 で読まれていることがあるので、下位 32 ビットを cdq で広げて割る
+    if (type_size(node->type) == 4) {
+      println("  cdq");
+      println("  idiv edi");
+    } else {
+      println("  cqo");
+      println("  idiv rdi");
+    }
     break;
   // == 
   case ND_EQ:
     // 等しさを比べる
-    printf("  cmp rax, rdi\n");
+    println("  cmp rax, rdi");
     // 結果を al レジスタに入れる。al は rax の下位8bit の別名
-    printf("  sete al\n");
+    println("  sete al");
     // rax 全体を 0 か 1 にしたいので、rax の上位 56 bit を 0クリアする
-    printf("  movzb rax, al\n");
+    println("  movzb rax, al");
     break;
   // != 
   case ND_NEQ:
     // cmp, setne で等しくなさを比べる 
-    printf("  cmp rax, rdi\n");
-    printf("  setne al\n");
-    printf("  movzb rax, al\n");
+    println("  cmp rax, rdi");
+    println("  setne al");
+    println("  movzb rax, al");
     break;
   // <
   case ND_LT:
     // cmp, setl で < での大小比較を行う
-    printf("  cmp rax, rdi\n");
-    printf("  setl al\n");
-    printf("  movzb rax, al\n");
+    println("  cmp rax, rdi");
+    println("  setl al");
+    println("  movzb rax, al");
     break;
   // <=
   case ND_LTE:
     // cmp, setl で <= での大小比較を行う
-    printf("  cmp rax, rdi\n");
-    printf("  setle al\n");
-    printf("  movzb rax, al\n");
+    println("  cmp rax, rdi");
+    println("  setle al");
+    println("  movzb rax, al");
     break; 
   }
 
-  printf("  push rax\n");
+  println("  push rax");
 }
 
 // グローバル変数があれば、領域を確保するコードを出力する
@@ -434,7 +518,7 @@ void gen_global_var() {
     printf("  .bss\n");
     LVar *cur = global_var_list;
     while (cur) {
-      printf("%s:\n", cur->name);
+      printf("%s:\n", atom_name(cur->name));
       printf("  .zero %d\n", cur->offset);
       cur = cur->next;
     }
@@ -443,15 +527,19 @@ void gen_global_var() {
 }
 
 // 文字列があれば、領域を確保するコードを出力する
+// 同じ中身の文字列はリンカーがまとめられるように、マージできるセクションに置く
 void gen_strings() {
   if (string_list) {
+    printf("  # %d string literals deduplicated\n", string_dedup_count);
+    printf("  .section .rodata.str1.1,\"aMS\",@progbits,1\n");
     String *cur = string_list;
     while (cur) {
       printf(".LC%d:\n", cur->index);
       printf("  .string \"%s\"\n", cur->str);
       cur = cur->next;
     }
-  }    
+    printf("  .text\n");
+  }
 }
 
 // プログラムの特定の位置の行の全体を取り出す
@@ -479,7 +567,8 @@ char *source_code(char *pos) {
     len++;
   }
   // c から len文字ぶんがその行
-  char *buf = calloc(len, sizeof(char));
+  // コード生成中の関数のアリーナに置いて、関数ごとにまとめて解放する
+  char *buf = arena_alloc(cur_arena, len + 1);
   strncpy(buf, c, len);
   buf[len] = '\0';
   return buf;
@@ -10,7 +10,7 @@ void print_ast() {
     printf("global vars\n");
   while (gv) {
     // 変数名
-    printf("- %s: ", gv->name);
+    printf("- %s: ", atom_name(gv->name));
     // 型
     Type *type = gv->type;
     while (type) {
@@ -27,23 +27,23 @@ void print_ast() {
   // 先頭の関数定義から順に表示
   printf("functions\n");
   for (int i = 0; func_defs[i]; i++) {
-    print_func(func_defs[i]);
+    // 本体をパーズしなかった関数は表示しない
+    if (func_defs[i]->func->body)
+      print_func(func_defs[i]);
   }
 }
 
 // 関数定義を表示
 void print_func(Node *node) {
+  Function *fn = node->func;
   // ローカル変数
-  char func_name[255];
-  strncpy(func_name, node->str, node->len);
-  func_name[node->len] = '\0';
-  printf("- %s\n", func_name);
-  LVar *lvar = node->locals;
+  printf("- %s\n", atom_name(fn->name));
+  LVar *lvar = fn->locals;
   if (lvar) {
     printf("  - local vars\n");    
   }
   while (lvar) {
-    printf("    - %s: ", lvar->name);
+    printf("    - %s: ", atom_name(lvar->name));
     // 型
     Type *type = lvar->type;
     while (type) {
@@ -57,7 +57,7 @@ void print_func(Node *node) {
     lvar = lvar->next;
   }
   // 本体
-  Node *stmt = node->body->next;
+  Node *stmt = fn->body->body;
   while (stmt) {
     // 文を1つ表示する
     print_node(stmt, 2);
@@ -67,7 +67,9 @@ void print_func(Node *node) {
 }
 
 void print_node(Node *node, int depth) {
-  char func_name[255];
+  // else のない if や、空の for の初期化式などは表示しない
+  if (!node)
+    return;
 
   // インデント
   for (int i = 0; i < depth; i++)
@@ -79,16 +81,13 @@ void print_node(Node *node, int depth) {
     printf("- num: %d\n", node->val);
     break;
   case ND_GVAR:
-    printf("- global var: %s\n", node->var->name);
+    printf("- global var: %s\n", atom_name(node->var->name));
     break;
   case ND_LVAR:
-    printf("- local var: %s\n", node->var->name);
+    printf("- local var: %s\n", atom_name(node->var->name));
     break;
   case ND_CALL:
-    // 関数名をコピーしてくる
-    strncpy(func_name, node->str, node->len);
-    func_name[node->len] = '\0';
-    printf("call %s\n", func_name);
+    printf("call %s\n", atom_name(node->name));
     break;
   case ND_ASSIGN:
     printf("- assign\n");
@@ -173,7 +172,7 @@ void print_node(Node *node, int depth) {
     break;
   case ND_BLOCK:
     printf("- block\n");
-    Node *cur_stmt = node->next;
+    Node *cur_stmt = node->body;
     while (cur_stmt != NULL) {
       print_node(cur_stmt, depth + 2);
       cur_stmt = cur_stmt->next;
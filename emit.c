@@ -0,0 +1,766 @@
+#include "nanocc.h"
+
+// IR から x86-64 のアセンブリを出力する
+// 値はレジスター割り当て (regalloc.c) で決めたレジスターに置く。
+// レジスターに入りきらなかった値はスタック上の 8 バイトの場所に置き、
+// 定数と変数のアドレスは場所を持たせず、使うところで作り直す。
+// rax, rdx, r11 は割り当てに使わないので、ここで作業用に使ってよい
+
+// レジスターの名前。大きさ 8, 4, 1 バイトの順
+static char *reg_names[][NUM_REGS] = {
+  {"rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi",
+   "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"},
+  {"eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi",
+   "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d"},
+  {"al", "cl", "dl", "bl", "spl", "bpl", "sil", "dil",
+   "r8b", "r9b", "r10b", "r11b", "r12b", "r13b", "r14b", "r15b"},
+};
+
+// 引数を渡すレジスター
+static int arg_regs[] = {RDI, RSI, RDX, RCX, R8, R9};
+#define NUM_ARG_REGS 6
+
+// 関数の入口で保存して出口で戻すレジスター
+static int callee_saved[] = {RBX, R12, R13, R14, R15};
+#define NUM_CALLEE_SAVED (sizeof(callee_saved) / sizeof(*callee_saved))
+
+// レジスター r の下位 size バイトの名前
+static char *reg(int r, int size) {
+  if (size == 8)
+    return reg_names[0][r];
+  if (size == 4)
+    return reg_names[1][r];
+  return reg_names[2][r];
+}
+
+// 読み書きする大きさ size の、メモリーのオペランドにつける大きさの名前
+static char *ptr_size(int size) {
+  if (size == 1)
+    return "BYTE PTR";
+  if (size == 4)
+    return "DWORD PTR";
+  return "QWORD PTR";
+}
+
+// 出力中の関数
+static IrFunc *cur_ir;
+// callee-saved のレジスターを保存する場所の rbp からのオフセット。使わないなら 0
+static int save_slots[NUM_REGS];
+
+// オペランドの文字列を作るための場所。1つの命令で使う分だけ順に使い回す
+static char operand_buf[4][64];
+static int operand_idx;
+
+static char *new_operand_buf() {
+  return operand_buf[operand_idx++ % 4];
+}
+
+// ブロックのラベルの名前
+static char *label(Block *block) {
+  char *name = atom_name(cur_ir->def->func->name);
+  char *buf = arena_alloc(cur_arena, strlen(name) + 16);
+  sprintf(buf, ".L%s_%d", name, block->id);
+  return buf;
+}
+
+// 値 val をレジスター r に読む
+static void load_value(int r, Inst *val) {
+  switch (val->op) {
+  case IR_CONST:
+    println("  mov %s, %ld", reg(r, val->size), val->imm);
+    return;
+  case IR_ALLOCA:
+    println("  lea %s, %d[rbp]", reg(r, 8), val->slot);
+    return;
+  case IR_GADDR:
+    println("  lea %s, %s[rip]", reg(r, 8), atom_name(val->var->name));
+    return;
+  case IR_SADDR:
+    println("  lea %s, .LC%d[rip]", reg(r, 8), val->str->index);
+    return;
+  }
+  if (val->reg == r)
+    return;
+  if (val->reg >= 0)
+    println("  mov %s, %s", reg(r, 8), reg(val->reg, 8));
+  else
+    println("  mov %s, %s %d[rbp]", reg(r, val->size), ptr_size(val->size), val->slot);
+}
+
+// 命令のオペランドとしての値 val。size は読む大きさ
+// レジスターかスタック上の場所か定数をそのまま使い、アドレスは r11 に作る
+static char *operand(Inst *val, int size) {
+  char *buf = new_operand_buf();
+  if (val->op == IR_CONST) {
+    sprintf(buf, "%ld", val->imm);
+  } else if (is_remat(val)) {
+    load_value(R11, val);
+    sprintf(buf, "%s", reg(R11, size));
+  } else if (val->reg >= 0) {
+    sprintf(buf, "%s", reg(val->reg, size));
+  } else {
+    sprintf(buf, "%s %d[rbp]", ptr_size(size), val->slot);
+  }
+  return buf;
+}
+
+// IR_LOAD, IR_STORE の命令 inst が読み書きするメモリーのオペランド。大きさの名前はつけない
+// アドレスは args[0] + index * scale + imm。変数のアドレスは rbp や rip からの位置にし、
+// レジスターにない値は、base なら r11 に、index なら rdx に読んでから使う
+static char *mem_operand(Inst *inst) {
+  char *buf = new_operand_buf();
+  Inst *base = inst->args[0];
+  Inst *index = mem_index(inst);
+  int64_t disp = inst->imm;
+  // rip からの位置には index を足せない
+  if (!index && (base->op == IR_GADDR || base->op == IR_SADDR)) {
+    if (base->op == IR_GADDR)
+      sprintf(buf, "%s", atom_name(base->var->name));
+    else
+      sprintf(buf, ".LC%d", base->str->index);
+    if (disp)
+      sprintf(buf + strlen(buf), "%+ld", disp);
+    strcat(buf, "[rip]");
+    return buf;
+  }
+
+  char *b;
+  if (base->op == IR_ALLOCA) {
+    b = "rbp";
+    disp += base->slot;
+  } else if (!is_remat(base) && base->reg >= 0) {
+    b = reg(base->reg, 8);
+  } else {
+    load_value(R11, base);
+    b = "r11";
+  }
+  char *p = buf;
+  if (disp)
+    p += sprintf(p, "%ld", disp);
+  p += sprintf(p, "[%s", b);
+  if (index) {
+    char *x;
+    if (!is_remat(index) && index->reg >= 0) {
+      x = reg(index->reg, 8);
+    } else {
+      load_value(RDX, index);
+      x = "rdx";
+    }
+    p += sprintf(p, "+%s*%d", x, inst->scale);
+  }
+  sprintf(p, "]");
+  return buf;
+}
+
+// 命令の結果を求めるレジスター。スタックに置く値なら作業用の rax で求める
+static int dest_reg(Inst *inst) {
+  return inst->reg >= 0 ? inst->reg : RAX;
+}
+
+// レジスター r で求めた値を、命令 inst の値の場所に置く
+static void store_result(int r, Inst *inst) {
+  if (inst->reg == r)
+    return;
+  if (inst->reg >= 0) {
+    println("  mov %s, %s", reg(inst->reg, 8), reg(r, 8));
+    return;
+  }
+  // 使われない値は置かなくてよい
+  if (inst->num_uses == 0)
+    return;
+  println("  mov %s %d[rbp], %s", ptr_size(inst->size), inst->slot, reg(r, inst->size));
+}
+
+// 並列の移動の1つ。いっせいに src から dst に移したように動かす
+// 行き先はレジスターかスタック上の場所。元はそれに加えて、メモリーか作り直せる値
+typedef struct {
+  int dst;       // 行き先のレジスター。-1 ならスタック上の場所 dst_slot
+  int dst_slot;
+  int src;       // 元のレジスター。-1 なら src_slot, src_mem, src_val のどれか
+  int src_slot;  // 元のスタック上の場所。0 ならスタックにない
+  char *src_mem; // 元のメモリーのオペランド
+  Inst *src_val; // 元の作り直せる値
+  int size;      // 移す値の大きさ
+  bool done;
+} Move;
+
+// 値 val を置いた場所を元にする移動を作る。行き先はあとで決める
+static Move move_from(Inst *val) {
+  Move m = {-1, 0, -1, 0, NULL, NULL, val->size, false};
+  if (is_remat(val))
+    m.src_val = val;
+  else if (val->reg >= 0)
+    m.src = val->reg;
+  else
+    m.src_slot = val->slot;
+  return m;
+}
+
+// 移動の行き先を、値 val を置いた場所にする
+static void move_to(Move *m, Inst *val) {
+  m->dst = val->reg;
+  m->dst_slot = val->slot;
+}
+
+// 移動の元をレジスター r に読む
+static void load_move_src(int r, Move *m) {
+  if (m->src >= 0)
+    println("  mov %s, %s", reg(r, 8), reg(m->src, 8));
+  else if (m->src_slot)
+    println("  mov %s, %s %d[rbp]", reg(r, m->size), ptr_size(m->size), m->src_slot);
+  else if (m->src_mem)
+    println("  mov %s, %s %s", reg(r, m->size), ptr_size(m->size), m->src_mem);
+  else
+    load_value(r, m->src_val);
+}
+
+// 移動 m の行き先を、まだ終わっていない移動 o が読むか
+static bool reads_dst(Move *o, Move *m) {
+  if (o->done)
+    return false;
+  if (m->dst >= 0)
+    return o->src == m->dst;
+  return o->src < 0 && o->src_slot == m->dst_slot;
+}
+
+// 移動をまとめて出力する。ある移動の行き先を、まだ終わっていない移動が読むなら後回しにし、
+// 互いに待つ循環になったら、1つの元を rax に逃がして循環を切る。
+// スタックからスタックへの移動には r11 を使う
+static void emit_moves(Move *moves, int n) {
+  for (;;) {
+    bool progress = false;
+    bool pending = false;
+    for (int i = 0; i < n; i++) {
+      Move *m = &moves[i];
+      if (m->done)
+        continue;
+      if ((m->dst >= 0 && m->src == m->dst) ||
+          (m->dst < 0 && m->src < 0 && m->src_slot == m->dst_slot)) {
+        m->done = true;
+        continue;
+      }
+      bool blocked = false;
+      for (int j = 0; j < n && !blocked; j++)
+        if (j != i && reads_dst(&moves[j], m))
+          blocked = true;
+      if (blocked) {
+        pending = true;
+        continue;
+      }
+      if (m->dst >= 0) {
+        load_move_src(m->dst, m);
+      } else {
+        int r = m->src;
+        if (r < 0) {
+          load_move_src(R11, m);
+          r = R11;
+        }
+        println("  mov %s %d[rbp], %s", ptr_size(m->size), m->dst_slot, reg(r, m->size));
+      }
+      m->done = true;
+      progress = true;
+    }
+    if (!pending)
+      return;
+    if (progress)
+      continue;
+    // 循環しているので、残っている移動の元を1つ rax に逃がす
+    // 循環に入る移動の元はレジスターかスタック上の場所
+    for (int i = 0; i < n; i++) {
+      Move *m = &moves[i];
+      if (m->done)
+        continue;
+      Move tmp = *m;
+      load_move_src(RAX, &tmp);
+      int src = m->src;
+      int src_slot = m->src_slot;
+      for (int j = 0; j < n; j++) {
+        Move *o = &moves[j];
+        if (o->done || o->src != src || (src < 0 && o->src_slot != src_slot))
+          continue;
+        o->src = RAX;
+        o->src_slot = 0;
+      }
+      break;
+    }
+  }
+}
+
+// ブロック b から後のブロックに移るときに、phi の値を移す
+// critical edge にはブロックを挟んであるので、phi のあるブロックに移るのは
+// 飛び先が1つのブロックだけ
+static void emit_phi_moves(Block *b) {
+  if (num_succs(b) != 1)
+    return;
+  Block *s = succ(b, 0);
+  int n = 0;
+  for (Inst *phi = s->first; phi && phi->op == IR_PHI; phi = phi->next)
+    n++;
+  if (n == 0)
+    return;
+  Move *moves = arena_alloc(cur_arena, sizeof(Move) * n);
+  n = 0;
+  for (Inst *phi = s->first; phi && phi->op == IR_PHI; phi = phi->next) {
+    // 使われない phi の値は移さなくてよい
+    if (phi->num_uses == 0 && phi->reg < 0)
+      continue;
+    for (int j = 0; j < phi->num_args; j++) {
+      if (phi->phi_preds[j] != b)
+        continue;
+      moves[n] = move_from(phi->args[j]);
+      move_to(&moves[n], phi);
+      n++;
+      break;
+    }
+  }
+  emit_moves(moves, n);
+}
+
+// 値 val をスタックに積む
+static void push_value(Inst *val) {
+  if (val->op == IR_CONST) {
+    println("  push %ld", val->imm);
+  } else if (is_remat(val)) {
+    load_value(RAX, val);
+    println("  push rax");
+  } else if (val->reg >= 0) {
+    println("  push %s", reg(val->reg, 8));
+  } else {
+    println("  push QWORD PTR %d[rbp]", val->slot);
+  }
+}
+
+// 関数呼び出し
+// 呼び出しをまたいで生きる値は callee-saved のレジスターかスタックにあるので、
+// caller-saved のレジスターはここで自由に書き換えてよい
+static void emit_call(Inst *inst) {
+  // レジスターに入りきらない引数は、後ろから順にスタックに積む
+  // 積んだ後でスタックが 16 バイト境界に揃うように、奇数個なら 8 バイト空けておく
+  int num_stack = inst->num_args > NUM_ARG_REGS ? inst->num_args - NUM_ARG_REGS : 0;
+  int pad = num_stack % 2 ? 8 : 0;
+  if (pad)
+    println("  sub rsp, %d", pad);
+  for (int i = inst->num_args - 1; i >= NUM_ARG_REGS; i--)
+    push_value(inst->args[i]);
+
+  Move moves[NUM_ARG_REGS];
+  int n = 0;
+  for (int i = 0; i < inst->num_args && i < NUM_ARG_REGS; i++) {
+    moves[n] = move_from(inst->args[i]);
+    moves[n].dst = arg_regs[i];
+    n++;
+  }
+  emit_moves(moves, n);
+
+  // 可変長引数の関数のために、ベクトルレジスターで渡す引数の数を al に入れる
+  println("  mov eax, 0");
+  println("  call %s", atom_name(inst->name));
+  if (num_stack)
+    println("  add rsp, %d", num_stack * 8 + pad);
+  // char を返す関数なら、下位 1 バイトを符号拡張する
+  if (inst->mem_size == 1)
+    println("  movsx eax, al");
+  store_result(RAX, inst);
+}
+
+// 足し算、引き算、掛け算。x86 の命令は左辺のレジスターを結果で上書きする
+static void emit_binop(char *name, Inst *inst) {
+  Inst *lhs = inst->args[0];
+  Inst *rhs = inst->args[1];
+  int d = dest_reg(inst);
+  // 結果のレジスターに左辺を読むと右辺を壊してしまうときは、
+  // 入れ替えられる演算なら入れ替え、そうでなければ rax で求める
+  if (!is_remat(rhs) && rhs->reg == d && (is_remat(lhs) || lhs->reg != d)) {
+    if (inst->op == IR_SUB) {
+      d = RAX;
+    } else {
+      Inst *tmp = lhs;
+      lhs = rhs;
+      rhs = tmp;
+    }
+  }
+  load_value(d, lhs);
+  println("  %s %s, %s", name, reg(d, inst->size), operand(rhs, inst->size));
+  store_result(d, inst);
+}
+
+// 足し算、定数の引き算、3, 5, 9 倍の掛け算を lea で求める。できなければ偽を返す
+// lea は結果を左辺と別のレジスターに置けるので、左辺を結果のレジスターに移す mov が要らない。
+// 32 ビットの値も 64 ビットのレジスターで計算してよい。結果の下位 32 ビットは同じになる
+static bool emit_lea(Inst *inst) {
+  Inst *lhs = inst->args[0];
+  Inst *rhs = inst->args[1];
+  if (inst->op != IR_SUB && lhs->op == IR_CONST) {
+    Inst *tmp = lhs;
+    lhs = rhs;
+    rhs = tmp;
+  }
+  int d = dest_reg(inst);
+  int l = is_remat(lhs) ? -1 : lhs->reg;
+  int r = is_remat(rhs) ? -1 : rhs->reg;
+
+  if (inst->op == IR_MUL) {
+    if (rhs->op != IR_CONST || (rhs->imm != 3 && rhs->imm != 5 && rhs->imm != 9))
+      return false;
+    if (l < 0) {
+      load_value(d, lhs);
+      l = d;
+    }
+    println("  lea %s, [%s+%s*%ld]", reg(d, inst->size), reg(l, 8), reg(l, 8), rhs->imm - 1);
+    store_result(d, inst);
+    return true;
+  }
+
+  // 左辺が結果のレジスターにあるなら、add や sub の方が短い
+  if (l < 0 || l == d)
+    return false;
+  if (rhs->op == IR_CONST) {
+    int64_t disp = inst->op == IR_ADD ? rhs->imm : -rhs->imm;
+    if (disp < INT32_MIN || INT32_MAX < disp)
+      return false;
+    println("  lea %s, %ld[%s]", reg(d, inst->size), disp, reg(l, 8));
+  } else if (inst->op == IR_ADD && r >= 0 && r != d) {
+    println("  lea %s, [%s+%s]", reg(d, inst->size), reg(l, 8), reg(r, 8));
+  } else {
+    return false;
+  }
+  store_result(d, inst);
+  return true;
+}
+
+// 定数の幅のシフト
+static void emit_shift(char *name, Inst *inst) {
+  int d = dest_reg(inst);
+  load_value(d, inst->args[0]);
+  println("  %s %s, %ld", name, reg(d, inst->size), inst->imm);
+  store_result(d, inst);
+}
+
+// 比較の結果を al に入れる setcc 命令
+static char *setcc(IrOp op) {
+  switch (op) {
+  case IR_EQ: return "sete";
+  case IR_NE: return "setne";
+  case IR_LT: return "setl";
+  case IR_LE: return "setle";
+  }
+  error("unreachable: setcc");
+}
+
+// 比較が成り立つときに飛ぶ条件つきジャンプ。negate が真なら成り立たないときに飛ぶ
+static char *jcc(IrOp op, bool negate) {
+  switch (op) {
+  case IR_EQ: return negate ? "jne" : "je";
+  case IR_NE: return negate ? "je" : "jne";
+  case IR_LT: return negate ? "jge" : "jl";
+  case IR_LE: return negate ? "jg" : "jle";
+  }
+  error("unreachable: jcc");
+}
+
+// lhs と rhs を比べてフラグを立てる。左辺がレジスターになければ rax に読んでから比べる
+static void emit_cmp(Inst *lhs, Inst *rhs) {
+  int size = lhs->size;
+  int l = is_remat(lhs) ? -1 : lhs->reg;
+  if (l < 0) {
+    load_value(RAX, lhs);
+    l = RAX;
+  }
+  println("  cmp %s, %s", reg(l, size), operand(rhs, size));
+}
+
+// 比較
+static void emit_compare(Inst *inst) {
+  emit_cmp(inst->args[0], inst->args[1]);
+  int d = dest_reg(inst);
+  println("  %s %s", setcc(inst->op), reg(d, 1));
+  println("  movzx %s, %s", reg(d, 4), reg(d, 1));
+  store_result(d, inst);
+}
+
+// ブロックの最後の分岐。飛び先が次に出力するブロックなら、飛ばずに続ける
+static void emit_branch(Inst *inst) {
+  Block *next = inst->block->next;
+  if (inst->op == IR_JMP) {
+    if (inst->targets[0] != next)
+      println("  jmp %s", label(inst->targets[0]));
+    return;
+  }
+  // 命令選択で比較を覆った分岐は、2つのオペランドを直接比べる。
+  // cmp と条件つきジャンプが並ぶので、CPU が1つの命令にまとめて (macro-fusion) 実行する
+  IrOp op = IR_NE;
+  if (inst->num_args == 2) {
+    op = inst->imm;
+    emit_cmp(inst->args[0], inst->args[1]);
+  } else {
+    Inst *cond = inst->args[0];
+    if (is_remat(cond)) {
+      load_value(RAX, cond);
+      println("  cmp %s, 0", reg(RAX, cond->size));
+    } else {
+      println("  cmp %s, 0", operand(cond, cond->size));
+    }
+  }
+  if (inst->targets[0] == next) {
+    println("  %s %s", jcc(op, true), label(inst->targets[1]));
+    return;
+  }
+  println("  %s %s", jcc(op, false), label(inst->targets[0]));
+  if (inst->targets[1] != next) {
+    println("  jmp %s", label(inst->targets[1]));
+  }
+}
+
+// 関数から戻る。保存しておいた callee-saved のレジスターを戻す
+static void emit_epilogue() {
+  for (int i = 0; i < NUM_CALLEE_SAVED; i++)
+    if (save_slots[callee_saved[i]])
+      println("  mov %s, %d[rbp]", reg(callee_saved[i], 8), save_slots[callee_saved[i]]);
+  println("  leave");
+  println("  ret");
+}
+
+// 命令を1つ出力する
+static void emit_inst(Inst *inst) {
+  switch (inst->op) {
+  case IR_CONST:
+  case IR_ALLOCA:
+  case IR_GADDR:
+  case IR_SADDR:
+    // 使うところで作る
+    return;
+  case IR_PARAM:
+    // 関数の入口でまとめて移してある
+    return;
+  case IR_PHI:
+    // 前のブロックの終わりで移してある
+    return;
+  case IR_LOAD: {
+    char *mem = mem_operand(inst);
+    int d = dest_reg(inst);
+    if (inst->mem_size == 1)
+      println("  movsx %s, BYTE PTR %s", reg(d, 4), mem);
+    else
+      println("  mov %s, %s %s", reg(d, inst->mem_size), ptr_size(inst->mem_size), mem);
+    store_result(d, inst);
+    return;
+  }
+  case IR_STORE: {
+    char *mem = mem_operand(inst);
+    Inst *val = inst->args[1];
+    char *src;
+    if (val->op == IR_CONST) {
+      // 即値は書く大きさに切り詰めておく。はみ出した即値はアセンブラーが警告する
+      int64_t imm = val->imm;
+      if (inst->mem_size == 1)
+        imm = (int8_t)imm;
+      else if (inst->mem_size == 4)
+        imm = (int32_t)imm;
+      src = new_operand_buf();
+      sprintf(src, "%ld", imm);
+    } else if (is_remat(val) || val->reg < 0) {
+      load_value(RAX, val);
+      src = reg(RAX, inst->mem_size);
+    } else {
+      src = reg(val->reg, inst->mem_size);
+    }
+    println("  mov %s %s, %s", ptr_size(inst->mem_size), mem, src);
+    return;
+  }
+  case IR_ADD:
+    if (!emit_lea(inst))
+      emit_binop("add", inst);
+    return;
+  case IR_SUB:
+    if (!emit_lea(inst))
+      emit_binop("sub", inst);
+    return;
+  case IR_MUL:
+    if (!emit_lea(inst))
+      emit_binop("imul", inst);
+    return;
+  case IR_DIV: {
+    Inst *rhs = inst->args[1];
+    load_value(RAX, inst->args[0]);
+    // idiv は即値を取れないので、定数やアドレスは r11 に読む
+    char *divisor;
+    if (is_remat(rhs)) {
+      load_value(R11, rhs);
+      divisor = reg(R11, inst->size);
+    } else {
+      divisor = operand(rhs, inst->size);
+    }
+    // 割られる数を rdx:rax (edx:eax) に符号拡張してから割る
+    println("  %s", inst->size == 8 ? "cqo" : "cdq");
+    println("  idiv %s", divisor);
+    store_result(RAX, inst);
+    return;
+  }
+  case IR_SHL:
+    emit_shift("shl", inst);
+    return;
+  case IR_SAR:
+    emit_shift("sar", inst);
+    return;
+  case IR_SHR:
+    emit_shift("shr", inst);
+    return;
+  case IR_MULHI: {
+    // int を 64 ビットに符号拡張してから掛け、積の上位 32 ビットを下に降ろす
+    Inst *val = inst->args[0];
+    int d = dest_reg(inst);
+    if (is_remat(val)) {
+      load_value(d, val);
+      println("  movsxd %s, %s", reg(d, 8), reg(d, 4));
+    } else {
+      println("  movsxd %s, %s", reg(d, 8), operand(val, 4));
+    }
+    println("  imul %s, %s, %ld", reg(d, 8), reg(d, 8), inst->imm);
+    println("  sar %s, 32", reg(d, 8));
+    store_result(d, inst);
+    return;
+  }
+  case IR_EQ:
+  case IR_NE:
+  case IR_LT:
+  case IR_LE:
+    emit_compare(inst);
+    return;
+  case IR_SEXT: {
+    Inst *val = inst->args[0];
+    int d = dest_reg(inst);
+    if (is_remat(val)) {
+      load_value(d, val);
+      println("  movsxd %s, %s", reg(d, 8), reg(d, 4));
+    } else {
+      println("  movsxd %s, %s", reg(d, 8), operand(val, 4));
+    }
+    store_result(d, inst);
+    return;
+  }
+  case IR_TRUNC: {
+    Inst *val = inst->args[0];
+    int d = dest_reg(inst);
+    if (is_remat(val)) {
+      load_value(d, val);
+      val = NULL;
+    }
+    char *src = val ? operand(val, inst->mem_size) : reg(d, inst->mem_size);
+    if (inst->mem_size == 1)
+      println("  movsx %s, %s", reg(d, 4), src);
+    else
+      println("  mov %s, %s", reg(d, 4), src);
+    store_result(d, inst);
+    return;
+  }
+  case IR_CALL:
+    emit_call(inst);
+    return;
+  case IR_JMP:
+  case IR_BR:
+    emit_branch(inst);
+    return;
+  case IR_RET:
+    load_value(RAX, inst->args[0]);
+    emit_epilogue();
+    return;
+  }
+  error("unreachable: emit_inst");
+}
+
+// スタック上の場所を決める。フレームの大きさを返す
+// ローカル変数は -O0 と同じく、宣言のときに決めた rbp からのオフセットに置く。
+// その下にレジスターに入りきらなかった値、さらにその下に callee-saved の
+// レジスターを保存する場所をとる
+static int assign_slots(IrFunc *f) {
+  LVar *locals = f->def->func->locals;
+  int offset = locals ? locals->offset : 0;
+  // 値の場所は 8 バイト境界に揃える
+  offset = (offset + 7) & ~7;
+  bool used[NUM_REGS] = {false};
+  for (Block *b = f->entry; b; b = b->next) {
+    for (Inst *inst = b->first; inst; inst = inst->next) {
+      if (inst->op == IR_ALLOCA) {
+        inst->slot = -inst->var->offset;
+      } else if (inst->size && !is_remat(inst)) {
+        if (inst->reg >= 0) {
+          used[inst->reg] = true;
+        } else {
+          offset += 8;
+          inst->slot = -offset;
+        }
+      }
+    }
+  }
+  for (int i = 0; i < NUM_CALLEE_SAVED; i++) {
+    int r = callee_saved[i];
+    save_slots[r] = 0;
+    if (used[r]) {
+      offset += 8;
+      save_slots[r] = -offset;
+    }
+  }
+  // call の時点でスタックが 16 バイト境界に揃うようにする
+  return (offset + 15) & ~15;
+}
+
+// 仮引数を、引数のレジスターやスタックから割り当てた場所に移す
+static void emit_params(IrFunc *f) {
+  int n = 0;
+  for (Inst *inst = f->entry->first; inst; inst = inst->next)
+    if (inst->op == IR_PARAM)
+      n++;
+  Move *moves = arena_alloc(cur_arena, sizeof(Move) * n);
+  n = 0;
+  for (Inst *inst = f->entry->first; inst; inst = inst->next) {
+    if (inst->op != IR_PARAM)
+      continue;
+    Move m = {-1, 0, -1, 0, NULL, NULL, inst->size, false};
+    move_to(&m, inst);
+    if (inst->imm < NUM_ARG_REGS) {
+      m.src = arg_regs[inst->imm];
+    } else {
+      // 7 番目からの引数は、戻りアドレスと呼び出し時点の rbp の上に積まれている
+      m.src_mem = arena_alloc(cur_arena, 32);
+      sprintf(m.src_mem, "%ld[rbp]", 16 + (inst->imm - NUM_ARG_REGS) * 8);
+    }
+    moves[n++] = m;
+  }
+  emit_moves(moves, n);
+}
+
+// 関数の IR からアセンブリを出力する
+void emit_ir(IrFunc *f) {
+  cur_ir = f;
+  char *name = atom_name(f->def->func->name);
+  int frame_size = assign_slots(f);
+  println(".globl %s", name);
+  println("%s:", name);
+  println("  push rbp");
+  println("  mov rbp, rsp");
+  if (frame_size)
+    println("  sub rsp, %d", frame_size);
+  for (int i = 0; i < NUM_CALLEE_SAVED; i++)
+    if (save_slots[callee_saved[i]])
+      println("  mov %d[rbp], %s", save_slots[callee_saved[i]], reg(callee_saved[i], 8));
+  emit_params(f);
+  for (Block *b = f->entry; b; b = b->next) {
+    println("%s:", label(b));
+    for (Inst *inst = b->first; inst; inst = inst->next) {
+      if (inst == b->last)
+        emit_phi_moves(b);
+      emit_inst(inst);
+    }
+  }
+  cur_ir = NULL;
+}
+
+// 関数定義を IR にして、最適化し、レジスターを割り当ててから出力する
+void gen_ir(Node *def) {
+  IrFunc *f = lower_func(def);
+  run_passes(f);
+  if (dump_ir)
+    print_ir(f);
+  allocate_registers(f);
+  emit_ir(f);
+}
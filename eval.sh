@@ -1,7 +1,6 @@
 #!/bin/bash
 
-echo "$1" > tmp.c
-./nanocc tmp.c > tmp.s
+echo "$1" | ./nanocc - > tmp.s
 cc -o tmp tmp.s
 ./tmp
-echo $?
\ No newline at end of file
+echo $?
@@ -0,0 +1,203 @@
+#include "nanocc.h"
+
+// 定数の畳み込み (constant folding) と定数の伝播 (constant propagation)
+// コード生成の前に、関数の本体の AST をその場で書き換える。
+//
+// 両辺が整数の二項演算は、計算した結果の整数のノードに置き換える。
+// コード生成は 64 ビットのレジスターで計算するので、ここでも 64 ビットで計算し、
+// 結果が int に収まるときだけ置き換える。0 での割り算や、int に収まらない結果は
+// 実行時に計算させる。
+//
+// ローカル変数のうち、アドレスを取られず、関数の中でちょうど1回だけ定数を
+// 代入されるものは、読むところをその定数に置き換える。代入より前に読むのは
+// 初期化していない変数を読むことになるので、その値を定数としてしまってよい。
+// 置き換えた結果さらに定数になる式があるので、新しい定数が見つからなくなるまで繰り返す
+
+// ローカル変数ごとの情報。LVar の index で引く
+typedef struct {
+  int num_assigns; // 変数そのものへの代入の回数
+  bool addr_taken; // & でアドレスを取られているか
+  bool is_const;   // 定数を1回だけ代入されるので、定数に置き換えてよいか
+  int val;         // 置き換える定数
+} VarInfo;
+
+// 畳み込んでいる関数のローカル変数の情報
+static _Thread_local VarInfo *var_info;
+// 直前の繰り返しで新しい定数が見つかったか
+static _Thread_local bool found_const;
+
+static void fold_node(Node *node);
+
+// 変数への代入とアドレスを取る式を数える
+static void count_vars(Node *node) {
+  if (!node)
+    return;
+  switch (node->kind) {
+  case ND_NUM:
+  case ND_STRING:
+  case ND_LVAR:
+  case ND_GVAR:
+  case ND_DECL:
+    return;
+  case ND_ASSIGN:
+    if (node->lhs->kind == ND_LVAR)
+      var_info[node->lhs->var->index].num_assigns++;
+    else
+      count_vars(node->lhs);
+    count_vars(node->rhs);
+    return;
+  case ND_ADDR:
+    if (node->lhs->kind == ND_LVAR)
+      var_info[node->lhs->var->index].addr_taken = true;
+    else
+      count_vars(node->lhs);
+    return;
+  case ND_IF:
+  case ND_WHILE:
+  case ND_FOR:
+    count_vars(node->cond);
+    count_vars(node->lhs);
+    count_vars(node->rhs);
+    if (node->kind == ND_FOR)
+      count_vars(node->body);
+    return;
+  case ND_BLOCK:
+    for (Node *stmt = node->body; stmt; stmt = stmt->next)
+      count_vars(stmt);
+    return;
+  case ND_CALL:
+    for (int i = 0; i < node->argc; i++)
+      count_vars(node->args[i]);
+    return;
+  }
+  count_vars(node->lhs);
+  count_vars(node->rhs);
+}
+
+// 値が val の int の値を持つノードに置き換える
+static void replace_with_num(Node *node, int64_t val) {
+  node->kind = ND_NUM;
+  node->lhs = NULL;
+  node->rhs = NULL;
+  node->val = val;
+  node->type = basic_type(INT);
+}
+
+// 両辺が整数の二項演算を計算する。畳み込めれば真を返して結果を *val に入れる
+static bool eval_binary(NodeKind kind, int64_t lhs, int64_t rhs, int64_t *val) {
+  switch (kind) {
+  case ND_ADD: *val = lhs + rhs; break;
+  case ND_SUB: *val = lhs - rhs; break;
+  case ND_MUL: *val = lhs * rhs; break;
+  case ND_DIV:
+    if (rhs == 0)
+      return false;
+    // C の割り算も idiv も 0 の方向に切り捨てる
+    *val = lhs / rhs;
+    break;
+  case ND_EQ: *val = lhs == rhs; break;
+  case ND_NEQ: *val = lhs != rhs; break;
+  case ND_LT: *val = lhs < rhs; break;
+  case ND_LTE: *val = lhs <= rhs; break;
+  default:
+    return false;
+  }
+  return INT32_MIN <= *val && *val <= INT32_MAX;
+}
+
+// 左辺値の中の式を畳み込む。変数そのものは定数に置き換えない
+static void fold_lval(Node *node) {
+  if (node->kind == ND_DEREF)
+    fold_node(node->lhs);
+}
+
+// 変数 var に定数 val を代入したことを覚える
+static void record_assign(LVar *var, Node *rhs) {
+  VarInfo *info = &var_info[var->index];
+  if (info->is_const || info->num_assigns != 1 || info->addr_taken)
+    return;
+  if (rhs->kind != ND_NUM)
+    return;
+  // 読むときと同じ値になるように、変数の大きさに切り詰めておく
+  if (var->type->kind == INT) {
+    info->val = rhs->val;
+  } else if (var->type->kind == CHAR) {
+    info->val = (signed char)rhs->val;
+  } else {
+    return;
+  }
+  info->is_const = true;
+  found_const = true;
+}
+
+// node とその下の式を畳み込む
+static void fold_node(Node *node) {
+  if (!node)
+    return;
+  switch (node->kind) {
+  case ND_NUM:
+  case ND_STRING:
+  case ND_GVAR:
+  case ND_DECL:
+    return;
+  case ND_LVAR: {
+    VarInfo *info = &var_info[node->var->index];
+    if (info->is_const)
+      replace_with_num(node, info->val);
+    return;
+  }
+  case ND_ASSIGN:
+    fold_lval(node->lhs);
+    fold_node(node->rhs);
+    if (node->lhs->kind == ND_LVAR)
+      record_assign(node->lhs->var, node->rhs);
+    return;
+  case ND_ADDR:
+    fold_lval(node->lhs);
+    return;
+  case ND_IF:
+  case ND_WHILE:
+  case ND_FOR:
+    fold_node(node->cond);
+    fold_node(node->lhs);
+    fold_node(node->rhs);
+    if (node->kind == ND_FOR)
+      fold_node(node->body);
+    return;
+  case ND_BLOCK:
+    for (Node *stmt = node->body; stmt; stmt = stmt->next)
+      fold_node(stmt);
+    return;
+  case ND_CALL:
+    for (int i = 0; i < node->argc; i++)
+      fold_node(node->args[i]);
+    return;
+  case ND_RETURN:
+  case ND_DEREF:
+    fold_node(node->lhs);
+    return;
+  }
+
+  // 二項演算
+  fold_node(node->lhs);
+  fold_node(node->rhs);
+  int64_t val;
+  if (node->lhs->kind == ND_NUM && node->rhs->kind == ND_NUM &&
+      eval_binary(node->kind, node->lhs->val, node->rhs->val, &val))
+    replace_with_num(node, val);
+}
+
+// 関数の本体を畳み込む
+void fold_func(Function *fn) {
+  int num_vars = fn->locals ? fn->locals->index + 1 : 0;
+  var_info = arena_alloc(&fn->arena, sizeof(VarInfo) * num_vars);
+  count_vars(fn->body);
+  // 仮引数は呼び出し側から値を受け取っているので、定数にはしない
+  for (int i = 0; i < fn->argc; i++)
+    var_info[i].num_assigns++;
+  do {
+    found_const = false;
+    fold_node(fn->body);
+  } while (found_const);
+  var_info = NULL;
+}
@@ -0,0 +1,391 @@
+#include "nanocc.h"
+
+// IR の命令とブロックを作る関数と、制御フローグラフ (CFG) と支配木を求める関数
+// IR はコード生成中の関数のアリーナ (cur_arena) に置き、関数ごとにまとめて解放する
+
+// 最適化の水準 の定義
+int opt_level = 1;
+
+// IR を表示するか の定義
+bool dump_ir;
+
+// 新しいブロックを作って、関数のブロックのリストの末尾に足す
+Block *new_block(IrFunc *f) {
+  Block *block = arena_alloc(cur_arena, sizeof(Block));
+  block->id = f->num_blocks++;
+  block->rpo = -1;
+  if (f->last)
+    f->last->next = block;
+  else
+    f->entry = block;
+  f->last = block;
+  return block;
+}
+
+// 新しいブロックを作って、関数のブロックのリストで pos の直後に入れる
+Block *new_block_after(IrFunc *f, Block *pos) {
+  Block *block = arena_alloc(cur_arena, sizeof(Block));
+  block->id = f->num_blocks++;
+  block->rpo = -1;
+  block->next = pos->next;
+  pos->next = block;
+  if (f->last == pos)
+    f->last = block;
+  return block;
+}
+
+// 新しい命令を作る。size はその命令が定義する値の大きさ
+Inst *new_inst(IrOp op, int size) {
+  Inst *inst = arena_alloc(cur_arena, sizeof(Inst));
+  inst->op = op;
+  inst->size = size;
+  return inst;
+}
+
+// 命令のオペランドの末尾に arg を足す
+void add_arg(Inst *inst, Inst *arg) {
+  if (inst->num_args == inst->cap_args) {
+    int cap = inst->cap_args ? inst->cap_args * 2 : 2;
+    Inst **args = arena_alloc(cur_arena, sizeof(Inst *) * cap);
+    // 初めて確保するときは inst->args が NULL なので写さない
+    if (inst->num_args)
+      memcpy(args, inst->args, sizeof(Inst *) * inst->num_args);
+    inst->args = args;
+    inst->cap_args = cap;
+  }
+  inst->args[inst->num_args++] = arg;
+  arg->num_uses++;
+}
+
+// phi のオペランドの末尾に、pred から来たときの値 val を足す
+void add_phi_arg(Inst *phi, Inst *val, Block *pred) {
+  // phi_preds は args と同じ大きさで確保する
+  if (phi->num_args == phi->cap_args) {
+    int cap = phi->cap_args ? phi->cap_args * 2 : 2;
+    Block **preds = arena_alloc(cur_arena, sizeof(Block *) * cap);
+    if (phi->num_args)
+      memcpy(preds, phi->phi_preds, sizeof(Block *) * phi->num_args);
+    phi->phi_preds = preds;
+  }
+  phi->phi_preds[phi->num_args] = pred;
+  add_arg(phi, val);
+}
+
+// 命令の i 番目のオペランドを val に置き換える
+void replace_arg(Inst *inst, int i, Inst *val) {
+  inst->args[i]->num_uses--;
+  inst->args[i] = val;
+  val->num_uses++;
+}
+
+// ブロックの末尾に命令を足す
+void append_inst(Block *block, Inst *inst) {
+  inst->block = block;
+  inst->prev = block->last;
+  inst->next = NULL;
+  if (block->last)
+    block->last->next = inst;
+  else
+    block->first = inst;
+  block->last = inst;
+}
+
+// 命令 pos の直前に命令を入れる
+void insert_before(Inst *pos, Inst *inst) {
+  Block *block = pos->block;
+  inst->block = block;
+  inst->prev = pos->prev;
+  inst->next = pos;
+  if (pos->prev)
+    pos->prev->next = inst;
+  else
+    block->first = inst;
+  pos->prev = inst;
+}
+
+// 命令をブロックから取り除く。オペランドの値は使われなくなる
+void remove_inst(Inst *inst) {
+  Block *block = inst->block;
+  if (inst->prev)
+    inst->prev->next = inst->next;
+  else
+    block->first = inst->next;
+  if (inst->next)
+    inst->next->prev = inst->prev;
+  else
+    block->last = inst->prev;
+  for (int i = 0; i < inst->num_args; i++)
+    inst->args[i]->num_uses--;
+  inst->num_args = 0;
+  inst->block = NULL;
+}
+
+// ブロックの後に来うるブロックの数
+int num_succs(Block *block) {
+  Inst *term = block->last;
+  if (term->op == IR_JMP)
+    return 1;
+  if (term->op == IR_BR)
+    return 2;
+  return 0;
+}
+
+// ブロックの後に来うる i 番目のブロック
+Block *succ(Block *block, int i) {
+  return block->last->targets[i];
+}
+
+// pred を block の前に来うるブロックとして足す
+static void add_pred(Block *block, Block *pred) {
+  if (block->num_preds == block->cap_preds) {
+    int cap = block->cap_preds ? block->cap_preds * 2 : 4;
+    Block **preds = arena_alloc(cur_arena, sizeof(Block *) * cap);
+    if (block->num_preds)
+      memcpy(preds, block->preds, sizeof(Block *) * block->num_preds);
+    block->preds = preds;
+    block->cap_preds = cap;
+  }
+  block->preds[block->num_preds++] = pred;
+}
+
+// 各ブロックの前に来うるブロックと、入口からたどり着けるブロックの逆後順を求める
+// ブロックの並びや飛び先を変えたら、もう一度呼ぶ
+void compute_cfg(IrFunc *f) {
+  for (Block *b = f->entry; b; b = b->next) {
+    b->num_preds = 0;
+    b->rpo = -1;
+  }
+  // 入口から深さ優先でたどり、後順に並べる。再帰はせず、自前のスタックを使う
+  Block **stack = arena_alloc(cur_arena, sizeof(Block *) * f->num_blocks);
+  int *next_succ = arena_alloc(cur_arena, sizeof(int) * f->num_blocks);
+  Block **post = arena_alloc(cur_arena, sizeof(Block *) * f->num_blocks);
+  int num_post = 0;
+  int depth = 0;
+  stack[depth++] = f->entry;
+  // 訪れたブロックの印として、rpo をいったん 0 にしておく
+  f->entry->rpo = 0;
+  while (depth > 0) {
+    Block *b = stack[depth - 1];
+    if (next_succ[b->id] < num_succs(b)) {
+      Block *s = succ(b, next_succ[b->id]++);
+      if (s->rpo < 0) {
+        s->rpo = 0;
+        stack[depth++] = s;
+      }
+      continue;
+    }
+    post[num_post++] = b;
+    depth--;
+  }
+  f->rpo = arena_alloc(cur_arena, sizeof(Block *) * num_post);
+  f->num_rpo = num_post;
+  for (int i = 0; i < num_post; i++) {
+    f->rpo[i] = post[num_post - 1 - i];
+    f->rpo[i]->rpo = i;
+  }
+  // たどり着けるブロックからの辺だけを数える
+  for (int i = 0; i < f->num_rpo; i++) {
+    Block *b = f->rpo[i];
+    for (int j = 0; j < num_succs(b); j++)
+      add_pred(succ(b, j), b);
+  }
+}
+
+// 支配木で a と b の共通の祖先のうち、もっとも近いもの
+static Block *intersect(Block *a, Block *b) {
+  while (a != b) {
+    while (a->rpo > b->rpo)
+      a = a->idom;
+    while (b->rpo > a->rpo)
+      b = b->idom;
+  }
+  return a;
+}
+
+// 各ブロックの直接の支配ブロックを求める
+// Cooper, Harvey, Kennedy の "A Simple, Fast Dominance Algorithm" による
+// compute_cfg の後で呼ぶ
+void compute_dominators(IrFunc *f) {
+  for (int i = 0; i < f->num_rpo; i++)
+    f->rpo[i]->idom = NULL;
+  f->entry->idom = f->entry;
+  for (bool changed = true; changed;) {
+    changed = false;
+    for (int i = 1; i < f->num_rpo; i++) {
+      Block *b = f->rpo[i];
+      Block *idom = NULL;
+      for (int j = 0; j < b->num_preds; j++) {
+        Block *p = b->preds[j];
+        if (!p->idom)
+          continue;
+        idom = idom ? intersect(p, idom) : p;
+      }
+      if (b->idom != idom) {
+        b->idom = idom;
+        changed = true;
+      }
+    }
+  }
+}
+
+// ブロック a がブロック b を支配するか。入口から b へのどの道も a を通るなら真
+bool dominates(Block *a, Block *b) {
+  while (b != a && b->idom != b)
+    b = b->idom;
+  return b == a;
+}
+
+// 値を使うところで作り直せるか。定数と変数のアドレスは、レジスターに
+// 置いておかずに、使う命令の中で作る
+bool is_remat(Inst *inst) {
+  return inst->op == IR_CONST || inst->op == IR_ALLOCA ||
+         inst->op == IR_GADDR || inst->op == IR_SADDR;
+}
+
+// 命令選択 (isel.c) でアドレスを base + index * scale + disp の形にした IR_LOAD, IR_STORE の index
+// base は args[0]、index は最後のオペランド、disp は imm。index がなければ NULL
+Inst *mem_index(Inst *inst) {
+  return inst->scale ? inst->args[inst->num_args - 1] : NULL;
+}
+
+// 命令の種類の名前
+static char *op_names[] = {
+  [IR_CONST] = "const", [IR_PARAM] = "param", [IR_ALLOCA] = "alloca",
+  [IR_GADDR] = "gaddr", [IR_SADDR] = "saddr", [IR_LOAD] = "load",
+  [IR_STORE] = "store", [IR_ADD] = "add", [IR_SUB] = "sub", [IR_MUL] = "mul",
+  [IR_DIV] = "div", [IR_SHL] = "shl", [IR_SAR] = "sar", [IR_SHR] = "shr",
+  [IR_MULHI] = "mulhi", [IR_EQ] = "eq", [IR_NE] = "ne", [IR_LT] = "lt",
+  [IR_LE] = "le", [IR_SEXT] = "sext", [IR_TRUNC] = "trunc", [IR_PHI] = "phi",
+  [IR_CALL] = "call", [IR_JMP] = "jmp", [IR_BR] = "br", [IR_RET] = "ret",
+};
+
+// 検証の直前に動かしたパスの名前
+static char *verify_pass;
+
+// IR の検証に失敗したことを報告する
+static void verify_error(IrFunc *f, Inst *inst, char *msg) {
+  print_ir(f);
+  error("%s: %s の後の IR の検証に失敗しました: v%d (%s): %s",
+        atom_name(f->def->func->name), verify_pass, inst->id, op_names[inst->op], msg);
+}
+
+// IR が正しい形になっているかを確かめる
+// 値の定義がすべての使用を支配していること (SSA 形式の条件) なども確かめる
+// compute_dominators の後で呼ぶ。pass はその直前に動かしたパスの名前
+void verify_ir(IrFunc *f, char *pass) {
+  verify_pass = pass;
+  // 使用の数は、たどり着けないブロックの命令も含めて数える
+  int *uses = arena_alloc(cur_arena, sizeof(int) * f->num_values);
+  for (Block *b = f->entry; b; b = b->next)
+    for (Inst *inst = b->first; inst; inst = inst->next)
+      for (int j = 0; j < inst->num_args; j++)
+        uses[inst->args[j]->id]++;
+  for (Block *b = f->entry; b; b = b->next)
+    for (Inst *inst = b->first; inst; inst = inst->next)
+      if (uses[inst->id] != inst->num_uses)
+        verify_error(f, inst, "使用の数が正しくありません");
+
+  for (int i = 0; i < f->num_rpo; i++) {
+    Block *b = f->rpo[i];
+    if (!b->last)
+      error("%s: %s の後の IR の検証に失敗しました: b%d が空です",
+            atom_name(f->def->func->name), pass, b->id);
+    for (Inst *inst = b->first; inst; inst = inst->next) {
+      bool is_term = inst->op == IR_JMP || inst->op == IR_BR || inst->op == IR_RET;
+      if (is_term != (inst == b->last))
+        verify_error(f, inst, "ブロックの終わりの命令の位置が正しくありません");
+      if (inst->block != b)
+        verify_error(f, inst, "命令の入っているブロックが正しくありません");
+      if (inst->op == IR_PHI) {
+        if (inst->prev && inst->prev->op != IR_PHI)
+          verify_error(f, inst, "phi がブロックの先頭にありません");
+        if (inst->num_args != b->num_preds)
+          verify_error(f, inst, "phi のオペランドの数が前のブロックの数と違います");
+        for (int j = 0; j < inst->num_args; j++) {
+          bool found = false;
+          for (int k = 0; k < b->num_preds; k++)
+            if (b->preds[k] == inst->phi_preds[j])
+              found = true;
+          if (!found)
+            verify_error(f, inst, "phi のオペランドが前のブロックから来ていません");
+        }
+      }
+      for (int j = 0; j < inst->num_args; j++) {
+        Inst *arg = inst->args[j];
+        if (!arg->block || arg->block->rpo < 0)
+          verify_error(f, inst, "オペランドがどのブロックにも入っていません");
+        if (arg->size == 0)
+          verify_error(f, inst, "オペランドが値を持ちません");
+        bool ok;
+        if (inst->op == IR_PHI) {
+          // phi のオペランドは、前のブロックの終わりで使う
+          Block *pred = inst->phi_preds[j];
+          ok = arg->block == pred || dominates(arg->block, pred);
+        } else if (arg->block == b) {
+          // 同じブロックなら、オペランドが前にあるはず
+          ok = false;
+          for (Inst *p = inst->prev; p; p = p->prev)
+            if (p == arg)
+              ok = true;
+        } else {
+          ok = dominates(arg->block, b);
+        }
+        if (!ok)
+          verify_error(f, inst, "オペランドの定義が使用を支配していません");
+      }
+    }
+  }
+}
+
+// 関数の IR を標準エラー出力に表示する
+void print_ir(IrFunc *f) {
+  fprintf(stderr, "function %s\n", atom_name(f->def->func->name));
+  for (Block *b = f->entry; b; b = b->next) {
+    fprintf(stderr, "b%d:", b->id);
+    if (b->rpo < 0)
+      fprintf(stderr, " (unreachable)");
+    if (b->num_preds) {
+      fprintf(stderr, " preds");
+      for (int i = 0; i < b->num_preds; i++)
+        fprintf(stderr, " b%d", b->preds[i]->id);
+    }
+    if (b->idom && b->idom != b)
+      fprintf(stderr, " idom b%d", b->idom->id);
+    fprintf(stderr, "\n");
+    for (Inst *inst = b->first; inst; inst = inst->next) {
+      fprintf(stderr, "  ");
+      if (inst->size)
+        fprintf(stderr, "v%d:%d = ", inst->id, inst->size);
+      fprintf(stderr, "%s", op_names[inst->op]);
+      if (inst->op == IR_BR && inst->num_args == 2)
+        fprintf(stderr, " %s", op_names[inst->imm]);
+      if (inst->op == IR_LOAD || inst->op == IR_STORE || inst->op == IR_TRUNC)
+        fprintf(stderr, "%d", inst->mem_size);
+      if (inst->op == IR_CONST || inst->op == IR_PARAM)
+        fprintf(stderr, " %ld", inst->imm);
+      if (inst->op == IR_ALLOCA || inst->op == IR_GADDR)
+        fprintf(stderr, " %s", atom_name(inst->var->name));
+      if (inst->op == IR_SADDR)
+        fprintf(stderr, " .LC%d", inst->str->index);
+      if (inst->op == IR_CALL)
+        fprintf(stderr, " %s", atom_name(inst->name));
+      for (int i = 0; i < inst->num_args; i++) {
+        fprintf(stderr, "%s v%d", i ? "," : "", inst->args[i]->id);
+        if (inst->op == IR_PHI)
+          fprintf(stderr, " b%d", inst->phi_preds[i]->id);
+      }
+      if (inst->op == IR_SHL || inst->op == IR_SAR || inst->op == IR_SHR ||
+          inst->op == IR_MULHI)
+        fprintf(stderr, ", %ld", inst->imm);
+      if (inst->scale)
+        fprintf(stderr, " scale %d", inst->scale);
+      if ((inst->op == IR_LOAD || inst->op == IR_STORE) && inst->imm)
+        fprintf(stderr, " disp %ld", inst->imm);
+      if (inst->op == IR_JMP)
+        fprintf(stderr, " b%d", inst->targets[0]->id);
+      if (inst->op == IR_BR)
+        fprintf(stderr, ", b%d, b%d", inst->targets[0]->id, inst->targets[1]->id);
+      fprintf(stderr, "\n");
+    }
+  }
+}
@@ -0,0 +1,162 @@
+#include "nanocc.h"
+
+// 命令選択
+// IR の命令の木のうち、x86-64 のメモリーのオペランド1つで求められる部分を見つけて、
+// それを読み書きする命令にまとめる。IR_LOAD と IR_STORE のアドレスを求める
+// 足し算と定数倍の木を、base + index * scale + disp の形で覆う (タイリング)。
+// 覆った命令のオペランドのうち、覆いきれなかった base と index を
+// 読み書きする命令のオペランドにし、disp と scale は命令に持たせる。
+//
+// 覆うのは、読み書きする命令と同じブロックにあって、そこでしか使われない値だけ。
+// ほかでも使う値を覆うと、同じ計算をそれぞれのところでし直すことになる。
+// 覆った命令は使われなくなるので、後の dead-code-elimination が取り除く
+//
+// 同じように、IR_BR の条件が比較なら、その比較を IR_BR に覆う。
+// 比べた結果を 0 か 1 の値にしてから 0 と比べる代わりに、cmp と条件つきジャンプを出力できる
+
+// 1つのアドレスで覆う命令の数の上限
+#define MAX_COVERED 8
+
+// メモリーのオペランドの形
+typedef struct {
+  Inst *base;       // アドレスの値。変数や文字列のアドレスでもよい
+  Inst *index;      // scale 倍して足す値。なければ NULL
+  int scale;        // 1, 2, 4, 8 のどれか
+  int64_t disp;     // 足す定数
+  int num_covered;  // 覆った命令の数
+} AddrMode;
+
+// 32 ビットの符号つき整数に収まるか。x86 の disp と即値はこの範囲
+static bool fits_int32(int64_t val) {
+  return INT32_MIN <= val && val <= INT32_MAX;
+}
+
+// 値 val を、読み書きする命令 user のアドレスの木の内側として覆えるか
+static bool can_cover(Inst *val, Inst *user) {
+  return val->num_uses == 1 && val->block == user->block && val->size == 8;
+}
+
+// 値 val が定数を広げたり掛けたりしただけの覆える木なら、その値を *out に入れて真を返す
+// 配列の添字が定数のときの sext と掛け算を、disp にまとめるのに使う
+static bool const_value(Inst *val, Inst *user, int64_t *out) {
+  if (val->op == IR_CONST) {
+    *out = val->imm;
+    return true;
+  }
+  if (!can_cover(val, user))
+    return false;
+  int64_t a, b;
+  if (val->op == IR_SEXT && const_value(val->args[0], user, &a)) {
+    *out = a;
+    return true;
+  }
+  if (val->op == IR_MUL && const_value(val->args[0], user, &a) &&
+      const_value(val->args[1], user, &b) && fits_int32(a) && fits_int32(b)) {
+    *out = a * b;
+    return true;
+  }
+  return false;
+}
+
+// 値 val が x * 1, 2, 4, 8 の形で覆えるなら、その倍数を返す。覆えなければ 0
+static int scale_of(Inst *val, Inst *user) {
+  if (val->op != IR_MUL || !can_cover(val, user))
+    return 0;
+  Inst *c = val->args[1];
+  if (c->op != IR_CONST || val->args[0]->size != 8)
+    return 0;
+  if (c->imm == 1 || c->imm == 2 || c->imm == 4 || c->imm == 8)
+    return c->imm;
+  return 0;
+}
+
+// アドレスの値 val の木を、根から覆えるところまで覆う
+static void match_addr(AddrMode *am, Inst *val, Inst *user) {
+  while (am->num_covered < MAX_COVERED && can_cover(val, user)) {
+    if (val->op != IR_ADD && val->op != IR_SUB)
+      break;
+    Inst *lhs = val->args[0];
+    Inst *rhs = val->args[1];
+
+    // 定数を足し引きするなら disp にする
+    int64_t c;
+    if (val->op == IR_ADD && const_value(lhs, user, &c)) {
+      Inst *tmp = lhs;
+      lhs = rhs;
+      rhs = tmp;
+    }
+    if (const_value(rhs, user, &c)) {
+      int64_t disp = am->disp + (val->op == IR_ADD ? c : -c);
+      if (!fits_int32(disp))
+        break;
+      am->disp = disp;
+      am->num_covered++;
+      val = lhs;
+      continue;
+    }
+
+    // 2つの値を足すなら、片方を index にする
+    // 定数倍している方を index に、変数のアドレスは rbp や rip を使えるので base にする
+    if (val->op == IR_SUB || am->index)
+      break;
+    if (scale_of(lhs, user) || (is_remat(rhs) && !is_remat(lhs))) {
+      Inst *tmp = lhs;
+      lhs = rhs;
+      rhs = tmp;
+    }
+    if (lhs->size != 8 || rhs->size != 8)
+      break;
+    am->num_covered++;
+    int scale = scale_of(rhs, user);
+    if (scale && am->num_covered < MAX_COVERED) {
+      am->num_covered++;
+      am->index = rhs->args[0];
+      am->scale = scale;
+    } else {
+      am->index = rhs;
+      am->scale = 1;
+    }
+    val = lhs;
+  }
+  am->base = val;
+}
+
+// 読み書きする命令 inst のアドレスを、覆える形にする
+static void select_addr(Inst *inst) {
+  AddrMode am = {0};
+  match_addr(&am, inst->args[0], inst);
+  if (am.num_covered == 0)
+    return;
+  replace_arg(inst, 0, am.base);
+  if (am.index) {
+    add_arg(inst, am.index);
+    inst->scale = am.scale;
+  }
+  inst->imm = am.disp;
+}
+
+// 分岐 br の条件の比較を覆い、比較の2つのオペランドを直接比べて分岐する形にする
+static void select_branch(Inst *br) {
+  Inst *cond = br->args[0];
+  if (cond->op != IR_EQ && cond->op != IR_NE && cond->op != IR_LT && cond->op != IR_LE)
+    return;
+  if (cond->num_uses != 1 || cond->block != br->block)
+    return;
+  Inst *lhs = cond->args[0];
+  Inst *rhs = cond->args[1];
+  replace_arg(br, 0, lhs);
+  add_arg(br, rhs);
+  br->imm = cond->op;
+}
+
+// 関数のすべての IR_LOAD と IR_STORE のアドレスと、IR_BR の条件を覆う
+void select_instructions(IrFunc *f) {
+  for (Block *b = f->entry; b; b = b->next) {
+    for (Inst *inst = b->first; inst; inst = inst->next) {
+      if (inst->op == IR_LOAD || inst->op == IR_STORE)
+        select_addr(inst);
+      else if (inst->op == IR_BR)
+        select_branch(inst);
+    }
+  }
+}
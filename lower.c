@@ -0,0 +1,317 @@
+#include "nanocc.h"
+
+// AST から IR への変換 (lowering)
+// 関数の本体を文ごとにたどり、式は命令の並びに、if や while, for は
+// ブロックと分岐にする。ローカル変数はそれぞれ入口のブロックの IR_ALLOCA で
+// 領域をとり、IR_LOAD と IR_STORE で読み書きする。
+//
+// int と char の値は 32 ビット、ポインターは 64 ビットの値にする。
+// char は読むときに int に符号拡張する。ポインターと int を足し引きするときは、
+// int を 64 ビットに符号拡張して、指す型の大きさを掛けてから足し引きする
+
+// 変換中の関数と、命令を足していくブロック
+static IrFunc *cur_ir;
+static Block *cur_block;
+
+// ローカル変数の領域のアドレス。LVar の index で引く
+static Inst **allocas;
+
+static Inst *lower_expr(Node *node);
+static void lower_stmt(Node *node);
+
+// 型の値を持つ IR の値の大きさ。配列は先頭の要素へのポインターになる
+static int value_size(Type *type) {
+  if (type->kind == PTR || type->kind == ARRAY)
+    return 8;
+  return 4;
+}
+
+// ポインターか配列の型か
+static bool is_pointer(Type *type) {
+  return type->kind == PTR || type->kind == ARRAY;
+}
+
+// 命令に値の番号をつけて、いまのブロックの末尾に足す
+static Inst *emit(Inst *inst) {
+  inst->id = cur_ir->num_values++;
+  append_inst(cur_block, inst);
+  return inst;
+}
+
+// 大きさ size の定数
+static Inst *emit_const(int64_t val, int size) {
+  Inst *inst = new_inst(IR_CONST, size);
+  inst->imm = val;
+  return emit(inst);
+}
+
+// 二項演算の命令
+static Inst *emit_binary(IrOp op, int size, Inst *lhs, Inst *rhs) {
+  Inst *inst = new_inst(op, size);
+  add_arg(inst, lhs);
+  add_arg(inst, rhs);
+  return emit(inst);
+}
+
+// 値を size の大きさにする。int を 64 ビットにするときは符号拡張する
+// 64 ビットの値を int として使うときは、そのまま下位 32 ビットを使う
+static Inst *convert(Inst *val, int size) {
+  if (val->size >= size)
+    return val;
+  Inst *inst = new_inst(IR_SEXT, 8);
+  add_arg(inst, val);
+  return emit(inst);
+}
+
+// 飛び先のブロックに飛ぶ
+static void emit_jmp(Block *target) {
+  Inst *inst = new_inst(IR_JMP, 0);
+  inst->targets[0] = target;
+  emit(inst);
+}
+
+// cond が 0 でなければ then に、0 なら els に飛ぶ
+static void emit_br(Inst *cond, Block *then, Block *els) {
+  Inst *inst = new_inst(IR_BR, 0);
+  add_arg(inst, cond);
+  inst->targets[0] = then;
+  inst->targets[1] = els;
+  emit(inst);
+}
+
+// ブロックの末尾が分岐や return で終わっているか
+static bool terminated(Block *block) {
+  if (!block->last)
+    return false;
+  IrOp op = block->last->op;
+  return op == IR_JMP || op == IR_BR || op == IR_RET;
+}
+
+// 左辺値のアドレスを求める命令
+static Inst *lower_addr(Node *node) {
+  if (node->kind == ND_LVAR)
+    return allocas[node->var->index];
+  if (node->kind == ND_GVAR) {
+    Inst *inst = new_inst(IR_GADDR, 8);
+    inst->var = node->var;
+    return emit(inst);
+  }
+  if (node->kind == ND_DEREF)
+    return convert(lower_expr(node->lhs), 8);
+  error("代入の左辺値が変数またはデリファレンスではありません");
+}
+
+// addr の指す type 型の値を読む。配列なら先頭のアドレスがそのまま値になる
+static Inst *load(Inst *addr, Type *type) {
+  if (type->kind == ARRAY)
+    return addr;
+  Inst *inst = new_inst(IR_LOAD, value_size(type));
+  inst->mem_size = type_size(type);
+  add_arg(inst, addr);
+  return emit(inst);
+}
+
+// ポインターに足し引きする int の値 val に、指す型の大きさを掛ける
+static Inst *scale(Inst *val, Type *ptr_type) {
+  val = convert(val, 8);
+  int size = type_size(ptr_type->ptr_to);
+  if (size == 1)
+    return val;
+  return emit_binary(IR_MUL, 8, val, emit_const(size, 8));
+}
+
+// 足し算と引き算。ポインターの足し引きでは int の側を指す型の大きさ倍する
+static Inst *lower_add(Node *node) {
+  Inst *lhs = lower_expr(node->lhs);
+  Inst *rhs = lower_expr(node->rhs);
+  Type *lt = node->lhs->type;
+  Type *rt = node->rhs->type;
+  IrOp op = node->kind == ND_ADD ? IR_ADD : IR_SUB;
+  if (is_pointer(lt) && is_pointer(rt)) {
+    // ポインターどうしの引き算は、間にある要素の数
+    Inst *diff = emit_binary(IR_SUB, 8, lhs, rhs);
+    int size = type_size(lt->ptr_to);
+    if (size == 1)
+      return diff;
+    return emit_binary(IR_DIV, 8, diff, emit_const(size, 8));
+  }
+  if (is_pointer(lt))
+    return emit_binary(op, 8, lhs, scale(rhs, lt));
+  if (is_pointer(rt))
+    return emit_binary(op, 8, scale(lhs, rt), rhs);
+  return emit_binary(op, 4, lhs, rhs);
+}
+
+// 式の値を求める命令を足して、その値を返す
+static Inst *lower_expr(Node *node) {
+  switch (node->kind) {
+  case ND_NUM:
+    return emit_const(node->val, 4);
+  case ND_STRING: {
+    Inst *inst = new_inst(IR_SADDR, 8);
+    inst->str = node->string;
+    return emit(inst);
+  }
+  case ND_LVAR:
+  case ND_GVAR:
+    return load(lower_addr(node), node->type);
+  case ND_ADDR:
+    return lower_addr(node->lhs);
+  case ND_DEREF:
+    return load(convert(lower_expr(node->lhs), 8), node->type);
+  case ND_ASSIGN: {
+    Inst *addr = lower_addr(node->lhs);
+    Inst *val = lower_expr(node->rhs);
+    int mem_size = type_size(node->lhs->type);
+    if (mem_size == 8)
+      val = convert(val, 8);
+    Inst *inst = new_inst(IR_STORE, 0);
+    inst->mem_size = mem_size;
+    add_arg(inst, addr);
+    add_arg(inst, val);
+    emit(inst);
+    // 代入式の値は右辺の値
+    return val;
+  }
+  case ND_CALL: {
+    Inst *inst = new_inst(IR_CALL, value_size(node->type));
+    inst->name = node->name;
+    // char を返す関数の返り値は、下位 1 バイトを符号拡張して使う
+    inst->mem_size = type_size(node->type);
+    for (int i = 0; i < node->argc; i++)
+      add_arg(inst, lower_expr(node->args[i]));
+    return emit(inst);
+  }
+  case ND_ADD:
+  case ND_SUB:
+    return lower_add(node);
+  }
+
+  // 残りは int の二項演算と比較
+  Inst *lhs = lower_expr(node->lhs);
+  Inst *rhs = lower_expr(node->rhs);
+  // ポインターと比べるときは、両方を 64 ビットにして比べる
+  int size = lhs->size > rhs->size ? lhs->size : rhs->size;
+  lhs = convert(lhs, size);
+  rhs = convert(rhs, size);
+  switch (node->kind) {
+  case ND_MUL: return emit_binary(IR_MUL, size, lhs, rhs);
+  case ND_DIV: return emit_binary(IR_DIV, size, lhs, rhs);
+  case ND_EQ: return emit_binary(IR_EQ, 4, lhs, rhs);
+  case ND_NEQ: return emit_binary(IR_NE, 4, lhs, rhs);
+  case ND_LT: return emit_binary(IR_LT, 4, lhs, rhs);
+  case ND_LTE: return emit_binary(IR_LE, 4, lhs, rhs);
+  }
+  error("unreachable: lower_expr");
+}
+
+// 関数から val を返す
+static void emit_ret(Inst *val) {
+  Inst *inst = new_inst(IR_RET, 0);
+  add_arg(inst, convert(val, value_size(cur_ir->def->type)));
+  emit(inst);
+}
+
+// 文を IR にする
+static void lower_stmt(Node *node) {
+  switch (node->kind) {
+  case ND_DECL:
+    // 領域は入口のブロックでとってある
+    return;
+  case ND_BLOCK:
+    for (Node *stmt = node->body; stmt; stmt = stmt->next)
+      lower_stmt(stmt);
+    return;
+  case ND_RETURN:
+    emit_ret(lower_expr(node->lhs));
+    // return の後の文は、どこからも来ないブロックに入れておく
+    cur_block = new_block(cur_ir);
+    return;
+  case ND_IF: {
+    Block *then = new_block(cur_ir);
+    Block *els = node->rhs ? new_block(cur_ir) : NULL;
+    Block *end = new_block(cur_ir);
+    emit_br(lower_expr(node->cond), then, els ? els : end);
+    cur_block = then;
+    lower_stmt(node->lhs);
+    emit_jmp(end);
+    if (els) {
+      cur_block = els;
+      lower_stmt(node->rhs);
+      emit_jmp(end);
+    }
+    cur_block = end;
+    return;
+  }
+  case ND_WHILE:
+  case ND_FOR: {
+    // for の初期化式と増加式は省略できる
+    if (node->kind == ND_FOR && node->lhs)
+      lower_expr(node->lhs);
+    Block *cond = new_block(cur_ir);
+    Block *body = new_block(cur_ir);
+    Block *end = new_block(cur_ir);
+    emit_jmp(cond);
+    cur_block = cond;
+    emit_br(lower_expr(node->cond), body, end);
+    cur_block = body;
+    if (node->kind == ND_WHILE) {
+      lower_stmt(node->lhs);
+    } else {
+      lower_stmt(node->body);
+      if (node->rhs)
+        lower_expr(node->rhs);
+    }
+    emit_jmp(cond);
+    cur_block = end;
+    return;
+  }
+  }
+  // 式文。値は捨てる
+  lower_expr(node);
+}
+
+// 関数定義を IR にする
+IrFunc *lower_func(Node *def) {
+  Function *fn = def->func;
+  IrFunc *f = arena_alloc(cur_arena, sizeof(IrFunc));
+  f->def = def;
+  cur_ir = f;
+  cur_block = new_block(f);
+
+  // すべてのローカル変数の領域を入口でとる
+  int num_vars = fn->locals ? fn->locals->index + 1 : 0;
+  allocas = arena_alloc(cur_arena, sizeof(Inst *) * num_vars);
+  for (LVar *var = fn->locals; var; var = var->next) {
+    Inst *inst = new_inst(IR_ALLOCA, 8);
+    inst->var = var;
+    allocas[var->index] = emit(inst);
+  }
+  // 仮引数の値を、仮引数の変数の領域に書いておく
+  // 仮引数の変数は、関数の中で最初に登録した変数
+  for (int i = 0; i < fn->argc; i++) {
+    Inst *param = new_inst(IR_PARAM, value_size(fn->params[i]->type));
+    param->imm = i;
+    emit(param);
+    Inst *store = new_inst(IR_STORE, 0);
+    store->mem_size = type_size(fn->params[i]->type);
+    add_arg(store, allocas[i]);
+    add_arg(store, param);
+    emit(store);
+  }
+
+  lower_stmt(fn->body);
+
+  // 最後まで来たら 0 を返す
+  // return の後に作ったブロックも、どこかで終わらせておく
+  for (Block *b = f->entry; b; b = b->next) {
+    if (!terminated(b)) {
+      cur_block = b;
+      emit_ret(emit_const(0, 4));
+    }
+  }
+  allocas = NULL;
+  cur_ir = NULL;
+  cur_block = NULL;
+  return f;
+}
@@ -1,10 +1,20 @@
+// mmap の MAP_ANONYMOUS などを使えるようにする
+#define _DEFAULT_SOURCE
 #include "nanocc.h"
+// ファイルの読み込み: open, read, mmap など
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+// コード生成のスレッド
+#include <threads.h>
 
 // 入力プログラム の定義
 char *user_input;
 
-// 現在着目しているトークン の定義
-Token *token;
+// 現在着目しているトークンが、入力の先頭から何番目のトークンか の定義
+_Thread_local int token_pos;
 
 // ローカル変数リストの先頭アドレスを覚えておく
 // 新しい要素は先頭につないでいくので、先頭アドレスは最後に足した要素を指す
@@ -13,77 +23,291 @@ LVar *locals = NULL;
 // 指定されたファイルの内容を返す
 char *read_file(char *path);
 
+// アリーナの使用状況を表示するか
+static bool stats;
+
 // argc はコンパイラーへの引数の数(+1)
 // argv は引数の文字列の先頭へのポインターを納めた配列へのポインター
 int main(int argc, char **argv) {
-  if (argc <= 1 || 4 <= argc) {
+  if (argc <= 1) {
     fprintf(stderr, "引数の個数が正しくありません\n");
     return 1;
   }
 
-  // 第二引数をオプションにする
-  char *option;
-  if (argc == 3) {
-    option = argv[2];
-  } else {
-    option = "";
+  // 関数の本体は CPU の数だけのスレッドでパーズする
+  num_parse_threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+  // 第二引数からあとをオプションにする
+  bool bench = false; // -b: トークナイザーのベンチマーク
+  bool debug = false; // -d: AST を表示する
+  for (int i = 2; i < argc; i++) {
+    char *option = argv[i];
+    if (strcmp(option, "-b") == 0) {
+      bench = true;
+    } else if (strcmp(option, "-d") == 0) {
+      debug = true;
+    } else if (strcmp(option, "-s") == 0) {
+      // アリーナの使用状況を表示する
+      stats = true;
+    } else if (strcmp(option, "-f") == 0) {
+      // main から呼ばれない関数もコンパイルする
+      // -j1 と一緒に使うと、関数ごとにパーズしてすぐコードを生成する
+      compile_all_funcs = true;
+    } else if (strcmp(option, "-p") == 0) {
+      // 字句解析、構文解析、コード生成を別々のスレッドで動かす
+      pipeline = true;
+    } else if (strcmp(option, "-O0") == 0) {
+      // IR を使わずに、AST から直接アセンブリを出力する
+      opt_level = 0;
+    } else if (strcmp(option, "-O1") == 0) {
+      opt_level = 1;
+    } else if (strcmp(option, "-fno-peephole") == 0) {
+      // 出力する命令の並びにピープホール最適化をかけない
+      use_peephole = false;
+    } else if (strcmp(option, "-i") == 0) {
+      // 最適化した後の IR を表示し、パスごとに IR を検証する
+      dump_ir = true;
+    } else if (strncmp(option, "-j", 2) == 0) {
+      // N 個のスレッドで関数の本体をパーズする
+      num_parse_threads = atoi(option + 2);
+    } else {
+      fprintf(stderr, "不明なオプションです: %s\n", option);
+      return 1;
+    }
+  }
+  if (num_parse_threads < 1)
+    num_parse_threads = 1;
+  // パイプラインでは関数ごとにコードを生成するので、すべての関数を順にその場でパーズする
+  // AST を表示するときはパイプラインにしない
+  if (debug)
+    pipeline = false;
+  if (pipeline) {
+    compile_all_funcs = true;
+    num_parse_threads = 1;
   }
   
   // エラー表示に使うためにプログラムの先頭を指しておく
+  // ファイル名が "-" なら標準入力から読む
   filename = argv[1];
   user_input = read_file(filename);
 
-  // トークナイズする
-  token = tokenize(user_input);
+  // トークナイザーで使う文字の読み飛ばしを、CPU に合わせて選ぶ
+  init_scan();
+
+  if (bench) { // tokenizer benchmark
+    bench_tokenize(user_input);
+    return 0;
+  }
+
+  // トークナイズを始める
+  // トークンは構文解析で読み進めるのに合わせて作られる
+  // パイプラインでは、字句解析のスレッドが先にトークンを作っておく
+  if (pipeline)
+    start_lexer(user_input);
+  else
+    tokenize(user_input);
+
+  // AST を表示するときは、パーズしながらコードを生成しない
+  stream_funcs = !debug;
+  if (!debug) {
+    // intel記法を使う
+    printf(".intel_syntax noprefix\n");
+  }
 
   // 全体を文の並びとして構文解析する
+  if (pipeline)
+    start_codegen();
   program();
+  if (pipeline) {
+    finish_codegen();
+    finish_lexer();
+  }
 
-  if (strcmp(option, "-d") == 0) { // debug
+  if (debug) {
     print_ast();
     return 0;
   }
 
-  // intel記法を使う
-  printf(".intel_syntax noprefix\n");
+  // 先頭の関数定義から順にコード生成
+  // パーズしながらコードを生成したなら、もう済んでいる
+  if (!stream_funcs) {
+    for (int i = 0; func_defs[i]; i++)
+      compile_func(func_defs[i]);
+  }
 
+  // グローバル変数と文字列は、すべての関数を読み終わってから出力する
   // グローバル変数を出力する
   gen_global_var();
 
   // 文字列を出力する
   gen_strings();
-  
-  // 先頭の関数定義から順にコード生成
-  for (int i = 0; func_defs[i]; i++) {
-     gen(func_defs[i]);
+
+  if (stats) {
+    print_arena_stats("(global)", &tu_arena);
+    print_arena_peak();
+    // プロセス全体が使ったメモリーの最大値
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    fprintf(stderr, "peak RSS %ld KB\n", usage.ru_maxrss);
   }
 
   // 正常終了コードを返す
   return 0;
 }
 
-// 指定されたファイルの内容を返す
-char *read_file(char *path) {
-  // ファイルを開く
-  FILE *fp = fopen(path, "r");
-  if (!fp)
-    error("cannot open %s: %s", path, strerror(errno));
+// 関数定義のコードを生成する
+// main から呼ばれないので本体をパーズしなかった関数は出力しない
+void compile_func(Node *node) {
+  Function *fn = node->func;
+  // コード生成で使う領域も、関数のアリーナから割り当てる
+  cur_arena = &fn->arena;
+  if (fn->body) {
+    // 定数の式を先に計算しておく
+    fold_func(fn);
+    if (opt_level == 0)
+      gen(node);
+    else
+      gen_ir(node);
+  }
+  // ためておいた関数の残りのアセンブリを書き出す
+  int eliminated = flush_asm();
+  cur_arena = &tu_arena;
+  // コード生成が終わった関数の本体はもう使わないので、アリーナごと解放する
+  if (stats) {
+    print_arena_stats(atom_name(fn->name), &fn->arena);
+    fprintf(stderr, "peephole %-16s eliminated %d instructions\n",
+            atom_name(fn->name), eliminated);
+  }
+  arena_release(&fn->arena);
+  fn->body = NULL;
+  // 出力をためこまないように、関数ごとに書き出しておく
+  fflush(stdout);
+}
 
-  // ファイルの長さを調べる
-  if (fseek(fp, 0, SEEK_END) == -1)
-    error("%s: fseek: %s", path, strerror(errno));
-  size_t size = ftell(fp);
-  if (fseek(fp, 0, SEEK_SET) == -1)
-    error("%s: fseek: %s", path, strerror(errno));
+// パイプラインで、パーズし終わった関数定義をコード生成のスレッドに渡す待ち行列
+// パーザーが先に進みすぎて AST がたまらないように、小さくしておく
+#define FUNC_QUEUE_SIZE 4
+static Queue *func_queue;
+static thrd_t codegen_thread;
 
-  // ファイル内容を読み込む
-  char *buf = calloc(1, size + 2);
-  fread(buf, size, 1, fp);
+// コード生成のスレッドで、渡された関数定義を順に出力する。NULL が来たら終わる
+static int codegen_main(void *arg) {
+  for (Node *node; (node = queue_pop(func_queue));) {
+    compile_func(node);
+    // 関数は順に渡されるので、この関数の本体より前の入力はもうどのスレッドも読まない
+    release_input(user_input + node->func->body_pos);
+  }
+  return 0;
+}
+
+// コード生成のスレッドを動かし始める
+void start_codegen() {
+  func_queue = new_queue(FUNC_QUEUE_SIZE);
+  if (thrd_create(&codegen_thread, codegen_main, NULL) != thrd_success)
+    error("スレッドを作れません");
+}
+
+// パーズし終わった関数定義をコード生成のスレッドに渡す
+void send_func(Node *node) {
+  queue_push(func_queue, node);
+}
+
+// コード生成のスレッドに終わりを知らせて、終わるのを待つ
+void finish_codegen() {
+  queue_push(func_queue, NULL);
+  thrd_join(codegen_thread, NULL);
+}
+
+// 入力をファイルからマップしたときの、マップした領域の先頭
+// 読み終わった部分は、ページごとにメモリーから追い出せる
+static char *mapped_input;
+
+// 入力のうち end より前のページを追い出す
+// MAP_PRIVATE でマップしたファイルのページは、書き換えていなければ、
+// 追い出した後に触ってもファイルから読み直される。エラー表示で前の行を数えるときなど
+void release_input(char *end) {
+  if (!mapped_input)
+    return;
+  size_t page = sysconf(_SC_PAGESIZE);
+  size_t len = (end - mapped_input) / page * page;
+  if (len > 0)
+    madvise(mapped_input, len, MADV_DONTNEED);
+}
+
+// パイプや標準入力のように長さのわからない入力を、少しずつ読んで返す
+static char *read_stream(int fd, char *path) {
+  size_t cap = 1 << 16;
+  size_t size = 0;
+  char *buf = malloc(cap);
+  for (;;) {
+    // 末尾に "\n\0" を足せるように、常に2バイト以上の空きを残しておく
+    if (cap - size < 2 + 4096) {
+      cap *= 2;
+      buf = realloc(buf, cap);
+    }
+    ssize_t n = read(fd, buf + size, cap - size - 2);
+    if (n == -1)
+      error("%s: read: %s", path, strerror(errno));
+    if (n == 0)
+      break;
+    size += n;
+  }
 
   // ファイルが必ず"\n\0"で終わっているようにする
   if (size == 0 || buf[size - 1] != '\n')
     buf[size++] = '\n';
   buf[size] = '\0';
-  fclose(fp);
   return buf;
-}
\ No newline at end of file
+}
+
+// 通常のファイルを、コピーせずにメモリーにマップして返す
+static char *map_file(int fd, char *path, size_t size) {
+  // 末尾に "\n\0" を足せるだけの長さを、ページ単位で匿名マップしておく
+  size_t page = sysconf(_SC_PAGESIZE);
+  size_t len = (size + 2 + page - 1) / page * page;
+  char *buf = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (buf == MAP_FAILED)
+    error("%s: mmap: %s", path, strerror(errno));
+
+  // その先頭にファイルを重ねてマップする。ファイルの最後のページの
+  // ファイル末尾より後ろと、その後の匿名ページは 0 で埋まっているので、
+  // buf[size] 以降はすでに '\0' になっている
+  if (size > 0 && mmap(buf, size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
+    error("%s: mmap: %s", path, strerror(errno));
+
+  // ファイルが必ず"\n\0"で終わっているようにする
+  // MAP_PRIVATE なので、書き込んでも書き換わるのはそのページの複製だけ
+  if (size == 0 || buf[size - 1] != '\n')
+    buf[size] = '\n';
+  return buf;
+}
+
+// 指定されたファイルの内容を返す
+// "-" なら標準入力を読む
+char *read_file(char *path) {
+  if (strcmp(path, "-") == 0)
+    return read_stream(STDIN_FILENO, path);
+
+  // ファイルを開く
+  int fd = open(path, O_RDONLY);
+  if (fd == -1)
+    error("cannot open %s: %s", path, strerror(errno));
+
+  // ファイルの種類と長さを調べる
+  struct stat st;
+  if (fstat(fd, &st) == -1)
+    error("%s: fstat: %s", path, strerror(errno));
+
+  // パイプなどは長さがわからないので少しずつ読む
+  char *buf;
+  if (S_ISREG(st.st_mode)) {
+    buf = map_file(fd, path, st.st_size);
+    mapped_input = buf;
+  } else {
+    buf = read_stream(fd, path);
+  }
+  close(fd);
+  return buf;
+}
@@ -0,0 +1,336 @@
+#include "nanocc.h"
+
+// ローカル変数のレジスターへの昇格 (mem2reg)
+// アドレスを取られない変数は、IR_LOAD と IR_STORE で読み書きする代わりに、
+// 代入した値そのものを使うようにする。Cytron らの方法による。
+//
+// 1. 変数に代入するブロックの支配辺境 (dominance frontier) を繰り返したどり、
+//    合流するブロックの先頭に IR_PHI を置く。
+// 2. 支配木を入口から深さ優先でたどり、変数ごとにいまの値を積んでいく。
+//    IR_STORE はいまの値を積んで取り除き、IR_LOAD はいまの値に置き換える。
+//    後に来うるブロックの phi には、そこへ向かうときのいまの値を足す。
+//
+// 仮引数も入口のブロックで IR_PARAM の値を代入している変数なので、同じく値になる
+
+// 昇格させる変数の情報
+typedef struct {
+  LVar *var;
+  int size;      // 値の大きさ。ポインターなら 8、int と char は 4
+  int mem_size;  // 変数の大きさ。代入した値をこの大きさに切り詰める
+  Inst *cur;     // いまの値。支配木をたどりながら変える
+  Block **def_blocks; // 代入するブロック
+  int num_defs;
+  int cap_defs;
+} PromotedVar;
+
+// 昇格させる変数。LVar の index で引く。昇格させないなら NULL
+static PromotedVar **promoted;
+// 取り除いた IR_LOAD の値の代わりに使う値。値の番号で引く
+// 置き換えの途中で作った値は IR_LOAD ではないので、表の外になる
+static Inst **replacement;
+static int num_replacement;
+
+// アドレスが addr の変数を昇格させるなら、その情報
+static PromotedVar *promoted_var(Inst *addr) {
+  if (addr->op != IR_ALLOCA)
+    return NULL;
+  return promoted[addr->var->index];
+}
+
+// 関数の IR。新しい値に番号を振るのに使う
+static IrFunc *cur_ir;
+
+// 命令に値の番号をつけて、命令 pos の直前に入れる
+static Inst *insert_value(Inst *pos, Inst *inst) {
+  inst->id = cur_ir->num_values++;
+  insert_before(pos, inst);
+  return inst;
+}
+
+// 代入する前に読んだ変数の値。初期化していない変数を読むことになるので、何でもよい
+static Inst *undef_value(Inst *pos, int size) {
+  return insert_value(pos, new_inst(IR_CONST, size));
+}
+
+// 変数のいまの値。まだ代入していなければ pos の前に 0 を作る
+static Inst *current_value(PromotedVar *pv, Inst *pos) {
+  if (pv->cur)
+    return pv->cur;
+  return undef_value(pos, pv->size);
+}
+
+// 昇格させられる変数を探す
+// 変数がアドレスとして IR_LOAD と IR_STORE でだけ使われていればよい。
+// ただし、配列でない変数のアドレスを取り、ポインターの足し引きもする関数では、
+// 隣の変数をポインターでたどれるように、どの変数もメモリーに置いたままにする
+static void find_promotable(IrFunc *f) {
+  bool *escaped = arena_alloc(cur_arena, sizeof(bool) * f->num_values);
+  bool scalar_escaped = false;
+  bool pointer_arith = false;
+  for (Block *b = f->entry; b; b = b->next) {
+    for (Inst *inst = b->first; inst; inst = inst->next) {
+      if ((inst->op == IR_ADD || inst->op == IR_SUB) && inst->size == 8)
+        pointer_arith = true;
+      for (int j = 0; j < inst->num_args; j++) {
+        Inst *arg = inst->args[j];
+        if (arg->op != IR_ALLOCA)
+          continue;
+        bool is_addr = j == 0 && (inst->op == IR_LOAD || inst->op == IR_STORE);
+        if (is_addr)
+          continue;
+        escaped[arg->id] = true;
+        if (arg->var->type->kind != ARRAY)
+          scalar_escaped = true;
+      }
+    }
+  }
+  if (scalar_escaped && pointer_arith)
+    return;
+  for (Inst *inst = f->entry->first; inst; inst = inst->next) {
+    if (inst->op != IR_ALLOCA || escaped[inst->id])
+      continue;
+    Type *type = inst->var->type;
+    if (type->kind == ARRAY)
+      continue;
+    PromotedVar *pv = arena_alloc(cur_arena, sizeof(PromotedVar));
+    pv->var = inst->var;
+    pv->size = type->kind == PTR ? 8 : 4;
+    pv->mem_size = type_size(type);
+    promoted[inst->var->index] = pv;
+  }
+
+  // 変数ごとに代入するブロックを集める
+  for (Block *b = f->entry; b; b = b->next) {
+    for (Inst *inst = b->first; inst; inst = inst->next) {
+      if (inst->op != IR_STORE)
+        continue;
+      PromotedVar *pv = promoted_var(inst->args[0]);
+      if (!pv || (pv->num_defs && pv->def_blocks[pv->num_defs - 1] == b))
+        continue;
+      if (pv->num_defs == pv->cap_defs) {
+        pv->cap_defs = pv->cap_defs ? pv->cap_defs * 2 : 4;
+        Block **buf = arena_alloc(cur_arena, sizeof(Block *) * pv->cap_defs);
+        if (pv->num_defs)
+          memcpy(buf, pv->def_blocks, sizeof(Block *) * pv->num_defs);
+        pv->def_blocks = buf;
+      }
+      pv->def_blocks[pv->num_defs++] = b;
+    }
+  }
+}
+
+// 各ブロックの支配辺境を求める。b の支配辺境は、b が支配するブロックから
+// 来うるが、b 自身には狭義に支配されないブロックの集まり
+// Cooper, Harvey, Kennedy の方法による
+static Block ***compute_frontiers(IrFunc *f, int *num_df) {
+  Block ***df = arena_alloc(cur_arena, sizeof(Block **) * f->num_blocks);
+  int *cap = arena_alloc(cur_arena, sizeof(int) * f->num_blocks);
+  for (int i = 0; i < f->num_rpo; i++) {
+    Block *b = f->rpo[i];
+    if (b->num_preds < 2)
+      continue;
+    for (int j = 0; j < b->num_preds; j++) {
+      for (Block *runner = b->preds[j]; runner != b->idom; runner = runner->idom) {
+        int id = runner->id;
+        if (num_df[id] && df[id][num_df[id] - 1] == b)
+          continue;
+        if (num_df[id] == cap[id]) {
+          cap[id] = cap[id] ? cap[id] * 2 : 4;
+          Block **buf = arena_alloc(cur_arena, sizeof(Block *) * cap[id]);
+          if (num_df[id])
+            memcpy(buf, df[id], sizeof(Block *) * num_df[id]);
+          df[id] = buf;
+        }
+        df[id][num_df[id]++] = b;
+      }
+    }
+  }
+  return df;
+}
+
+// 変数ごとに、代入するブロックの支配辺境を繰り返したどって phi を置く
+static void insert_phis(IrFunc *f) {
+  int *num_df = arena_alloc(cur_arena, sizeof(int) * f->num_blocks);
+  Block ***df = compute_frontiers(f, num_df);
+  // ブロックごとに、どの alloca の phi を置いたか、どの alloca の作業リストに入れたか
+  int *has_phi = arena_alloc(cur_arena, sizeof(int) * f->num_blocks);
+  int *queued = arena_alloc(cur_arena, sizeof(int) * f->num_blocks);
+  Block **work = arena_alloc(cur_arena, sizeof(Block *) * f->num_blocks);
+  for (int i = 0; i < f->num_blocks; i++)
+    has_phi[i] = queued[i] = -1;
+
+  for (Inst *alloca = f->entry->first; alloca; alloca = alloca->next) {
+    PromotedVar *pv = promoted_var(alloca);
+    if (!pv)
+      continue;
+    int num_work = 0;
+    for (int i = 0; i < pv->num_defs; i++) {
+      Block *b = pv->def_blocks[i];
+      queued[b->id] = alloca->id;
+      work[num_work++] = b;
+    }
+    while (num_work > 0) {
+      Block *b = work[--num_work];
+      for (int i = 0; i < num_df[b->id]; i++) {
+        Block *d = df[b->id][i];
+        if (has_phi[d->id] == alloca->id)
+          continue;
+        has_phi[d->id] = alloca->id;
+        Inst *phi = new_inst(IR_PHI, pv->size);
+        phi->id = f->num_values++;
+        phi->var = pv->var;
+        insert_before(d->first, phi);
+        if (queued[d->id] != alloca->id) {
+          queued[d->id] = alloca->id;
+          work[num_work++] = d;
+        }
+      }
+    }
+  }
+}
+
+// 支配木の子を並べる
+static Block ***dom_children(IrFunc *f, int *num_children) {
+  Block ***children = arena_alloc(cur_arena, sizeof(Block **) * f->num_blocks);
+  for (int i = 1; i < f->num_rpo; i++)
+    num_children[f->rpo[i]->idom->id]++;
+  for (int i = 0; i < f->num_rpo; i++) {
+    Block *b = f->rpo[i];
+    children[b->id] = arena_alloc(cur_arena, sizeof(Block *) * num_children[b->id]);
+    num_children[b->id] = 0;
+  }
+  for (int i = 1; i < f->num_rpo; i++) {
+    Block *b = f->rpo[i];
+    children[b->idom->id][num_children[b->idom->id]++] = b;
+  }
+  return children;
+}
+
+// 変数のいまの値の履歴。ブロックを出るときに、入ったときの値に戻す
+typedef struct {
+  PromotedVar *pv;
+  Inst *saved;
+} Saved;
+
+static Saved *saved;
+static int num_saved;
+static int cap_saved;
+
+// 変数のいまの値を val にする
+static void set_value(PromotedVar *pv, Inst *val) {
+  if (num_saved == cap_saved) {
+    cap_saved = cap_saved ? cap_saved * 2 : 64;
+    Saved *buf = arena_alloc(cur_arena, sizeof(Saved) * cap_saved);
+    if (num_saved)
+      memcpy(buf, saved, sizeof(Saved) * num_saved);
+    saved = buf;
+  }
+  saved[num_saved].pv = pv;
+  saved[num_saved].saved = pv->cur;
+  num_saved++;
+  pv->cur = val;
+}
+
+// 変数に代入する値を、変数の大きさに切り詰める
+static Inst *truncate_value(PromotedVar *pv, Inst *val, Inst *pos) {
+  if (pv->mem_size == 8 || (pv->mem_size == 4 && val->size == 4))
+    return val;
+  if (val->op == IR_CONST) {
+    Inst *c = new_inst(IR_CONST, 4);
+    c->imm = pv->mem_size == 1 ? (signed char)val->imm : (int)val->imm;
+    return insert_value(pos, c);
+  }
+  Inst *inst = new_inst(IR_TRUNC, 4);
+  inst->mem_size = pv->mem_size;
+  add_arg(inst, val);
+  return insert_value(pos, inst);
+}
+
+// ブロックの中の読み書きを値に置き換え、後に来うるブロックの phi にオペランドを足す
+static void rename_block(Block *b) {
+  for (Inst *inst = b->first; inst;) {
+    Inst *next = inst->next;
+    if (inst->op == IR_PHI) {
+      set_value(promoted[inst->var->index], inst);
+      inst = next;
+      continue;
+    }
+    // 取り除いた IR_LOAD の値を使っていれば、代わりの値にする
+    for (int j = 0; j < inst->num_args; j++) {
+      int id = inst->args[j]->id;
+      if (id < num_replacement && replacement[id])
+        replace_arg(inst, j, replacement[id]);
+    }
+
+    PromotedVar *pv = NULL;
+    if (inst->op == IR_LOAD || inst->op == IR_STORE)
+      pv = promoted_var(inst->args[0]);
+    if (pv) {
+      if (inst->op == IR_LOAD)
+        replacement[inst->id] = current_value(pv, inst);
+      else
+        set_value(pv, truncate_value(pv, inst->args[1], inst));
+      remove_inst(inst);
+    }
+    inst = next;
+  }
+
+  for (int i = 0; i < num_succs(b); i++) {
+    Block *s = succ(b, i);
+    for (Inst *phi = s->first; phi && phi->op == IR_PHI; phi = phi->next)
+      add_phi_arg(phi, current_value(promoted[phi->var->index], b->last), b);
+  }
+}
+
+// 支配木を入口から深さ優先でたどって、変数の読み書きを値に置き換える
+// 関数が大きいと支配木が深くなるので、再帰はせず自前のスタックを使う
+static void rename_vars(IrFunc *f) {
+  int *num_children = arena_alloc(cur_arena, sizeof(int) * f->num_blocks);
+  Block ***children = dom_children(f, num_children);
+  Block **stack = arena_alloc(cur_arena, sizeof(Block *) * f->num_blocks);
+  int *next_child = arena_alloc(cur_arena, sizeof(int) * f->num_blocks);
+  // ブロックに入ったときの履歴の長さ
+  int *mark = arena_alloc(cur_arena, sizeof(int) * f->num_blocks);
+  int depth = 0;
+  stack[depth++] = f->entry;
+  mark[f->entry->id] = num_saved;
+  rename_block(f->entry);
+  while (depth > 0) {
+    Block *b = stack[depth - 1];
+    if (next_child[b->id] < num_children[b->id]) {
+      Block *c = children[b->id][next_child[b->id]++];
+      mark[c->id] = num_saved;
+      rename_block(c);
+      stack[depth++] = c;
+      continue;
+    }
+    // 子をすべて見終わったので、入ったときの値に戻す
+    while (num_saved > mark[b->id]) {
+      num_saved--;
+      saved[num_saved].pv->cur = saved[num_saved].saved;
+    }
+    depth--;
+  }
+}
+
+// アドレスを取られないローカル変数と仮引数を、メモリーから値にする
+void promote_memory_to_registers(IrFunc *f) {
+  cur_ir = f;
+  Function *fn = f->def->func;
+  int num_vars = fn->locals ? fn->locals->index + 1 : 0;
+  promoted = arena_alloc(cur_arena, sizeof(PromotedVar *) * num_vars);
+  find_promotable(f);
+  insert_phis(f);
+
+  num_replacement = f->num_values;
+  replacement = arena_alloc(cur_arena, sizeof(Inst *) * num_replacement);
+  saved = NULL;
+  num_saved = cap_saved = 0;
+  rename_vars(f);
+
+  // 読み書きがなくなった変数の alloca は、使われない値として後で取り除かれる
+  promoted = NULL;
+  replacement = NULL;
+  saved = NULL;
+  cur_ir = NULL;
+}
@@ -12,6 +12,25 @@
 #include <stdlib.h>
 // 文字列の処理: strcpy など
 #include <string.h>
+// 幅の決まった整数型 uint32_t など
+#include <stdint.h>
+
+// アリーナ (まとめて解放できるメモリー領域) の型
+typedef struct ArenaBlock ArenaBlock;
+typedef struct {
+  ArenaBlock *head; // 最後に確保した塊
+  size_t reserved;  // 確保した塊の大きさの合計
+  size_t used;      // そのうち割り当て済みの大きさの合計
+} Arena;
+
+// 翻訳単位全体で使うオブジェクトを置くアリーナ
+// グローバル変数、文字列リテラル、関数定義のノードなど
+extern Arena tu_arena;
+
+// いま割り当てに使うアリーナ
+// 関数の本体をパーズしている間はその関数のアリーナ、それ以外は tu_arena
+// 関数の本体はスレッドごとに並行してパーズするので、スレッドごとに持つ
+extern _Thread_local Arena *cur_arena;
 
 // 文字列の型
 struct String {
@@ -22,10 +41,12 @@ struct String {
 typedef struct String String;
 
 // 値の型
+// 同じ形の型は1つしか作らないので、書き換えてはいけない
 struct Type {
   enum { UNDEF, CHAR, INT, PTR, ARRAY } kind; // undef を 0 にして偽の印にする
   struct Type *ptr_to;
   size_t array_size; // 配列のときのみ使う。配列の要素数。
+  int size;          // その型の値を持つのに必要なサイズ
 };
 typedef struct Type Type;
 
@@ -35,10 +56,10 @@ typedef struct LVar LVar;
 // ローカル変数の型
 struct LVar {
   LVar *next; // 次の変数かNULL
-  char name[255]; // 変数の名前
-  int len; // 名前の長さ
+  int name; // 変数の名前の atom
   int offset; // RBPからのオフセット
   Type *type;  // 変数の型
+  int index;   // 何番目に宣言されたか。ローカル変数は関数の中で仮引数から順に数える
 };
 
 // 抽象構文木のノードの種類
@@ -70,29 +91,60 @@ typedef enum {
 } NodeKind;
 
 typedef struct Node Node;
+typedef struct Function Function;
+typedef struct NodeList NodeList;
 
 // 抽象構文木のノードの型
+// どの種類のノードも持つ小さな共通部分と、種類ごとに使う部分の union からなる。
+// 大きな情報は別の構造体に置いてポインターでたどる
 struct Node {
-  NodeKind kind; // ノードの型
-  Node *lhs;     // 左辺。if のときは then 式。while のときは本体。for なら初期化式。
-  Node *rhs;     // 右辺。if のときは else 式。for では増加式。
-  Node *cond;    // if と while, for のときは条件式。
-  Node *body;    // while と関数定義のときのみ使う。本体。
-  Node *next;    // ブロック のときのみ使う。次の文へのポインタ。
-  int val;       // kindがND_NUMの場合のみ使う
-  int offset;    // kindがND_LVARの場合のみ使う。RBPからその変数へのオフセット。
-  Type *type;    // 式の場合のみ使う。その式が表す値の型。
-  char *str;     // 関数呼び出しと定義のときだけ使う。関数名の文字列の開始位置
-  int len;       // 関数呼び出しと定義のときだけ使う。関数名の文字列の長さ
-  Node *args[6];  // 関数呼び出しのときは、実引数を入れる、最大6つ分の配列
-                  // 関数定義のときは、仮引数を入れる。
-  int argc;       // 関数呼び出しのときは、実引数の個数。
-                  // 関数定義のときは、仮引数の個数
-  LVar *locals;   // 関数定義の際に、ローカル変数のリストの先頭を指す
+  NodeKind kind;    // ノードの型
+  uint32_t src_pos; // デバッグ用。ソースコード上の位置の user_input からのオフセット + 1
+                    // 0 なら位置を持たない
+  Type *type;       // 式の場合のみ使う。その式が表す値の型。
+  Node *lhs;        // 左辺。if のときは then 式。while のときは本体。for なら初期化式。
+  Node *rhs;        // 右辺。if のときは else 式。for では増加式。
+  Node *next;       // 文のときに使う。ブロックの中の次の文へのポインタ。
+  union {
+    int val;        // ND_NUM のとき。値
+    LVar *var;      // ND_LVAR, ND_GVAR のとき。変数
+    String *string; // ND_STRING のとき。文字列リテラル
+    struct {        // ND_IF, ND_WHILE, ND_FOR, ND_BLOCK のとき
+      Node *cond;   // if と while, for の条件式
+      Node *body;   // for の本体。ブロックのときは最初の文
+    };
+    struct {        // ND_CALL, ND_PARAM のとき
+      int name;     // 関数名または仮引数名の atom
+      int argc;     // 関数呼び出しの実引数の個数
+      Node **args;  // 関数呼び出しの実引数の配列
+    };
+    Function *func; // ND_FUNC_DEF のとき。関数定義の中身
+  };
+};
+
+// ノードのリスト
+struct NodeList {
+  Node *node;
+  NodeList *next;
+};
+
+// 関数定義の型
+struct Function {
+  int name;       // 関数名の atom
+  int index;      // 何番目に定義された関数か
+  int argc;       // 仮引数の個数
+  Node **params;  // 仮引数 ND_PARAM の配列。型は各ノードの type に入れる
+  Node *body;     // 本体のブロック
+  uint32_t body_pos; // 本体の "{" の user_input からのオフセット
+  LVar *globals;  // この関数より前に宣言されたグローバル変数のリストの先頭
+  LVar *locals;   // ローカル変数のリストの先頭
                   // 新しい要素は先頭につないでいくので、先頭アドレスは最後に足した要素を指す
-  LVar *var;      // グローバル変数 ND_GVAR の場合に、変数を指す
-  String *string; // 文字列リテラル
-  char *src_pos;  // デバッグ用。ソースコード上の位置。
+  NodeList *strings;     // 本体に出てきた文字列リテラルのノード。出てきた順
+  NodeList *last_string; // strings の末尾
+  NodeList *calls;       // 本体に出てきた関数呼び出しのノード。出てきた順
+  NodeList *last_call;   // calls の末尾
+  bool reachable; // main から呼ばれうるので、本体をパーズすることになったか
+  Arena arena;    // 本体のノードや型、ローカル変数を置くアリーナ
 };
 
 // トークンの種類
@@ -112,19 +164,48 @@ typedef enum {
   TK_STRING,   // 文字列リテラル
 } TokenKind;
 
+// 記号の種類。記号トークンはこの番号を持つので、比較は整数の比較で済む
+typedef enum {
+  PU_NONE,     // 記号ではない
+  PU_PLUS,     // +
+  PU_MINUS,    // -
+  PU_STAR,     // *
+  PU_SLASH,    // /
+  PU_LPAREN,   // (
+  PU_RPAREN,   // )
+  PU_LBRACE,   // {
+  PU_RBRACE,   // }
+  PU_LBRACKET, // [
+  PU_RBRACKET, // ]
+  PU_LT,       // <
+  PU_GT,       // >
+  PU_LTE,      // <=
+  PU_GTE,      // >=
+  PU_EQ,       // ==
+  PU_NEQ,      // !=
+  PU_ASSIGN,   // =
+  PU_SEMI,     // ;
+  PU_COMMA,    // ,
+  PU_AMP,      // &
+} PunctKind;
+
 typedef struct Token Token;
 
 // トークン型
+// 小さな配列に詰めて使い回すので、文字列は user_input からのオフセットで持つ
 struct Token {
-  TokenKind kind; // トークンの型
-  Token *next;    // 次の入力トークン
-  int val;        // kindがTK_NUMの場合、その数値
-  char *str;      // 文字列の開始位置
-  int len;        // 文字列の長さ
-  String *string; // 文字列リテラル
+  unsigned char kind; // トークンの型 (TokenKind)
+  unsigned char id;   // kindがTK_RESERVEDの場合、記号の種類 (PunctKind)
+  uint32_t offset;    // 文字列の開始位置の user_input からのオフセット
+  uint32_t len;       // 文字列の長さ
+  int val;            // kindがTK_NUMの場合、その数値
+                      // kindがTK_IDENTの場合、名前の atom
+                      // kindがTK_STRINGの場合、中身の atom
 };
 
-Token *tokenize(char *p);
+void tokenize(char *p);
+void start_lexer(char *p);
+void finish_lexer();
 
 // 入力プログラム の宣言
 extern char *user_input;
@@ -132,22 +213,49 @@ extern char *user_input;
 // プログラムの特定の位置の行全体を取り出す
 char *source_code(char *pos);
 
-// 現在着目しているトークン の宣言
-extern Token *token;
+// 現在着目しているトークンが、入力の先頭から何番目のトークンか の宣言
+// 関数の本体はスレッドごとに並行してパーズするので、スレッドごとに持つ
+extern _Thread_local int token_pos;
 
 void program();
 void gen(Node *node);
 void gen_global_var();
 void gen_strings();
 
-// プログラムを構成する文の並びを入れておく
-Node *code[100];
+// トップレベルにある関数定義の並びを入れておく。NULL で終わる
+Node **func_defs;
+
+// いまパーズ中の関数定義を入れておく
+extern _Thread_local Function *cur_func;
+
+// 関数の本体をパーズするスレッドの数
+extern int num_parse_threads;
+
+// 真なら main から呼ばれない関数も含めて、すべての関数の本体をパーズしてコンパイルする
+// 偽なら main から呼び出しをたどって届く関数だけをパーズする
+extern bool compile_all_funcs;
 
-// トップレベルにある関数定義の並びを入れておく
-Node *func_defs[100];
+// 真なら、関数の本体をパーズするたびにすぐコードを生成して、本体のアリーナを解放する
+// 本体をその場でパーズするとき (1つのスレッドですべての関数をパーズするとき) だけ有効で、
+// program() はそれ以外のときに偽にする
+extern bool stream_funcs;
 
-// いまパーズ中の関数定義のノードを入れておく
-Node *cur_func;
+// 真なら、字句解析、構文解析、コード生成を別々のスレッドで並行して動かす
+// 関数ごとにすぐコードを生成するときだけ使える
+extern bool pipeline;
+
+// 関数定義のコードを生成して、本体のアリーナを解放する
+void compile_func(Node *node);
+
+// パイプラインのコード生成のスレッドを動かし始める
+void start_codegen();
+// パーズし終わった関数定義をコード生成のスレッドに渡す
+void send_func(Node *node);
+// コード生成のスレッドが、渡した関数をすべて出力し終わるのを待つ
+void finish_codegen();
+
+// 入力のうち end より前の部分は、もう読まないものとしてメモリーから追い出す
+void release_input(char *end);
 
 // グローバル変数のリストの先頭。
 // リストを伸ばすときは先頭が交代していくようにする
@@ -157,48 +265,294 @@ LVar *global_var_list;
 // リストを伸ばすときは先頭が交代していくようにする
 String *string_list;
 int string_index;
+// 同じ中身のリテラルと共有になった文字列リテラルの個数
+int string_dedup_count;
 
 // その型の値を持つのに必要なサイズ
-int type_size (Type *type);
+int type_size(Type *type);
 
 // エラー出力
 void error(char *fmt, ...);
 void error_at(char *loc, char *fmt, ...);
 
 // tokenizer
+Token *cur_token();
+char *token_str(Token *tok);
+String *intern_string(int atom);
 bool at_eof();
-bool consume(char *op);
+bool consume(PunctKind id);
 bool consume_reserved(int kind);
 void expect_rword(int kind, char *rword);
 Token *consume_ident();
 Token *expect_ident();
-void expect(char *op);
+void expect(PunctKind id);
 int expect_number();
 int expect_type();
 int consume_type();
-String *consume_string();
+Token *consume_string();
+
+// scan
+// 読み飛ばす文字の並びの種類
+typedef enum {
+  SCAN_SPACE,   // 空白文字の並び。空白以外で止まる
+  SCAN_LINE,    // 行コメントの中。'\n' で止まる
+  SCAN_COMMENT, // ブロックコメントの中。'*' で止まる
+  SCAN_LOWER,   // 識別子。'a'..'z' 以外で止まる
+  SCAN_STRING,  // 文字列リテラルの中。'"' か '\\' で止まる
+} ScanKind;
+extern char *(*scan)(char *p, ScanKind kind);
+bool select_scan(int level);
+void init_scan();
+void bench_tokenize(char *input);
 
 // type
-Type *new_type(int kind);
-Type *append_type(int kind, Type **head, Type **tail);
+Type *basic_type(int kind);
+Type *pointer_to(Type *base);
+Type *array_of(Type *base, size_t len);
 char *type_name(Type *type);
 
+// 記号表のスロット
+typedef struct {
+  int key;   // 名前の atom + 1。0 なら空き
+  void *sym; // いま見えている定義。NULL なら見えていない
+} SymSlot;
+
+// スコープを出るときに戻すための、書き換える前の定義
+typedef struct {
+  int name;
+  void *prev;
+} SymUndo;
+
+// 名前の atom から定義を引く、スコープつきの記号表
+typedef struct {
+  SymSlot *slots; // オープンアドレス法のハッシュ表
+  int cap;        // slots の大きさ。2のべき乗
+  int used;       // 使用中のスロットの個数
+  SymUndo *undo;  // スコープの中で書き換えた定義の記録
+  int num_undo;
+  int cap_undo;
+  int *scopes;    // 各スコープに入ったときの num_undo
+  int depth;      // スコープの深さ
+  int cap_scopes;
+} SymTable;
+
+// arena
+void *arena_alloc(Arena *arena, size_t size);
+void arena_release(Arena *arena);
+void print_arena_stats(char *name, Arena *arena);
+void print_arena_peak();
+
+// queue
+typedef struct Queue Queue;
+Queue *new_queue(int cap);
+void queue_push(Queue *q, void *item);
+void *queue_pop(Queue *q);
+
+// symtab
+void *find_sym(SymTable *t, int name);
+void add_sym(SymTable *t, int name, void *sym);
+void enter_scope(SymTable *t);
+void leave_scope(SymTable *t);
+
+// atom
+int intern(char *str, int len);
+char *atom_name(int atom);
+int atom_len(int atom);
+
 // var
 LVar *find_lvar(Token *tok);
 LVar *find_global_var(Token *tok);
-void register_var(char *str, int len, Type *type);
-void register_global_var(char *str, int len, Type *type);
+void register_var(int name, Type *type);
+void register_global_var(int name, Type *type);
+void retype_last_var(Type *type);
+Node *find_func(int name);
+void register_func(Node *node);
+void enter_block();
+void leave_block();
+
+// fold
+void fold_func(Function *fn);
 
 // node
 Node *new_node_unary(NodeKind kind, Node *lhs);
 Node *new_node_bin(NodeKind kind, Node *lhs, Node *rhs);
 Node *new_node_num(int val);
 Node *new_node(NodeKind kind);
-Node *new_node_string(String *string);
+Node *new_node_string(int atom);
 int node_list_length(Node *node);
+Node **list_to_array(Node *list, int *len);
+void append_node_list(NodeList **head, NodeList **tail, Node *node);
+void set_src_pos(Node *node, char *pos);
+char *node_src_pos(Node *node);
 
 // 入力ファイル名
 char *filename;
 
 // ASTを表示する
 void print_ast();
+
+// ir
+// 中間表現 (IR)
+// 関数の本体を、基本ブロックをつないだ制御フローグラフ (CFG) にする。
+// 命令はそれぞれが1つの値を定義し、値は一度しか定義されない (SSA 形式)。
+// ローカル変数ははじめメモリー上に置き、IR_LOAD と IR_STORE で読み書きする。
+// アドレスを取られない変数は、最適化パス (mem2reg.c) で IR_PHI を使った値にする
+
+// IR の命令の種類
+typedef enum {
+  IR_CONST,  // 整数の定数 imm
+  IR_PARAM,  // imm 番目の仮引数の値
+  IR_ALLOCA, // ローカル変数 var の領域のアドレス
+  IR_GADDR,  // グローバル変数 var のアドレス
+  IR_SADDR,  // 文字列リテラル str のアドレス
+  IR_LOAD,   // args[0] の指すところから mem_size バイト読んで符号拡張した値
+  IR_STORE,  // args[0] の指すところに args[1] の下位 mem_size バイトを書く
+  IR_ADD,    // args[0] + args[1]
+  IR_SUB,    // args[0] - args[1]
+  IR_MUL,    // args[0] * args[1]
+  IR_DIV,    // args[0] / args[1]
+  IR_SHL,    // args[0] を imm ビット左にずらした値
+  IR_SAR,    // args[0] を imm ビット右に算術シフトした値
+  IR_SHR,    // args[0] を imm ビット右に論理シフトした値
+  IR_MULHI,  // int の args[0] と imm の符号つきの積の、上位 32 ビット
+  IR_EQ,     // args[0] == args[1]。比較の結果は 0 か 1 の int
+  IR_NE,     // args[0] != args[1]
+  IR_LT,     // args[0] < args[1]
+  IR_LE,     // args[0] <= args[1]
+  IR_SEXT,   // int の args[0] を 64 ビットに符号拡張した値
+  IR_TRUNC,  // args[0] の下位 mem_size バイトを符号拡張した int の値
+  IR_PHI,    // phi_preds[i] から来たときは args[i] になる値
+  IR_CALL,   // 関数 name を args を引数にして呼んだ返り値
+  IR_JMP,    // targets[0] に飛ぶ
+  IR_BR,     // args[0] が 0 でなければ targets[0] に、0 なら targets[1] に飛ぶ
+             // 命令選択の後は、オペランドが2つなら args[0] と args[1] を比較 imm で比べて、成り立てば targets[0] に飛ぶ
+  IR_RET,    // args[0] を返す
+} IrOp;
+
+typedef struct Inst Inst;
+typedef struct Block Block;
+typedef struct IrFunc IrFunc;
+
+// IR の命令
+struct Inst {
+  IrOp op;
+  int id;          // 値の番号。関数の中で命令ごとに振る
+  int size;        // 値の大きさ。int なら 4、ポインターなら 8。値を持たない命令は 0
+  int mem_size;    // IR_LOAD, IR_STORE で読み書きする大きさ
+  int64_t imm;     // IR_CONST の値、IR_PARAM の番号、シフトの幅、IR_MULHI の定数、命令選択の後の IR_LOAD, IR_STORE のアドレスに足す数と IR_BR の比較
+  int scale;       // 命令選択の後の IR_LOAD, IR_STORE で、最後のオペランドに掛けてアドレスに足す数。なければ 0
+  Inst **args;     // オペランド
+  int num_args;
+  int cap_args;
+  Block *targets[2]; // IR_JMP, IR_BR の飛び先
+  Block **phi_preds; // IR_PHI の各オペランドが、どのブロックから来たときの値か
+  union {
+    LVar *var;     // IR_ALLOCA, IR_GADDR の変数
+    String *str;   // IR_SADDR の文字列
+    int name;      // IR_CALL の関数名の atom
+  };
+  int num_uses;    // この値をオペランドにしている命令の数
+  Block *block;    // 命令の入っているブロック
+  Inst *prev;      // ブロックの中の前後の命令
+  Inst *next;
+  int reg;         // 出力で使う。値を置くレジスター。スタックに置くなら -1
+  int slot;        // 出力で使う。値を置くスタックの rbp からのオフセット
+};
+
+// 基本ブロック
+// 最後の命令は IR_JMP, IR_BR, IR_RET のどれか
+struct Block {
+  int id;
+  Inst *first;     // ブロックの中の最初と最後の命令
+  Inst *last;
+  Block **preds;   // 前に来うるブロック
+  int num_preds;
+  int cap_preds;
+  Block *idom;     // 直接の支配ブロック。入口のブロックでは自分自身
+  int rpo;         // 逆後順 (reverse postorder) での番号。たどり着けなければ -1
+  Block *next;     // 関数の中のブロックのリストの次
+};
+
+// 関数の IR
+struct IrFunc {
+  Node *def;       // 関数定義のノード
+  Block *entry;    // 入口のブロック。関数の中のブロックのリストの先頭でもある
+  Block *last;     // ブロックのリストの末尾
+  int num_blocks;
+  int num_values;
+  Block **rpo;     // たどり着けるブロックを逆後順に並べた配列
+  int num_rpo;
+};
+
+// x86-64 の汎用レジスター
+typedef enum {
+  RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+  R8, R9, R10, R11, R12, R13, R14, R15,
+  NUM_REGS,
+} Reg;
+
+// 最適化の水準。0 なら AST から直接アセンブリを出力する。1 なら IR を経由する
+extern int opt_level;
+// 真なら、最適化した後の IR を標準エラー出力に表示する
+extern bool dump_ir;
+
+Block *new_block(IrFunc *f);
+Block *new_block_after(IrFunc *f, Block *pos);
+Inst *new_inst(IrOp op, int size);
+void add_arg(Inst *inst, Inst *arg);
+void add_phi_arg(Inst *phi, Inst *val, Block *pred);
+void replace_arg(Inst *inst, int i, Inst *val);
+void append_inst(Block *block, Inst *inst);
+void insert_before(Inst *pos, Inst *inst);
+void remove_inst(Inst *inst);
+int num_succs(Block *block);
+Block *succ(Block *block, int i);
+void compute_cfg(IrFunc *f);
+void compute_dominators(IrFunc *f);
+bool dominates(Block *a, Block *b);
+bool is_remat(Inst *inst);
+Inst *mem_index(Inst *inst);
+void verify_ir(IrFunc *f, char *pass);
+void print_ir(IrFunc *f);
+IrFunc *lower_func(Node *def);
+void promote_memory_to_registers(IrFunc *f);
+void select_instructions(IrFunc *f);
+void reduce_strength(IrFunc *f);
+void run_passes(IrFunc *f);
+void allocate_registers(IrFunc *f);
+void emit_ir(IrFunc *f);
+void gen_ir(Node *def);
+
+// asm
+// 出力するアセンブリの行の種類
+typedef enum {
+  ASM_INST,      // 命令
+  ASM_LABEL,     // ラベル
+  ASM_DIRECTIVE, // .globl などのディレクティブ
+  ASM_COMMENT,   // 行全体のコメント
+} AsmKind;
+
+#define MAX_ASM_ARGS 3
+
+// 出力するアセンブリの1行
+typedef struct {
+  AsmKind kind;
+  char *text;               // 行の文字列。命令を書き換えたら NULL にする
+  char *op;                 // 命令の名前
+  char *args[MAX_ASM_ARGS]; // 命令のオペランド
+  int num_args;
+  char *comment;            // 命令の後ろのコメント。なければ NULL
+  bool dead;                // ピープホール最適化で取り除いた
+  // ピープホール最適化で使う。命令とオペランドを調べた結果
+  int opcode;                     // 命令の番号
+  int arg_reg[MAX_ASM_ARGS];      // オペランドがレジスターならその番号。そうでなければ -1
+  int arg_size[MAX_ASM_ARGS];     // オペランドのレジスターの大きさ
+  uint32_t arg_uses[MAX_ASM_ARGS]; // オペランドに名前の出てくるレジスターの集合
+} AsmLine;
+
+// 真なら、関数のアセンブリを書き出す前にピープホール最適化をする
+extern bool use_peephole;
+
+void println(char *fmt, ...);
+int flush_asm();
+void optimize_peephole(AsmLine *lines, int n);
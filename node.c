@@ -2,8 +2,8 @@
 
 // 基本のASTノードを作る
 Node *new_node(NodeKind kind) {
-  // Node1つぶんのメモリを確保して0でクリアする
-  Node *node = calloc(1, sizeof(Node));
+  // Node1つぶんのメモリをアリーナから確保する。0でクリアされている
+  Node *node = arena_alloc(cur_arena, sizeof(Node));
   // ノードの種類: 足し算か数字かなど
   node->kind = kind;
 
@@ -12,17 +12,15 @@ Node *new_node(NodeKind kind) {
 
 // 単項演算のASTノードを作る
 Node *new_node_unary(NodeKind kind, Node *lhs) {
-  // Node1つぶんのメモリを確保して0でクリアする
-  Node *node = calloc(1, sizeof(Node));
+  // Node1つぶんのメモリをアリーナから確保する。0でクリアされている
+  Node *node = arena_alloc(cur_arena, sizeof(Node));
   // ノードの種類: 足し算か数字かなど
   node->kind = kind;
   // 左辺
   node->lhs = lhs;
   if (kind == ND_ADDR) {
     // &変数 の形では、変数の型へのポインター型
-    Type *type = new_type(PTR);
-    type->ptr_to = node->lhs->type;
-    node->type = type;
+    node->type = pointer_to(node->lhs->type);
   }
   if (kind == ND_DEREF) {
     // *値 の形では、値が配列ならその要素の型
@@ -35,8 +33,8 @@ Node *new_node_unary(NodeKind kind, Node *lhs) {
 
 // 二項演算のASTノードを作る
 Node *new_node_bin(NodeKind kind, Node *lhs, Node *rhs) {
-  // Node1つぶんのメモリを確保して0でクリアする
-  Node *node = calloc(1, sizeof(Node));
+  // Node1つぶんのメモリをアリーナから確保する。0でクリアされている
+  Node *node = arena_alloc(cur_arena, sizeof(Node));
   // ノードの種類: 足し算か数字かなど
   node->kind = kind;
   // 左辺
@@ -45,7 +43,7 @@ Node *new_node_bin(NodeKind kind, Node *lhs, Node *rhs) {
   node->rhs = rhs;
   // 型
   // 二項演算の結果の型は基本は INT
-  node->type = new_type(INT);
+  node->type = basic_type(INT);
   if (kind == ND_ADD || kind == ND_SUB) {
     // PTR の加減算では PTR
     if (node->lhs->type->kind == PTR) {
@@ -55,9 +53,7 @@ Node *new_node_bin(NodeKind kind, Node *lhs, Node *rhs) {
     }
     // ARRAY の加減算では、その要素へのポインター型
     if (node->lhs->type->kind == ARRAY) {
-      Type *type = new_type(PTR);
-      type->ptr_to = node->lhs->type->ptr_to;
-      node->type = type;
+      node->type = pointer_to(node->lhs->type->ptr_to);
     }
   }
   if (kind == ND_ASSIGN) {
@@ -66,9 +62,7 @@ Node *new_node_bin(NodeKind kind, Node *lhs, Node *rhs) {
   }
   if (kind == ND_ADDR) {
     // &変数 の形では、  変数の型へのポインター型
-    Type *type = new_type(PTR);
-    type->ptr_to = node->lhs->type;
-    node->type = type;
+    node->type = pointer_to(node->lhs->type);
   }
   if (kind == ND_DEREF) {
     // *値 の形では、値が配列ならその要素の型
@@ -81,25 +75,37 @@ Node *new_node_bin(NodeKind kind, Node *lhs, Node *rhs) {
 
 // 数字のASTノードを作る
 Node *new_node_num(int val) {
-  Node *node = calloc(1, sizeof(Node));
+  Node *node = arena_alloc(cur_arena, sizeof(Node));
   node->kind = ND_NUM;
   node->val = val;
-  node->type = new_type(INT);
+  node->type = basic_type(INT);
   return node;
 }
 
 // 文字列のASTノードを作る
-Node *new_node_string(String *string) {
-  Node *node = calloc(1, sizeof(Node));
+// 文字列リテラルのラベルは出てきた順につけるので、ここでは中身の atom を val に
+// 覚えておき、関数の strings につなぐ。すべての関数をパーズし終わってから、
+// 関数の順に String を割り当てる
+Node *new_node_string(int atom) {
+  Node *node = arena_alloc(cur_arena, sizeof(Node));
   node->kind = ND_STRING;
-  node->string = string;
-  Type *charT = new_type(CHAR);
-  Type *ptr = new_type(PTR);
-  ptr->ptr_to = charT;
-  node->type = ptr;
+  node->val = atom;
+  node->type = pointer_to(basic_type(CHAR));
+  append_node_list(&cur_func->strings, &cur_func->last_string, node);
   return node;
 }
 
+// ノードのリストの末尾に node を足す
+void append_node_list(NodeList **head, NodeList **tail, Node *node) {
+  NodeList *item = arena_alloc(cur_arena, sizeof(NodeList));
+  item->node = node;
+  if (*tail)
+    (*tail)->next = item;
+  else
+    *head = item;
+  *tail = item;
+}
+
 // next で辿っていけるリストの長さ
 int node_list_length(Node *node) {
   int len = 0;
@@ -108,4 +114,29 @@ int node_list_length(Node *node) {
     len++;
   }
   return len;
-}
\ No newline at end of file
+}
+// next でつないだノードのリストを、アリーナに置いた配列にして返す
+// 要素数は *len に入れる。各ノードの next は NULL に戻す
+Node **list_to_array(Node *list, int *len) {
+  int n = node_list_length(list);
+  Node **buf = arena_alloc(cur_arena, sizeof(Node *) * n);
+  for (int i = 0; i < n; i++) {
+    buf[i] = list;
+    list = list->next;
+    buf[i]->next = NULL;
+  }
+  *len = n;
+  return buf;
+}
+
+// ノードにソースコード上の位置を覚えさせる
+void set_src_pos(Node *node, char *pos) {
+  node->src_pos = pos - user_input + 1;
+}
+
+// ノードのソースコード上の位置を返す。位置を持たなければ NULL を返す
+char *node_src_pos(Node *node) {
+  if (!node->src_pos)
+    return NULL;
+  return user_input + node->src_pos - 1;
+}
@@ -0,0 +1,134 @@
+#include "nanocc.h"
+
+// IR の最適化パス
+// パスは関数の IR を受け取って書き換える関数で、passes に並べた順に動かす。
+// パスの後には CFG と支配木を求め直すので、パスはそれらを気にせずに
+// ブロックや飛び先を書き換えてよい
+
+typedef struct {
+  char *name;              // パスの名前。IR の検証に失敗したときのエラーに使う
+  void (*run)(IrFunc *f);  // パスの本体
+} Pass;
+
+// 入口からたどり着けないブロックを取り除く
+static void remove_unreachable_blocks(IrFunc *f) {
+  // 取り除くブロックの命令が使っている値の使用の数を減らす
+  for (Block *b = f->entry; b; b = b->next)
+    if (b->rpo < 0)
+      while (b->first)
+        remove_inst(b->first);
+  // phi からは、取り除くブロックから来たときのオペランドを除く
+  for (Block *b = f->entry; b; b = b->next) {
+    if (b->rpo < 0)
+      continue;
+    for (Inst *phi = b->first; phi && phi->op == IR_PHI; phi = phi->next) {
+      int n = 0;
+      for (int i = 0; i < phi->num_args; i++) {
+        if (phi->phi_preds[i]->rpo < 0) {
+          phi->args[i]->num_uses--;
+          continue;
+        }
+        phi->args[n] = phi->args[i];
+        phi->phi_preds[n] = phi->phi_preds[i];
+        n++;
+      }
+      phi->num_args = n;
+    }
+  }
+  Block *last = f->entry;
+  for (Block *b = f->entry->next; b; b = b->next) {
+    if (b->rpo < 0)
+      continue;
+    last->next = b;
+    last = b;
+  }
+  last->next = NULL;
+  f->last = last;
+}
+
+// 命令が値を定義する以外のことをしないか。使われていなければ取り除いてよい
+static bool is_pure(Inst *inst) {
+  switch (inst->op) {
+  case IR_STORE:
+  case IR_CALL:
+  case IR_JMP:
+  case IR_BR:
+  case IR_RET:
+    return false;
+  }
+  return true;
+}
+
+// 使われていない値を定義するだけの命令を取り除く
+// 取り除くとオペランドの値が使われなくなることがあるので、変わらなくなるまで繰り返す
+static void eliminate_dead_code(IrFunc *f) {
+  for (bool changed = true; changed;) {
+    changed = false;
+    for (Block *b = f->entry; b; b = b->next) {
+      for (Inst *inst = b->last; inst;) {
+        Inst *prev = inst->prev;
+        if (inst->num_uses == 0 && is_pure(inst)) {
+          remove_inst(inst);
+          changed = true;
+        }
+        inst = prev;
+      }
+    }
+  }
+}
+
+// 分岐するブロックから、phi のある合流するブロックへの辺 (critical edge) に
+// ブロックを挟む。phi は前のブロックの終わりで値を移して実現するので、
+// 分岐する前に移すと、もう一方の飛び先に行くときにも移してしまう
+static void split_critical_edges(IrFunc *f) {
+  for (Block *b = f->entry; b; b = b->next) {
+    if (num_succs(b) < 2)
+      continue;
+    for (int i = 0; i < num_succs(b); i++) {
+      Block *s = succ(b, i);
+      if (s->num_preds < 2 || s->first->op != IR_PHI)
+        continue;
+      // 挟むブロックは b の直後に置き、飛ばずに続けられるようにする
+      Block *mid = new_block_after(f, b);
+      Inst *jmp = new_inst(IR_JMP, 0);
+      jmp->id = f->num_values++;
+      jmp->targets[0] = s;
+      append_inst(mid, jmp);
+      b->last->targets[i] = mid;
+      for (Inst *phi = s->first; phi && phi->op == IR_PHI; phi = phi->next)
+        for (int j = 0; j < phi->num_args; j++)
+          if (phi->phi_preds[j] == b)
+            phi->phi_preds[j] = mid;
+    }
+  }
+}
+
+// 最適化パスの並び
+static Pass passes[] = {
+  {"remove-unreachable-blocks", remove_unreachable_blocks},
+  {"mem2reg", promote_memory_to_registers},
+  // アドレスの計算を IR_LOAD と IR_STORE にまとめる。使われなくなった命令は後のパスで取り除く
+  {"instruction-selection", select_instructions},
+  // 定数の掛け算と割り算を、シフトや lea や上位の積に置き換える。アドレスの掛け算は前のパスで覆ってある
+  {"strength-reduction", reduce_strength},
+  {"dead-code-elimination", eliminate_dead_code},
+  {"split-critical-edges", split_critical_edges},
+};
+
+// CFG と支配木を求め直す。IR を表示するときは、正しい形になっているかも確かめる
+// pass はその直前に動かしたパスの名前
+static void analyze(IrFunc *f, char *pass) {
+  compute_cfg(f);
+  compute_dominators(f);
+  if (dump_ir)
+    verify_ir(f, pass);
+}
+
+// 関数の IR に最適化パスを順に適用する
+void run_passes(IrFunc *f) {
+  analyze(f, "lowering");
+  for (int i = 0; i < sizeof(passes) / sizeof(*passes); i++) {
+    passes[i].run(f);
+    analyze(f, passes[i].name);
+  }
+}
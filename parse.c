@@ -1,4 +1,6 @@
 #include "nanocc.h"
+// 関数の本体を並行してパーズするスレッド
+#include <threads.h>
 
 // 全体の EBNF
 // program    = global_var_or_funcs*
@@ -20,42 +22,208 @@
 // relational = add ("<" add | "<=" add | ">" add | ">=" add)*
 // add        = mul ("+" mul | "-" mul)*
 // mul        = unary ("*" unary | "/" unary)*
-// unary      = ("+" | "-")? primary
-//            | "*" unary
-//            | "&" unary
-//            | "sizeof" unary
+// unary      = ("+" | "-" | "*" | "&" | "sizeof") unary
+//            | "(" expr ")"
+//            | primary
 // primary    = num
 //            | '"' string '"'
 //            | ident ("(" expr? ("," expr)* ")")?
 //            | ident "[" expr "]"
-//            | "(" expr ")"
+// expr から unary までは、演算子の優先順位の表を使って expr() がまとめてパーズする
 Node *global_var_or_funcs();
 Node *func_def();
 Node *stmt();
 Node *block();
+Type *pointers(int type_kind);
+void append_node(Node **head, Node **tail, Node *new_node);
 Node *array_lit(Node *var_node, int len);
 Node *expr();
-Node *assign();
-Node *equality();
-Node *relational();
-Node *add();
-Node *mul();
-Node *unary();
 Node *primary();
 Node *num();
 
+// いまパーズ中の関数定義 の定義
+_Thread_local Function *cur_func;
+
+// 関数の本体をパーズするスレッドの数 の定義
+int num_parse_threads = 1;
+
+// すべての関数の本体をパーズするか の定義
+bool compile_all_funcs;
+
+// 関数ごとにすぐコードを生成するか の定義
+bool stream_funcs;
+
+// 字句解析、構文解析、コード生成を並行して動かすか の定義
+bool pipeline;
+
+// 真なら関数の本体を読み飛ばしておき、後で parse_bodies でパーズする
+static bool defer_bodies;
+
+// func_defs に入っている関数定義の個数と、func_defs の大きさ
+static int num_func_defs;
+static int cap_func_defs;
+
+// 関数定義を func_defs の末尾に足す。func_defs は常に NULL で終わるようにしておく
+static void add_func_def(Node *node) {
+  // 末尾の NULL のぶんも空けておく
+  if (num_func_defs + 1 >= cap_func_defs) {
+    cap_func_defs = cap_func_defs ? cap_func_defs * 2 : 16;
+    func_defs = realloc(func_defs, sizeof(Node *) * cap_func_defs);
+  }
+  func_defs[num_func_defs++] = node;
+  func_defs[num_func_defs] = NULL;
+}
+
+// 関数の本体をパーズする。現在のトークンは本体の "{" を指しているものとする
+static void parse_body(Function *fn) {
+  fn->reachable = true;
+  // 現在処理中の関数として持っておく
+  cur_func = fn;
+  // 本体は関数ごとのアリーナに置く
+  // コード生成が終わったらアリーナごと解放する
+  cur_arena = &fn->arena;
+  // 仮引数のスコープに入って、仮引数名を変数リストに追加する
+  enter_block();
+  for (int i = 0; i < fn->argc; i++)
+    register_var(fn->params[i]->name, fn->params[i]->type);
+  // ブロックが来るはず
+  expect(PU_LBRACE);
+  // 関数定義の本体をブロックにする
+  fn->body = block();
+  // 仮引数のスコープを出る
+  leave_block();
+  cur_arena = &tu_arena;
+}
+
+// 関数の本体を、対応する "}" まで読み飛ばす
+// 本体は後で parse_bodies がパーズするので、"{" の位置を覚えておく
+static void skip_body(Function *fn) {
+  Token *tok = cur_token();
+  fn->body_pos = tok->offset;
+  expect(PU_LBRACE);
+  for (int depth = 1; depth > 0; token_pos++) {
+    tok = cur_token();
+    if (tok->kind == TK_EOF)
+      error_at(token_str(tok), "ブロックが閉じていません");
+    if (tok->id == PU_LBRACE)
+      depth++;
+    else if (tok->id == PU_RBRACE)
+      depth--;
+  }
+}
+
+// 本体をパーズする関数定義の並びと、次にパーズするものの番号
+static Function **body_queue;
+static int body_queue_len;
+static int next_body;
+static mtx_t next_body_lock;
+
+// 本体をまだパーズしていない関数定義を1つずつ取ってきてパーズする
+// 関数ごとにアリーナとローカル変数の表、トークンの状態が別々なので、
+// 複数のスレッドで同時に動かしてよい
+static int parse_bodies_worker(void *arg) {
+  for (;;) {
+    mtx_lock(&next_body_lock);
+    int i = next_body++;
+    mtx_unlock(&next_body_lock);
+    if (i >= body_queue_len)
+      return 0;
+    Function *fn = body_queue[i];
+    tokenize(user_input + fn->body_pos);
+    parse_body(fn);
+  }
+}
+
+// 読み飛ばしておいた n 個の関数 fns の本体を、num_parse_threads 個のスレッドでパーズする
+static void parse_bodies(Function **fns, int n) {
+  body_queue = fns;
+  body_queue_len = n;
+  mtx_init(&next_body_lock, mtx_plain);
+  next_body = 0;
+  // このスレッドも1つとして数える
+  int num_threads = num_parse_threads - 1;
+  if (num_threads > n - 1)
+    num_threads = n > 0 ? n - 1 : 0;
+  thrd_t *threads = calloc(num_threads, sizeof(thrd_t));
+  for (int i = 0; i < num_threads; i++) {
+    if (thrd_create(&threads[i], parse_bodies_worker, NULL) != thrd_success)
+      error("スレッドを作れません");
+  }
+  parse_bodies_worker(NULL);
+  for (int i = 0; i < num_threads; i++)
+    thrd_join(threads[i], NULL);
+  free(threads);
+  mtx_destroy(&next_body_lock);
+}
+
+// 読み飛ばしておいた関数の本体をパーズする
+// compile_all_funcs が偽なら、main から始めて、パーズした本体から呼ばれている関数を
+// 順にたどり、届いた関数だけをパーズする。main がなければすべてパーズする
+static void parse_deferred_bodies() {
+  Function **queue = malloc(sizeof(Function *) * (num_func_defs + 1));
+  int len = 0;
+  Node *main_func = find_func(intern("main", 4));
+  if (compile_all_funcs || !main_func) {
+    for (int i = 0; i < num_func_defs; i++)
+      queue[len++] = func_defs[i]->func;
+  } else {
+    queue[len++] = main_func->func;
+  }
+  for (int i = 0; i < len; i++)
+    queue[i]->reachable = true;
+
+  // まだパーズしていない関数をまとめてパーズし、そこから新しく届いた関数を足す
+  int done = 0;
+  while (done < len) {
+    int end = len;
+    parse_bodies(queue + done, end - done);
+    for (int i = done; i < end; i++) {
+      for (NodeList *item = queue[i]->calls; item; item = item->next) {
+        Node *callee = find_func(item->node->name);
+        // 定義されていない関数は、ほかのファイルにあるので気にしない
+        if (callee && !callee->func->reachable) {
+          callee->func->reachable = true;
+          queue[len++] = callee->func;
+        }
+      }
+    }
+    done = end;
+  }
+  free(queue);
+}
+
+// 関数の本体に出てきた文字列リテラルに String を割り当てる
+// 関数の順、本体の中で出てきた順に割り当てるので、本体を並行してパーズしても、
+// ラベルの番号は順に読んだときと同じになる
+static void resolve_strings(Function *fn) {
+  for (NodeList *item = fn->strings; item; item = item->next) {
+    int atom = item->node->val;
+    item->node->string = intern_string(atom);
+  }
+  // リストは本体のアリーナにあるので、解放した後にたどらないようにしておく
+  fn->strings = NULL;
+}
+
 // プログラムをパーズする
 // program    = func_def*
+// まず関数の本体を読み飛ばしながらグローバル変数と関数の名前と型を登録し、
+// その後で必要な本体を並行してパーズする。
+// すべての関数を1つのスレッドでパーズするなら、本体はその場でパーズする。
+// そのとき stream_funcs が真なら、本体をパーズするたびにコードを生成して解放するので、
+// 本体の AST は一度に1つの関数のぶんしかメモリーに残らない
 void program() {
-  int func_i = 0;
-  int var_i = 0;
-  while (!at_eof()) {
-    Node *node = global_var_or_funcs();
-    if (node->kind == ND_FUNC_DEF) {
-      func_defs[func_i++] = node;
-    }
-  }
-  func_defs[func_i] = NULL;
+  // 関数が1つもなくても func_defs が NULL で終わるようにしておく
+  func_defs = calloc(1, sizeof(Node *));
+  defer_bodies = num_parse_threads > 1 || !compile_all_funcs;
+  if (defer_bodies)
+    stream_funcs = false;
+  while (!at_eof())
+    global_var_or_funcs();
+  if (defer_bodies)
+    parse_deferred_bodies();
+
+  for (int i = 0; i < num_func_defs; i++)
+    resolve_strings(func_defs[i]->func);
 }
 
 // 関数定義をパーズする
@@ -64,111 +232,128 @@ void program() {
 //            | type "*"* ident ("[" num "]")? ";" )*
 Node *global_var_or_funcs() {
   // "int" または "char" が来るはず
-  int type_kind = expect_type();
   // 次には "*"* が来る
-  Type *head = NULL;
-  Type *tail = NULL;
-  while (consume("*")) {
-    // * が一つ来るごとに、* -> * -> .. -> Int の先頭のリストを伸ばす
-    append_type(PTR, &head, &tail);
-  }
-  // 型のリストの末尾は、最初が int なら INT, char なら CHAR
-  append_type(type_kind, &head, &tail);
+  Type *head = pointers(expect_type());
   // 識別子がくるはず
   Token *tok = expect_ident();
   // "(" が来れば関数定義
-  if (consume("(")) {
+  if (consume(PU_LPAREN)) {
     // 関数定義のノードを作る
-    Node *node = calloc(1, sizeof(Node));
+    // 本体のコード生成が終わった後も名前と返り値の型を引けるように、
+    // ノードそのものは翻訳単位のアリーナに置く
+    Node *node = arena_alloc(&tu_arena, sizeof(Node));
     node->kind = ND_FUNC_DEF;
-    node->str = tok->str; // 関数名
-    node->len = tok->len; // 関数名の長さ
-    // 現在処理中の関数としてグローバルに持っておく
-    cur_func = node;
-    int i = 0;
+    Function *fn = arena_alloc(&tu_arena, sizeof(Function));
+    node->func = fn;
+    fn->name = tok->val; // 関数名の atom
+    // 関数の返り値の型を入れておく
+    node->type = head;
+    // 同じ名前の関数が二度定義されていたらエラー
+    if (find_func(fn->name))
+      error_at(token_str(tok), "関数が二重に定義されています");
+    // 呼び出し側から返り値の型を引けるように登録しておく
+    register_func(node);
+    fn->index = num_func_defs;
+    add_func_def(node);
+    // 本体から見えるのは、ここまでに宣言されたグローバル変数
+    fn->globals = global_var_list;
+    // 仮引数と本体は関数ごとのアリーナに置く
+    // コード生成が終わったらアリーナごと解放する
+    cur_arena = &fn->arena;
+    // 仮引数はいったん next でつないでおき、最後に配列にする
+    Node *params = NULL;
+    Node *last = NULL;
     // (ident ("," ident)*)? ")")
     // 次が ")" でないのなら識別子が続く
-    while (!consume(")")) {
+    while (!consume(PU_RPAREN)) {
       // "int" または "char" が来るはず
-      int type_kind = expect_type();
       // 次には "*"* が来る
-      Type *head = NULL;
-      Type *tail = NULL;
-      while (consume("*")) {
-        // * が一つ来るごとに、* -> * -> .. -> Int の先頭のリストを伸ばす
-        append_type(PTR, &head, &tail);
-      }
-      // 型のリストの末尾は int または char
-      append_type(type_kind, &head, &tail);
+      Type *head = pointers(expect_type());
       // 次は識別子のはず
       tok = expect_ident();
       // 仮引数の文字列を入れる領域を確保する
-      Node *param = calloc(1, sizeof(Node));
       // ASTノードの種類を仮引数とする
-      param->kind = ND_PARAM;
-      // 仮引数名はトークンが持つ値をそのまま使う
-      param->str = tok->str;
-      // 仮引数名の長さも同じ
-      param->len = tok->len;
+      Node *param = new_node(ND_PARAM);
+      // 仮引数名はトークンが持つ atom をそのまま使う
+      param->name = tok->val;
+      // 仮引数の型
+      param->type = head;
       // 仮引数を関数定義に追加する
-      node->args[i++] = param;
-      // 関数の返り値の型を入れておく
-      node->type = head;
+      append_node(&params, &last, param);
       // "," が来たら読み捨てる
-      consume(",");
-      // 仮引数名を変数リストに追加する
-      register_var(tok->str, tok->len, head);
+      consume(PU_COMMA);
     }
-    node->argc = i;
+    fn->params = list_to_array(params, &fn->argc);
+    cur_arena = &tu_arena;
 
-    // ブロックが来るはず
-    expect("{");
-    // 関数定義の本体をブロックにする
-    node->body = block();
+    // 本体は、後でまとめてパーズするなら読み飛ばして、そうでなければここでパーズする
+    if (defer_bodies) {
+      skip_body(fn);
+    } else {
+      fn->body_pos = cur_token()->offset;
+      parse_body(fn);
+      if (stream_funcs) {
+        resolve_strings(fn);
+        if (pipeline) {
+          // コード生成はコード生成のスレッドに任せて、次の関数を読み進める
+          send_func(node);
+        } else {
+          compile_func(node);
+          // ここまでの入力はもう読まない。次のトークンは先読みしてあるかもしれないので、
+          // その手前までを追い出す
+          release_input(token_str(cur_token()));
+        }
+      }
+    }
     return node;
   } else {
     // "[" が来れば配列の宣言
-    if (consume("[")) {
+    if (consume(PU_LBRACKET)) {
       // 次は数字が来るはず
       Node *num_node = num();
-      expect("]");
+      expect(PU_RBRACKET);
       // もし配列であれば、型は配列型で、
       // 要素の型 は head が指すものとする
-      Type *type = new_type(ARRAY);
-      type->ptr_to = head;
-      type->array_size = num_node->val;
-      head = type;
+      head = array_of(head, num_node->val);
     }
     // 変数宣言のノードをつくる
     Node *node = new_node(ND_DECL);
     // グローバル変数に登録する
-    register_global_var(tok->str, tok->len, head);
-    expect(";");
+    register_global_var(tok->val, head);
+    expect(PU_SEMI);
+    return node;
+  }
+}
+
+// 型名に続く "*"* をパーズして型を返す
+// type_kind は "int" なら INT, "char" なら CHAR
+Type *pointers(int type_kind) {
+  Type *type = basic_type(type_kind);
+  while (consume(PU_STAR)) {
+    // * が一つ来るごとに、それまでの型へのポインター型にする
+    type = pointer_to(type);
   }
+  return type;
 }
 
 // {} で囲まれたブロックをパーズする
 Node *block() {
   // ブロックを表すノードを用意する
-  // node->next で複数の文をつないでいく
+  // node->body から始めて、next で複数の文をつないでいく
   Node *node = new_node(ND_BLOCK);
-  // 文のリストの最後を指しておく
-  Node *last = node;
-  while (!consume("}")) {
+  // 文のリストの先頭と最後
+  Node *head = NULL;
+  Node *last = NULL;
+  // ブロックの中で宣言した変数はブロックの外からは見えない
+  enter_block();
+  while (!consume(PU_RBRACE)) {
     // 文を1つパーズしてノードをつくる
-    Node *cur_node = stmt();
-    // それを文のリストにつなげる
-    last->next = cur_node;
-    // 最後を交代する
-    last = cur_node;
-    while (last->next) {
-      // stmt() がノードのリストを返すことがありうるので、
-      // 末尾まで移動しておく
-      last = last->next;
-    }
+    // stmt() がノードのリストを返すことがありうるので、
+    // append_node は末尾まで移動しておく
+    append_node(&head, &last, stmt());
   }
-  // 終末の次はNULLにしておく
-  last->next = NULL;
+  node->body = head;
+  leave_block();
   return node;
 }
 
@@ -182,14 +367,16 @@ Node *new_node_array_assign(Node *var, Node *index, Node *expr) {
 }
 
 // 新しいノードをリストの末尾につなげる
+// new_node が next でつながったリストなら、その末尾を新しい末尾にする
 void append_node(Node **head, Node **tail, Node *new_node) {
   if (*head) {
     (*tail)->next = new_node;
-    *tail = new_node;
   } else {
     *head = new_node;
-    *tail = *head;
   }
+  *tail = new_node;
+  while ((*tail)->next)
+    *tail = (*tail)->next;
 }
 
 // 配列の初期化式をパーズする
@@ -201,11 +388,11 @@ Node *array_lit(Node *var_node, int len) {
   Node *head = NULL;
   Node *tail = NULL;
   int i = 0;
-  while (!consume("}")) {
+  while (!consume(PU_RBRACE)) {
     // 次が "}" でないなら式がくるはず
     Node *e = expr();
     // "," が来たら読み飛ばす
-    consume(",");
+    consume(PU_COMMA);
     // int x[] = {4, 5} のようなコードは
     // int x[2]; x[0] = 4; x[1] = 5; のように分解する
     // x[i] = e を表すノードを作る
@@ -243,55 +430,45 @@ Node *stmt() {
   int type_kind = consume_type();
   if (type_kind) {
     // 次には "*"* が来る
-    Type *head = NULL; // 型を表すリストの先頭
-    Type *tail = NULL; // リストの末尾
-    while (consume("*")) {
-      // * が一つ来るごとに、* -> * -> .. -> Int の先頭のリストを伸ばす
-      append_type(PTR, &head, &tail);
-    }
-    // 型のリストの末尾は int または char
-    append_type(type_kind, &head, &tail);
+    Type *head = pointers(type_kind);
     // 次は識別子のはず
     Token *tok = expect_ident();
     // 次に "[" が来たら配列の宣言
-    if (consume("[")) {
+    if (consume(PU_LBRACKET)) {
       Node *num_node = NULL;
-      if (!consume("]")) {
+      if (!consume(PU_RBRACKET)) {
         num_node = num();
-        expect("]");
+        expect(PU_RBRACKET);
       }
       // もし配列であれば、型は配列型で、
       // 要素の型 は head が指すものとする
-      Type *type = new_type(ARRAY);
-      type->ptr_to = head;
-      if (num_node) {
-        type->array_size = num_node->val;
-      } else {
-        // 後ほど初期化式の長さで上書きする
-        type->array_size = 0;
-      }
-      head = type;
+      // 要素数が書かれていなければ、後ほど初期化式の長さの型に差し替える
+      head = array_of(head, num_node ? num_node->val : 0);
     }
     // 変数宣言のノードをつくる
     node = new_node(ND_DECL);
     // ローカル変数に登録する
-    register_var(tok->str, tok->len, head);
+    register_var(tok->val, head);
 
-    if (consume("=")) {
+    if (consume(PU_ASSIGN)) {
       Node *var_node = new_node(ND_LVAR);
       LVar *lvar = find_lvar(tok);
-      var_node->offset = lvar->offset;
       var_node->var = lvar;
       var_node->type = lvar->type;
 
-      if (consume("{")) {
+      if (consume(PU_LBRACE)) {
         if (head->kind != ARRAY) {
-          error_at(token->str, "変数が配列ではありません");
+          error_at(token_str(cur_token()), "変数が配列ではありません");
         }
         // 配列の初期化式
         Node *array_lit_node = array_lit(var_node, head->array_size);
         node->next = array_lit_node;
-        head->array_size = node_list_length(array_lit_node);
+        if (head->array_size == 0) {
+          // 要素数を初期化式の長さにした配列型に差し替える
+          head = array_of(head->ptr_to, node_list_length(array_lit_node));
+          retype_last_var(head);
+          var_node->type = head;
+        }
       } else {
         // int x = 3 のような形の初期化式
         // int x と x = 3 の二つの文に分解する
@@ -300,25 +477,25 @@ Node *stmt() {
       }
     } else {
       if (head->kind == ARRAY && head->array_size == 0) {
-        error_at(token->str, "配列のサイズが空です");
+        error_at(token_str(cur_token()), "配列のサイズが空です");
       }
     }
-    expect(";");
+    expect(PU_SEMI);
   // block
-  } else if (consume("{")) {
+  } else if (consume(PU_LBRACE)) {
     // ブロックを表すノードを用意する
     node = block();
   // return
   } else if (consume_reserved(TK_RETURN)) {
     node = new_node_unary(ND_RETURN, expr());
-    node->str = token->str;
-    expect(";");
+    set_src_pos(node, token_str(cur_token()));
+    expect(PU_SEMI);
   // if
   } else if (consume_reserved(TK_IF)) {
     node = new_node(ND_IF);
-    expect("(");
+    expect(PU_LPAREN);
     node->cond = expr();
-    expect(")");
+    expect(PU_RPAREN);
     node->lhs = stmt();
     if (consume_reserved(TK_ELSE)) {
       node->rhs = stmt();
@@ -326,172 +503,250 @@ Node *stmt() {
   // while
   } else if (consume_reserved(TK_WHILE)) {
     node = new_node(ND_WHILE);
-    expect("(");
+    expect(PU_LPAREN);
     node->cond = expr();
-    expect(")");
+    expect(PU_RPAREN);
     node->lhs = stmt();
   // for 
   // "for" "(" expr? ";" expr? ";" expr? ")" stmt
   } else if (consume_reserved(TK_FOR)) {
     node = new_node(ND_FOR);
-    expect("(");
-    if (!consume(";")) {
+    expect(PU_LPAREN);
+    if (!consume(PU_SEMI)) {
       node->lhs = expr(); // lhs に初期化式を入れる
-      expect(";");
+      expect(PU_SEMI);
     }
-    if (!consume(";")) {
+    if (!consume(PU_SEMI)) {
       node->cond = expr(); // cond にループ条件を入れる
-      expect(";");
+      expect(PU_SEMI);
     } else {
       // 条件式が空だったら常に真で1にしておく
       node->cond = new_node_num(1);
     }
-    if (!consume(")")) {
+    if (!consume(PU_RPAREN)) {
       node->rhs = expr(); // rhs に増加式を入れる
-      expect(")");
+      expect(PU_RPAREN);
     }
     node->body = stmt();
   } else {
     node = expr();
-    node->src_pos = token->str;
-    expect(";");
+    set_src_pos(node, token_str(cur_token()));
+    expect(PU_SEMI);
   } 
   return node;
 }
 
-// 式をパーズする
-// expr       = assign
-Node *expr() {
-  return assign();
-}
+// 演算子スタックに積む演算子の種類
+typedef enum {
+  OP_NONE,   // 演算子ではない
+  OP_PAREN,  // "(" まだ対応する ")" が来ていない
+  // 単項演算子
+  OP_PLUS,   // 単項 +
+  OP_MINUS,  // 単項 -
+  OP_ADDR,   // 単項 &
+  OP_DEREF,  // 単項 *
+  OP_SIZEOF, // sizeof
+  // 二項演算子
+  OP_ASSIGN, // =
+  OP_EQ,     // ==
+  OP_NEQ,    // !=
+  OP_LT,     // <
+  OP_LTE,    // <=
+  OP_GT,     // >
+  OP_GTE,    // >=
+  OP_ADD,    // +
+  OP_SUB,    // -
+  OP_MUL,    // *
+  OP_DIV,    // /
+} OpKind;
 
-// 等式または不等式をパーズする
-// equality   = relational ("==" relational | "!=" relational)*
-Node *equality() {
-  Node *node = relational();
+// 演算子の優先順位。大きいほど強く結びつく
+// 単項演算子はどの二項演算子よりも強く結びつく
+static const unsigned char op_prec[] = {
+  [OP_PLUS] = 6, [OP_MINUS] = 6, [OP_ADDR] = 6, [OP_DEREF] = 6, [OP_SIZEOF] = 6,
+  [OP_MUL] = 5, [OP_DIV] = 5,
+  [OP_ADD] = 4, [OP_SUB] = 4,
+  [OP_LT] = 3, [OP_LTE] = 3, [OP_GT] = 3, [OP_GTE] = 3,
+  [OP_EQ] = 2, [OP_NEQ] = 2,
+  [OP_ASSIGN] = 1,
+};
 
-  for (;;) {
-    if (consume("==")) {
-      node = new_node_bin(ND_EQ, node, relational());
-    } else if (consume("!=")) {
-      node = new_node_bin(ND_NEQ, node, relational());
-    } else
-      return node;
-  }
-}
-
-// 不等式をパーズする
-// relational = add ("<" add | "<=" add | ">" add | ">=" add)*
-Node *relational() {
-  Node *node = add();
+// 記号から二項演算子を引く表。二項演算子でない記号は OP_NONE
+static const unsigned char binary_ops[] = {
+  [PU_ASSIGN] = OP_ASSIGN,
+  [PU_EQ] = OP_EQ, [PU_NEQ] = OP_NEQ,
+  [PU_LT] = OP_LT, [PU_LTE] = OP_LTE, [PU_GT] = OP_GT, [PU_GTE] = OP_GTE,
+  [PU_PLUS] = OP_ADD, [PU_MINUS] = OP_SUB,
+  [PU_STAR] = OP_MUL, [PU_SLASH] = OP_DIV,
+  [PU_AMP] = OP_NONE,
+};
 
-  for (;;) {
-    if (consume("<"))
-      node = new_node_bin(ND_LT, node, add());
-    else if (consume("<="))
-      node = new_node_bin(ND_LTE, node, add());
-    else if (consume(">"))
-      // > は左辺と右辺を逆転した < としてしまう
-      node = new_node_bin(ND_LT, add(), node);
-    else if (consume(">="))
-      // >= は左辺と右辺を逆転した <= としてしまう
-      node = new_node_bin(ND_LTE, add(), node);
-    else
-      return node;
-  }
-}
+// 記号から単項演算子を引く表。単項演算子でない記号は OP_NONE
+static const unsigned char prefix_ops[] = {
+  [PU_PLUS] = OP_PLUS, [PU_MINUS] = OP_MINUS,
+  [PU_AMP] = OP_ADDR, [PU_STAR] = OP_DEREF,
+  [PU_LPAREN] = OP_PAREN,
+};
 
-// 足し算と引き算の項をパーズする
-// add        = mul ("+" mul | "-" mul)*
-Node *add() {
-  Node *node = mul();
+// 式をパーズするときの、項と演算子のスタック
+// 関数呼び出しの引数や配列の添字で expr() が入れ子になっても、
+// 内側の expr() は外側が積んだ分より上だけを使う
+// 関数の本体はスレッドごとに並行してパーズするので、スレッドごとに持つ
+static _Thread_local Node **operands;
+static _Thread_local int num_operands;
+static _Thread_local int cap_operands;
+static _Thread_local unsigned char *operators;
+static _Thread_local int num_operators;
+static _Thread_local int cap_operators;
 
-  for (;;) {
-    if (consume("+"))
-      node = new_node_bin(ND_ADD, node, mul());
-    else if (consume("-"))
-      node = new_node_bin(ND_SUB, node, mul());
-    else
-      return node;
+// 項をスタックに積む
+static void push_operand(Node *node) {
+  if (num_operands == cap_operands) {
+    cap_operands = cap_operands ? cap_operands * 2 : 64;
+    operands = realloc(operands, sizeof(Node *) * cap_operands);
   }
+  operands[num_operands++] = node;
 }
 
-// 掛け算と割り算の項をパーズする
-// mul = unary ('*' unary | '*' unary)*
-Node *mul() {
-  Node *node = unary();
-
-  for (;;) {
-    if (consume("*"))
-      node = new_node_bin(ND_MUL, node, unary());
-    else if (consume("/"))
-      node = new_node_bin(ND_DIV, node, unary());
-    else
-      return node;
+// 演算子をスタックに積む
+static void push_operator(OpKind op) {
+  if (num_operators == cap_operators) {
+    cap_operators = cap_operators ? cap_operators * 2 : 64;
+    operators = realloc(operators, cap_operators);
   }
+  operators[num_operators++] = op;
 }
 
-// 単項演算子を含むかもしれない項をパーズする
-// unary   = ("+" | "-")? primary
-//         | "*" unary
-//         | "&" unary
-//         | "sizeof" unary
-Node *unary() {
-  if (consume("+")) {
+// 演算子スタックの先頭の演算子を、項スタックの先頭の項に適用する
+static void reduce() {
+  OpKind op = operators[--num_operators];
+  Node *rhs = operands[--num_operands];
+  switch (op) {
+  case OP_PLUS:
     // 単項 + 演算子は実質なにもしない
-    return primary();
-  }
-  if (consume("-")) {
-    // 単項 - 演算子は 0 - primary に変換する
-    return new_node_bin(ND_SUB, new_node_num(0), primary());
-  }
-  if (consume("&")) {
+    push_operand(rhs);
+    return;
+  case OP_MINUS:
+    // 単項 - 演算子は 0 - 項 に変換する
+    push_operand(new_node_bin(ND_SUB, new_node_num(0), rhs));
+    return;
+  case OP_ADDR:
     // 単項 & 演算子は、変数へのアドレスを表す
-    Node *node = unary();
-    return new_node_unary(ND_ADDR, node);
-  }
-  if (consume("*")) {
+    push_operand(new_node_unary(ND_ADDR, rhs));
+    return;
+  case OP_DEREF:
     // 単項 * 演算子は、値をアドレスだと思ってその指す値を取り出す
-    Node *node = unary();
-    return new_node_unary(ND_DEREF, node);
+    push_operand(new_node_unary(ND_DEREF, rhs));
+    return;
+  case OP_SIZEOF:
+    push_operand(new_node_num(type_size(rhs->type)));
+    return;
+  }
+
+  Node *lhs = operands[--num_operands];
+  Node *node;
+  switch (op) {
+  case OP_ASSIGN: node = new_node_bin(ND_ASSIGN, lhs, rhs); break;
+  case OP_EQ: node = new_node_bin(ND_EQ, lhs, rhs); break;
+  case OP_NEQ: node = new_node_bin(ND_NEQ, lhs, rhs); break;
+  case OP_LT: node = new_node_bin(ND_LT, lhs, rhs); break;
+  case OP_LTE: node = new_node_bin(ND_LTE, lhs, rhs); break;
+  // > は左辺と右辺を逆転した < としてしまう
+  case OP_GT: node = new_node_bin(ND_LT, rhs, lhs); break;
+  // >= は左辺と右辺を逆転した <= としてしまう
+  case OP_GTE: node = new_node_bin(ND_LTE, rhs, lhs); break;
+  case OP_ADD: node = new_node_bin(ND_ADD, lhs, rhs); break;
+  case OP_SUB: node = new_node_bin(ND_SUB, lhs, rhs); break;
+  case OP_MUL: node = new_node_bin(ND_MUL, lhs, rhs); break;
+  case OP_DIV: node = new_node_bin(ND_DIV, lhs, rhs); break;
+  default: error("unreachable: reduce");
   }
-  if (consume_reserved(TK_SIZEOF)) {
-    Node *node = unary();
-    int size = type_size(node->type);
-    return new_node_num(size);
+  push_operand(node);
+}
+
+// 式をパーズする
+// expr から unary までを、演算子の優先順位の表を使ってまとめてパーズする。
+// 項を読んだら項スタックに、演算子を読んだら演算子スタックに積み、
+// 自分より強く結びつく演算子が先に積まれていたら、それを先に適用する。
+// 関数を呼び出して入れ子を表さないので、カッコの深さはCのスタックの大きさに縛られない
+Node *expr() {
+  // この式が使うのは、スタックのこの位置から上
+  int operand_base = num_operands;
+  int operator_base = num_operators;
+  // この式の中で開いているカッコの数
+  int parens = 0;
+
+  for (;;) {
+    // 項の前に来る単項演算子と "(" を積む
+    for (;;) {
+      Token *tok = cur_token();
+      OpKind op = tok->id < sizeof(prefix_ops) ? prefix_ops[tok->id] : OP_NONE;
+      if (op == OP_NONE && tok->kind == TK_SIZEOF)
+        op = OP_SIZEOF;
+      if (op == OP_NONE)
+        break;
+      token_pos++;
+      if (op == OP_PAREN)
+        parens++;
+      push_operator(op);
+    }
+    // 項を積む
+    push_operand(primary());
+
+    // 項の後に来る ")" と二項演算子を読む
+    for (;;) {
+      Token *tok = cur_token();
+      OpKind op = tok->id < sizeof(binary_ops) ? binary_ops[tok->id] : OP_NONE;
+      if (op != OP_NONE) {
+        // 左結合の演算子は、同じ強さの演算子が積まれていても先に適用する
+        // 右結合の = は後から来たほうを先に適用する
+        while (num_operators > operator_base &&
+               operators[num_operators - 1] != OP_PAREN &&
+               (op_prec[operators[num_operators - 1]] > op_prec[op] ||
+                (op_prec[operators[num_operators - 1]] == op_prec[op] &&
+                 op != OP_ASSIGN)))
+          reduce();
+        token_pos++;
+        push_operator(op);
+        break;
+      }
+      if (parens == 0) {
+        // 式の終わり。残った演算子をすべて適用する
+        while (num_operators > operator_base)
+          reduce();
+        num_operands = operand_base;
+        return operands[operand_base];
+      }
+      // カッコが開いているなら ")" が来るはず
+      // カッコの中の演算子をすべて適用して、"(" を取り除く
+      expect(PU_RPAREN);
+      while (operators[num_operators - 1] != OP_PAREN)
+        reduce();
+      num_operators--;
+      parens--;
+    }
   }
-  // 単項演算子がなければただの primary
-  return primary();
 }
 
-// 数値かカッコ式をパーズする
+// 数値や変数、関数呼び出しをパーズする
+// カッコ式は expr() が読む
 // primary    = num
 //            | '"' string '"'
 //            | ident ("(" expr? ("," expr)* ")")?
-//            | "(" expr ")"
 //            | ident "[" expr "]"
 Node *primary() {
-  // カッコが来てればカッコに挟まれた式
-  if (consume("(")) {
-    Node *node = expr();
-    expect(")");
-    return node;
-  }
-
   // アルファベットが来てれば識別子または関数呼び出し
   Token *tok = consume_ident();
 
-  if (tok && consume("[")) {
+  if (tok && consume(PU_LBRACKET)) {
     // 変数の指す値を入れる領域を確保する
-    Node *var_node = calloc(1, sizeof(Node));
     // ASTノードの種類をローカル変数とする
-    var_node->kind = ND_LVAR;
+    Node *var_node = new_node(ND_LVAR);
     // ベースポインターからのオフセットを決めるために、
     // これまでのローカル変数リストから変数名を探す
     LVar *lvar = find_lvar(tok);
     if (lvar) {
-      // 見つかればオフセットはそれと同じになる
-      var_node->offset = lvar->offset;
+      // 見つかればその変数を指す
       var_node->var = lvar;
       // 型は変数の型
       // この時点でTの配列の型をTへのポインタ型としてしまうことはできない
@@ -505,56 +760,64 @@ Node *primary() {
         // 見つかればグローバル変数ということになる
         var_node->kind = ND_GVAR;
         var_node->var = lvar;
-        // オフセットはそれと同じになる
-        var_node->offset = lvar->offset;
         // 型は変数の型
         var_node->type = lvar->type;
       } else {
         // 見つからなければエラー
-        error_at(tok->str, "定義されていない変数です");
+        error_at(token_str(tok), "定義されていない変数です");
       }
     }
 
     // 識別子がきて、つぎが "[" なら配列の特定の要素の値
     // 配列の添字
     Node *index = expr();
-    expect("]");
+    expect(PU_RBRACKET);
     Node *array_access_node = new_node_bin(ND_ADD, var_node, index);
     Node *deref_node = new_node_unary(ND_DEREF, array_access_node);
     return deref_node;
-  } else if (tok && consume("(")) {
+  } else if (tok && consume(PU_LPAREN)) {
     // 識別子がきて、つぎが "(" なら関数呼び出し    
-    Node *node = calloc(1, sizeof(Node));
-    node->kind = ND_CALL;
-    node->str = tok->str;
-    node->len = tok->len;
-    // todo: 関数の返り値の型を見る必要があるがひとまず INT としてしまう
-    node->type = new_type(INT);
-    int i = 0;
+    Node *node = new_node(ND_CALL);
+    node->name = tok->val;
+    // すでに定義された関数なら、その返り値の型にする
+    // まだ定義されていない関数は、ひとまず INT を返すものとしてしまう
+    // 呼ばれた関数の本体もパーズするように覚えておく
+    append_node_list(&cur_func->calls, &cur_func->last_call, node);
+    Node *func = find_func(node->name);
+    // 本体を後回しにしてパーズするときは、後で定義される関数も登録済みになっている。
+    // 順に読んだときと同じになるように、それらはまだ定義されていないものとする
+    if (func && func->func->index > cur_func->index)
+      func = NULL;
+    if (func) {
+      node->type = func->type;
+    } else {
+      node->type = basic_type(INT);
+    }
+    // 実引数はいったん next でつないでおき、最後に配列にする
+    Node *args = NULL;
+    Node *last = NULL;
     // (expr ("," expr)*)? ")")
     // 次が ")" でないのなら式が続く
-    while (!consume(")")) {
+    while (!consume(PU_RPAREN)) {
       // 次は式のはず
-      node->args[i++] = expr();
+      append_node(&args, &last, expr());
       // "," が来たら読み捨てる
-      consume(",");
+      consume(PU_COMMA);
     }
-    node->argc = i;
+    node->args = list_to_array(args, &node->argc);
     return node;
   } else if (tok) {
     // 関数呼び出しでなければただの識別子
 
     // 変数の指す値を入れる領域を確保する
-    Node *node = calloc(1, sizeof(Node));
     // ASTノードの種類をローカル変数とする
-    node->kind = ND_LVAR;
+    Node *node = new_node(ND_LVAR);
     // ベースポインターからのオフセットを決めるために、
     // これまでのローカル変数リストから変数名を探す
     LVar *lvar = find_lvar(tok);
     
     if (lvar) {
-      // 見つかればオフセットはそれと同じになる
-      node->offset = lvar->offset;
+      // 見つかればその変数を指す
       node->var = lvar;
       // 型は変数の型
       // この時点でTの配列の型をTへのポインタ型としてしまうことはできない
@@ -568,21 +831,19 @@ Node *primary() {
         // 見つかればグローバル変数ということになる
         node->kind = ND_GVAR;
         node->var = lvar;
-        // オフセットはそれと同じになる
-        node->offset = lvar->offset;
         // 型は変数の型
         node->type = lvar->type;
       } else {
         // 見つからなければエラー
-        error_at(tok->str, "定義されていない変数です");
+        error_at(token_str(tok), "定義されていない変数です");
       }
     }
     return node;
   }
   // そうでなければ数値または文字列のはず
-  String *string;
-  if (string = consume_string()) {
-    return new_node_string(string);
+  tok = consume_string();
+  if (tok) {
+    return new_node_string(tok->val);
   } else {
     return num();
   }
@@ -594,12 +855,3 @@ Node *num() {
   // 次のトークンとして数値を期待して消費し、その数値を取得して数値ノードを作る
   return new_node_num(expect_number());
 }
-
-// 代入式をパーズする
-// assign     = equality ("=" assign)?
-Node *assign() {
-  Node *node = equality();
-  if (consume("="))
-    node = new_node_bin(ND_ASSIGN, node, assign());
-  return node;
-}
\ No newline at end of file
@@ -0,0 +1,513 @@
+#include "nanocc.h"
+
+// ピープホール最適化
+// 命令の並びを見て、決まった形の短い並びを、同じ働きのより短い並びに書き換える。
+// スタックマシンとして出力する gen() のコードには、積んですぐ降ろす push と pop や、
+// 読まれないうちに上書きされる mov が多いので、それらを mov にまとめたり取り除いたりする。
+//
+// ラベルやディレクティブは越えないので、書き換えは基本ブロックの中で閉じる。
+// どの書き換えも、フラグを変える命令を足したり取り除いたりしない
+
+// レジスターの名前。大きさ 8, 4, 2, 1 バイトの順
+static char *reg_names[][NUM_REGS] = {
+  {"rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi",
+   "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"},
+  {"eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi",
+   "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d"},
+  {"ax", "cx", "dx", "bx", "sp", "bp", "si", "di",
+   "r8w", "r9w", "r10w", "r11w", "r12w", "r13w", "r14w", "r15w"},
+  {"al", "cl", "dl", "bl", "spl", "bpl", "sil", "dil",
+   "r8b", "r9b", "r10b", "r11b", "r12b", "r13b", "r14b", "r15b"},
+};
+static int reg_sizes[] = {8, 4, 2, 1};
+
+// 4 文字までの名前を 1 つの整数に詰める。長すぎれば 0
+static uint32_t pack_name(char *s, int len) {
+  if (len > 4)
+    return 0;
+  uint32_t x = 0;
+  for (int i = 0; i < len; i++)
+    x |= (uint32_t)(unsigned char)s[i] << (i * 8);
+  return x;
+}
+
+// 長さ len の名前 s のレジスターの番号。大きさを *size に入れる。レジスターでなければ -1
+// 出力するすべての行のオペランドを調べるので、詰めた名前を小さなハッシュ表で引く
+static int parse_reg(char *s, int len, int *size) {
+  enum { TABLE_SIZE = 256 };
+  static struct {
+    uint32_t name;
+    int8_t reg;
+    int8_t size;
+  } table[TABLE_SIZE];
+  static bool initialized;
+  if (!initialized) {
+    for (int i = 0; i < 4; i++) {
+      for (int r = 0; r < NUM_REGS; r++) {
+        uint32_t x = pack_name(reg_names[i][r], strlen(reg_names[i][r]));
+        int h = (x * 2654435761u) >> 24;
+        while (table[h].name)
+          h = (h + 1) % TABLE_SIZE;
+        table[h].name = x;
+        table[h].reg = r;
+        table[h].size = reg_sizes[i];
+      }
+    }
+    initialized = true;
+  }
+  // レジスターの名前は英小文字で始まる 2 文字以上の名前
+  if (!islower(s[0]) || len < 2)
+    return -1;
+  uint32_t x = pack_name(s, len);
+  if (!x)
+    return -1;
+  for (int h = (x * 2654435761u) >> 24; table[h].name; h = (h + 1) % TABLE_SIZE) {
+    if (table[h].name == x) {
+      *size = table[h].size;
+      return table[h].reg;
+    }
+  }
+  return -1;
+}
+
+// レジスター r の下位 size バイトの名前
+static char *reg_name(int r, int size) {
+  for (int i = 0; i < 4; i++)
+    if (reg_sizes[i] == size)
+      return reg_names[i][r];
+  error("unreachable: reg_name");
+}
+
+// 32 ビットに収まる整数の即値のオペランドか。値を *val に入れる
+static bool is_imm(char *s, long *val) {
+  if (!isdigit(*s) && !(*s == '-' && isdigit(s[1])))
+    return false;
+  char *end;
+  *val = strtol(s, &end, 10);
+  return *end == '\0' && INT32_MIN <= *val && *val <= INT32_MAX;
+}
+
+// 調べる命令。それ以外は OP_OTHER にする
+typedef enum {
+  OP_MOV,
+  OP_MOVSX,
+  OP_MOVSXD,
+  OP_MOVZX,
+  OP_MOVZB,
+  OP_LEA,
+  OP_ADD,
+  OP_SUB,
+  OP_IMUL,
+  OP_AND,
+  OP_OR,
+  OP_XOR,
+  OP_CMP,
+  OP_TEST,
+  OP_SETCC,
+  OP_PUSH,
+  OP_POP,
+  OP_CQO,
+  OP_CDQ,
+  OP_IDIV,
+  OP_LEAVE,
+  OP_RET,
+  OP_OTHER,
+} Opcode;
+
+static char *opcode_names[] = {
+  [OP_MOV] = "mov", [OP_MOVSX] = "movsx", [OP_MOVSXD] = "movsxd",
+  [OP_MOVZX] = "movzx", [OP_MOVZB] = "movzb", [OP_LEA] = "lea",
+  [OP_ADD] = "add", [OP_SUB] = "sub", [OP_IMUL] = "imul",
+  [OP_AND] = "and", [OP_OR] = "or", [OP_XOR] = "xor",
+  [OP_CMP] = "cmp", [OP_TEST] = "test",
+  [OP_PUSH] = "push", [OP_POP] = "pop", [OP_CQO] = "cqo", [OP_CDQ] = "cdq",
+  [OP_IDIV] = "idiv", [OP_LEAVE] = "leave", [OP_RET] = "ret",
+};
+
+// args[0] = args[1] の命令か
+static bool is_move(AsmLine *line) {
+  return OP_MOV <= line->opcode && line->opcode <= OP_LEA;
+}
+
+// args[0] = args[0] と args[1] の演算 の命令か
+static bool is_arith(AsmLine *line) {
+  return OP_ADD <= line->opcode && line->opcode <= OP_XOR;
+}
+
+// args[0] と args[1] を読んでフラグだけを変える命令か
+static bool is_compare(AsmLine *line) {
+  return line->opcode == OP_CMP || line->opcode == OP_TEST;
+}
+
+// メモリーのオペランドか
+static bool is_mem(char *s) {
+  return strchr(s, '[') != NULL;
+}
+
+// 命令とオペランドを調べた結果を line に入れる
+// 書き換えを探すたびに同じ行を何度も調べるので、文字列を見るのはここだけにする
+static void analyze(AsmLine *line) {
+  line->opcode = OP_OTHER;
+  if (strncmp(line->op, "set", 3) == 0)
+    line->opcode = OP_SETCC;
+  for (int i = 0; i < OP_OTHER; i++) {
+    char *name = opcode_names[i];
+    if (name && name[0] == line->op[0] && strcmp(line->op, name) == 0) {
+      line->opcode = i;
+      break;
+    }
+  }
+
+  for (int i = 0; i < MAX_ASM_ARGS; i++) {
+    line->arg_reg[i] = -1;
+    line->arg_uses[i] = 0;
+    if (i >= line->num_args)
+      continue;
+    char *s = line->args[i];
+    if (!is_mem(s)) {
+      line->arg_reg[i] = parse_reg(s, strlen(s), &line->arg_size[i]);
+      if (line->arg_reg[i] >= 0)
+        line->arg_uses[i] = 1 << line->arg_reg[i];
+      continue;
+    }
+    // メモリーなら、アドレスの計算に出てくるレジスターを集める
+    while (*s) {
+      if (!isalnum(*s)) {
+        s++;
+        continue;
+      }
+      char *name = s;
+      while (isalnum(*s))
+        s++;
+      int size;
+      int r = parse_reg(name, s - name, &size);
+      if (r >= 0)
+        line->arg_uses[i] |= 1 << r;
+    }
+  }
+}
+
+// 命令がレジスターを読むか、書くか、すべてのビットを上書きするか
+enum {
+  READ = 1,   // 命令の前の値を使う。一部だけ書き換えるときも、残りを使うので読むことにする
+  WRITE = 2,  // 値を変える
+  KILL = 4,   // 前の値を使わずにすべてのビットを上書きする
+};
+
+// i 番目のオペランドをレジスター r について読むときの働き
+static int read_operand(AsmLine *line, int i, int r) {
+  return line->arg_uses[i] & (1 << r) ? READ : 0;
+}
+
+// i 番目のオペランドに書くときの、レジスター r についての働き
+// メモリーに書くなら、アドレスの計算に使うレジスターを読む。
+// 4 バイト以上のレジスターに書くと上位も 0 か符号で埋まるので、すべてのビットを上書きする
+static int write_operand(AsmLine *line, int i, int r, bool reads) {
+  if (line->arg_reg[i] != r)
+    return read_operand(line, i, r);
+  if (reads || line->arg_size[i] < 4)
+    return READ | WRITE;
+  return WRITE | KILL;
+}
+
+// 命令 line がレジスター r を読み書きするかを返す
+// 飛ぶ命令や呼び出しのように、その先がわからない命令は -1 を返す
+static int reg_effect(AsmLine *line, int r) {
+  if ((is_move(line) || is_arith(line) || is_compare(line)) && line->num_args != 2)
+    return -1;
+  switch (line->opcode) {
+  case OP_MOV:
+  case OP_MOVSX:
+  case OP_MOVSXD:
+  case OP_MOVZX:
+  case OP_MOVZB:
+  case OP_LEA:
+    return write_operand(line, 0, r, false) | read_operand(line, 1, r);
+  case OP_ADD:
+  case OP_SUB:
+  case OP_IMUL:
+  case OP_AND:
+  case OP_OR:
+  case OP_XOR:
+    return write_operand(line, 0, r, true) | read_operand(line, 1, r);
+  case OP_CMP:
+  case OP_TEST:
+    return read_operand(line, 0, r) | read_operand(line, 1, r);
+  case OP_SETCC:
+    return write_operand(line, 0, r, true);
+  case OP_PUSH:
+    return (r == RSP ? READ | WRITE : 0) | read_operand(line, 0, r);
+  case OP_POP:
+    return r == RSP ? READ | WRITE : write_operand(line, 0, r, false);
+  // 符号拡張と割り算は rax と rdx を暗に使う
+  case OP_CQO:
+  case OP_CDQ:
+    return r == RAX ? READ : r == RDX ? WRITE | KILL : 0;
+  case OP_IDIV:
+    return r == RAX || r == RDX ? READ | WRITE : read_operand(line, 0, r);
+  case OP_LEAVE:
+    return r == RBP ? READ | WRITE : r == RSP ? WRITE | KILL : 0;
+  default:
+    return -1;
+  }
+}
+
+// 関数から戻るときに呼び出し元が読むレジスター。返り値と callee-saved のもの
+static bool live_at_ret(int r) {
+  return r == RAX || r == RBX || r == RSP || r == RBP ||
+         r == R12 || r == R13 || r == R14 || r == R15;
+}
+
+// i より後の、取り除いていない次の命令の番号
+// コメントは飛ばし、ラベルやディレクティブか終わりに来たら -1
+static int next_inst(AsmLine *lines, int n, int i) {
+  for (int j = i + 1; j < n; j++) {
+    if (lines[j].dead || lines[j].kind == ASM_COMMENT)
+      continue;
+    return lines[j].kind == ASM_INST ? j : -1;
+  }
+  return -1;
+}
+
+// 命令 i の後で、レジスター r の今の値がもう読まれないか
+// ブロックの終わりまでに上書きされるとわかったときだけ真にする
+static bool is_dead_after(AsmLine *lines, int n, int i, int r) {
+  for (int j = next_inst(lines, n, i); j >= 0; j = next_inst(lines, n, j)) {
+    if (lines[j].opcode == OP_RET)
+      return !live_at_ret(r);
+    int e = reg_effect(&lines[j], r);
+    if (e < 0 || (e & READ))
+      return false;
+    if (e & KILL)
+      return true;
+  }
+  return false;
+}
+
+// 命令の i 番目のオペランドを arg に書き換える
+static void set_arg(AsmLine *line, int i, char *arg) {
+  line->args[i] = arg;
+  line->text = NULL;
+  analyze(line);
+}
+
+// 命令を op args[0], args[1] に書き換える
+static void set_inst(AsmLine *line, char *op, char *dst, char *src) {
+  line->op = op;
+  line->args[0] = dst;
+  line->args[1] = src;
+  line->num_args = 2;
+  line->text = NULL;
+  analyze(line);
+}
+
+// push X と、その後の pop Y を mov Y, X にする。X と Y が同じなら両方取り除く
+// 間の命令が、スタックに触らず、X を変えず、Y を読み書きしなければ、
+// 間を越えて組にできる。メモリーを積むときは、間に命令がないときだけ
+static bool combine_push_pop(AsmLine *lines, int n, int i) {
+  AsmLine *push = &lines[i];
+  if (push->opcode != OP_PUSH)
+    return false;
+  char *x = push->args[0];
+  int xr = push->arg_reg[0];
+  int j = next_inst(lines, n, i);
+  while (j >= 0 && reg_effect(&lines[j], RSP) == 0)
+    j = next_inst(lines, n, j);
+  if (j < 0 || lines[j].opcode != OP_POP)
+    return false;
+  AsmLine *pop = &lines[j];
+  int yr = pop->arg_reg[0];
+  if (yr < 0 || pop->arg_size[0] != 8)
+    return false;
+  for (int k = next_inst(lines, n, i); k != j; k = next_inst(lines, n, k)) {
+    if (is_mem(x) || reg_effect(&lines[k], yr) != 0)
+      return false;
+    if (xr >= 0 && (reg_effect(&lines[k], xr) & WRITE))
+      return false;
+  }
+  push->dead = true;
+  if (xr == yr) {
+    pop->dead = true;
+    return true;
+  }
+  if (!pop->comment)
+    pop->comment = push->comment;
+  set_inst(pop, "mov", pop->args[0], x);
+  return true;
+}
+
+// 読まれないうちに上書きされるレジスターへの mov や lea を取り除く
+// 同じレジスターどうしの 64 ビットの mov もなにもしないので取り除く
+static bool remove_dead_move(AsmLine *lines, int n, int i) {
+  AsmLine *line = &lines[i];
+  if (!is_move(line) || line->num_args != 2)
+    return false;
+  int r = line->arg_reg[0];
+  int size = line->arg_size[0];
+  if (r < 0 || size < 4)
+    return false;
+  bool self = line->opcode == OP_MOV && size == 8 && line->arg_reg[1] == r &&
+              line->arg_size[1] == 8;
+  if (!self && !is_dead_after(lines, n, i, r))
+    return false;
+  line->dead = true;
+  return true;
+}
+
+// mov R, 即値 の直後の命令が R を右のオペランドとして読み、その後 R を読まないなら、
+// 即値を直接オペランドにして mov を取り除く
+static bool fold_immediate(AsmLine *lines, int n, int i) {
+  AsmLine *line = &lines[i];
+  long imm;
+  if (line->opcode != OP_MOV || line->num_args != 2 || !is_imm(line->args[1], &imm))
+    return false;
+  int r = line->arg_reg[0];
+  if (r < 0 || line->arg_size[0] < 4)
+    return false;
+  int j = next_inst(lines, n, i);
+  if (j < 0)
+    return false;
+  AsmLine *use = &lines[j];
+  bool foldable = is_arith(use) || is_compare(use) || use->opcode == OP_MOV;
+  if (!foldable || use->num_args != 2 || use->arg_reg[1] != r || read_operand(use, 0, r))
+    return false;
+  int size = use->arg_size[1];
+  // 書く先が 1 バイトなら、その大きさに収まる即値だけ
+  if (size == 1 && (imm < -128 || 255 < imm))
+    return false;
+  if (size < 4 && !is_mem(use->args[0]))
+    return false;
+  // 大きさの名前のないメモリーに即値を書くと、大きさが決まらない
+  if (is_mem(use->args[0]) && !strstr(use->args[0], "PTR"))
+    return false;
+  if (!is_dead_after(lines, n, j, r))
+    return false;
+  set_arg(use, 1, line->args[1]);
+  line->dead = true;
+  return true;
+}
+
+// mov R, A の直後の mov R の下位 1 バイト, B は、A が 1 バイトに収まる正の数なら
+// 合わせて mov R の下位 4 バイト, B になる。呼び出しの前に al を 0 にするところなど
+static bool merge_byte_move(AsmLine *lines, int n, int i) {
+  AsmLine *line = &lines[i];
+  long a, b;
+  if (line->opcode != OP_MOV || line->num_args != 2 || !is_imm(line->args[1], &a) ||
+      a < 0 || 255 < a)
+    return false;
+  int r = line->arg_reg[0];
+  if (r < 0 || line->arg_size[0] < 4)
+    return false;
+  int j = next_inst(lines, n, i);
+  if (j < 0)
+    return false;
+  AsmLine *next = &lines[j];
+  if (next->opcode != OP_MOV || next->num_args != 2 ||
+      next->arg_reg[0] != r || next->arg_size[0] != 1 ||
+      !is_imm(next->args[1], &b) || b < 0 || 255 < b)
+    return false;
+  set_inst(next, "mov", reg_name(r, 4), next->args[1]);
+  line->dead = true;
+  return true;
+}
+
+// lea R, M の直後の命令が [R] を読み書きし、その後 R を読まないなら、M を直接使う
+static bool fold_address(AsmLine *lines, int n, int i) {
+  AsmLine *line = &lines[i];
+  if (line->opcode != OP_LEA || line->num_args != 2)
+    return false;
+  int r = line->arg_reg[0];
+  if (r < 0 || line->arg_size[0] != 8)
+    return false;
+  int j = next_inst(lines, n, i);
+  if (j < 0)
+    return false;
+  AsmLine *use = &lines[j];
+  if (!is_move(use) && !is_arith(use) && !is_compare(use))
+    return false;
+  if (use->num_args != 2 || use->opcode == OP_LEA)
+    return false;
+
+  // [R] の形のオペランドを探す。もう一方は R を読んではいけない
+  char mem[16];
+  sprintf(mem, "[%s]", reg_name(r, 8));
+  int k = -1;
+  for (int a = 0; a < 2; a++) {
+    char *s = use->args[a];
+    size_t len = strlen(s);
+    if (len >= strlen(mem) && strcmp(s + len - strlen(mem), mem) == 0 &&
+        (len == strlen(mem) || s[len - strlen(mem) - 1] == ' '))
+      k = a;
+  }
+  if (k < 0)
+    return false;
+  int e;
+  if (k == 0)
+    e = read_operand(use, 1, r);
+  else if (is_compare(use))
+    e = read_operand(use, 0, r);
+  else
+    e = write_operand(use, 0, r, is_arith(use));
+  if (e & READ)
+    return false;
+  if (!(e & KILL) && !is_dead_after(lines, n, j, r))
+    return false;
+
+  // 大きさの名前はそのまま残して、[R] を M に置き換える
+  char *s = use->args[k];
+  size_t prefix = strlen(s) - strlen(mem);
+  char *buf = arena_alloc(cur_arena, prefix + strlen(line->args[1]) + 1);
+  memcpy(buf, s, prefix);
+  strcpy(buf + prefix, line->args[1]);
+  set_arg(use, k, buf);
+  line->dead = true;
+  return true;
+}
+
+// R に値を作る命令の直後の mov Y, R は、R をその後読まないなら、はじめから Y に作ればよい
+static bool forward_move(AsmLine *lines, int n, int i) {
+  AsmLine *def = &lines[i];
+  bool is_pop = def->opcode == OP_POP;
+  if (!is_pop && (!is_move(def) || def->num_args != 2))
+    return false;
+  int r = def->arg_reg[0];
+  int dsize = def->arg_size[0];
+  if (r < 0 || dsize < 4 || (is_pop && dsize != 8))
+    return false;
+  int j = next_inst(lines, n, i);
+  if (j < 0)
+    return false;
+  AsmLine *mov = &lines[j];
+  if (mov->opcode != OP_MOV || mov->num_args != 2 || mov->arg_reg[1] != r ||
+      mov->arg_size[1] != 8)
+    return false;
+  int y = mov->arg_reg[0];
+  if (y < 0 || mov->arg_size[0] != 8 || y == RSP || y == r)
+    return false;
+  if (!is_dead_after(lines, n, j, r))
+    return false;
+  set_arg(def, 0, reg_name(y, dsize));
+  mov->dead = true;
+  return true;
+}
+
+// 命令の並びを、書き換えられなくなるまで書き換える
+// 取り除いた命令には dead を立てる
+void optimize_peephole(AsmLine *lines, int n) {
+  for (int i = 0; i < n; i++)
+    if (lines[i].kind == ASM_INST)
+      analyze(&lines[i]);
+
+  for (bool changed = true; changed;) {
+    changed = false;
+    for (int i = 0; i < n; i++) {
+      AsmLine *line = &lines[i];
+      if (line->dead || line->kind != ASM_INST)
+        continue;
+      if (combine_push_pop(lines, n, i) || remove_dead_move(lines, n, i) ||
+          fold_immediate(lines, n, i) || merge_byte_move(lines, n, i) ||
+          fold_address(lines, n, i) || forward_move(lines, n, i))
+        changed = true;
+    }
+  }
+}
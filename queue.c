@@ -0,0 +1,46 @@
+#include "nanocc.h"
+// 2つのスレッドから読み書きする位置
+#include <stdatomic.h>
+// 待つ間にほかのスレッドに譲る thrd_yield
+#include <threads.h>
+
+// 待ち行列 (queue)
+// 1つのスレッドだけが入れて、1つのスレッドだけが取り出す、大きさの決まった待ち行列。
+// 入れる側は tail だけを、取り出す側は head だけを書き換えるので、ロックはいらない。
+// 満杯のときに入れようとしたり、空のときに取り出そうとしたりすると、
+// ほかのスレッドに譲りながら待つ
+struct Queue {
+  void **items;
+  size_t cap;           // items の大きさ。2 の累乗
+  _Atomic size_t head;  // 次に取り出す位置。取り出した個数
+  _Atomic size_t tail;  // 次に入れる位置。入れた個数
+};
+
+// 要素を cap 個まで入れられる待ち行列を作る。cap は 2 の累乗にする
+Queue *new_queue(int cap) {
+  Queue *q = calloc(1, sizeof(Queue));
+  q->items = calloc(cap, sizeof(void *));
+  q->cap = cap;
+  return q;
+}
+
+// 待ち行列の末尾に item を入れる
+void queue_push(Queue *q, void *item) {
+  size_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+  while (tail - atomic_load_explicit(&q->head, memory_order_acquire) == q->cap)
+    thrd_yield();
+  q->items[tail & (q->cap - 1)] = item;
+  // item を書いてから tail を進めるので、取り出す側には書いた後の item が見える
+  atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+}
+
+// 待ち行列の先頭から1つ取り出して返す
+void *queue_pop(Queue *q) {
+  size_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+  while (atomic_load_explicit(&q->tail, memory_order_acquire) == head)
+    thrd_yield();
+  void *item = q->items[head & (q->cap - 1)];
+  // item を読んでから head を進めるので、入れる側が上書きするのはその後になる
+  atomic_store_explicit(&q->head, head + 1, memory_order_release);
+  return item;
+}
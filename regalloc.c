@@ -0,0 +1,307 @@
+#include "nanocc.h"
+
+// 線形走査 (linear scan) によるレジスター割り当て
+// Poletto, Sarkar の "Linear Scan Register Allocation" による。
+//
+// ブロックを出力する順に命令へ位置の番号を振り、値が生きている範囲を
+// 1つの区間 [start, end] で近似する。区間を始まりの順に見ていき、空いている
+// レジスターを割り当てる。空きがなければ、区間の終わりがもっとも遠い値を
+// スタックに追い出す (spill)。
+//
+// rax, rdx, r11 は出力のときに作業用に使うので割り当てない。rax は返り値と
+// 割り算と並列の移動の循環を切るため、rdx は割り算のため、r11 はスタックに
+// 置いた値を読むためのもの。rsp と rbp を除いた残りの 11 個を割り当てる。
+// 関数呼び出しは caller-saved のレジスターを壊すので、呼び出しをまたいで
+// 生きる値には callee-saved のレジスターだけを使う
+
+// 値の生きている区間
+typedef struct {
+  Inst *val;
+  int start;         // 定義の位置。ブロックの入口で生きているならその位置まで広げる
+  int end;           // 最後に使う位置。ブロックの出口で生きているならその位置まで広げる
+  bool across_call;  // 途中に関数呼び出しがあるか
+} Interval;
+
+// 呼び出しで壊されないレジスター。関数の入口で保存して出口で戻す必要がある
+static int callee_saved[] = {RBX, R12, R13, R14, R15};
+// 呼び出しで壊されうるレジスター。保存しなくてよいので先に使う
+static int caller_saved[] = {RCX, RSI, RDI, R8, R9, R10};
+
+// 引数を渡すレジスター
+static int param_regs[] = {RDI, RSI, RDX, RCX, R8, R9};
+#define NUM_PARAM_REGS 6
+
+#define NUM_CALLEE_SAVED (sizeof(callee_saved) / sizeof(*callee_saved))
+#define NUM_CALLER_SAVED (sizeof(caller_saved) / sizeof(*caller_saved))
+
+// レジスターに置く値か。使うところで作り直せる値と、値を持たない命令は置かない
+static bool needs_reg(Inst *inst) {
+  return inst->size && !is_remat(inst);
+}
+
+// ブロックをまたいで値を使うところ
+// ほとんどの値は定義したブロックの中で使い終わるので、それらは数えない
+typedef struct {
+  Block *block;
+  bool at_end;  // phi のオペランドとして、ブロックの出口で使う
+} Use;
+
+// 区間を位置 pos を含むように広げる
+static void extend(Interval *iv, int pos) {
+  if (pos < iv->start)
+    iv->start = pos;
+  if (pos > iv->end)
+    iv->end = pos;
+}
+
+// ブロックをまたいで使う値の区間を、使うところから定義まで広げる
+// SSA では定義が使うところを支配するので、使うブロックから前のブロックを
+// 定義のブロックに着くまでさかのぼれば、その間のブロックの入口と出口で生きている。
+// 値ごとに使うところをまとめてさかのぼり、一度見たブロックはもう見ないので、
+// 手間は値が生きているブロックの数に比例する。
+// phi のオペランドは、phi のブロックではなく、前のブロックの出口で使う
+static void extend_live_ranges(IrFunc *f, Interval *intervals,
+                               int *block_start, int *block_end) {
+  // 値ごとの使うところの数を数えて、並びを値の番号で区切る
+  int *first_use = arena_alloc(cur_arena, sizeof(int) * (f->num_values + 1));
+  memset(first_use, 0, sizeof(int) * (f->num_values + 1));
+  for (Block *b = f->entry; b; b = b->next)
+    for (Inst *inst = b->first; inst; inst = inst->next)
+      for (int j = 0; j < inst->num_args; j++) {
+        Inst *arg = inst->args[j];
+        if (needs_reg(arg) && (arg->block != b || inst->op == IR_PHI))
+          first_use[arg->id + 1]++;
+      }
+  for (int i = 0; i < f->num_values; i++)
+    first_use[i + 1] += first_use[i];
+
+  Use *uses = arena_alloc(cur_arena, sizeof(Use) * first_use[f->num_values]);
+  int *num_uses = arena_alloc(cur_arena, sizeof(int) * f->num_values);
+  memset(num_uses, 0, sizeof(int) * f->num_values);
+  for (Block *b = f->entry; b; b = b->next)
+    for (Inst *inst = b->first; inst; inst = inst->next)
+      for (int j = 0; j < inst->num_args; j++) {
+        Inst *arg = inst->args[j];
+        if (!needs_reg(arg) || (arg->block == b && inst->op != IR_PHI))
+          continue;
+        Use *use = &uses[first_use[arg->id] + num_uses[arg->id]++];
+        if (inst->op == IR_PHI) {
+          use->block = inst->phi_preds[j];
+          use->at_end = true;
+        } else {
+          use->block = b;
+          use->at_end = false;
+        }
+      }
+
+  // visited[ブロックの番号] は、そのブロックの入口で生きているとした最後の値の番号
+  int *visited = arena_alloc(cur_arena, sizeof(int) * f->num_blocks);
+  for (int i = 0; i < f->num_blocks; i++)
+    visited[i] = -1;
+  Block **stack = arena_alloc(cur_arena, sizeof(Block *) * f->num_blocks);
+
+  for (int i = 0; i < f->num_values; i++) {
+    Interval *iv = &intervals[i];
+    Block *def = iv->val ? iv->val->block : NULL;
+    int sp = 0;
+    for (int k = first_use[i]; k < first_use[i + 1]; k++) {
+      Block *b = uses[k].block;
+      if (uses[k].at_end) {
+        extend(iv, block_end[b->id]);
+        if (b == def)
+          continue;
+      }
+      if (visited[b->id] != i) {
+        visited[b->id] = i;
+        stack[sp++] = b;
+      }
+      // 入口で生きているなら、前のブロックの出口でも生きている
+      while (sp > 0) {
+        Block *cur = stack[--sp];
+        extend(iv, block_start[cur->id]);
+        for (int j = 0; j < cur->num_preds; j++) {
+          Block *pred = cur->preds[j];
+          extend(iv, block_end[pred->id]);
+          if (pred != def && visited[pred->id] != i) {
+            visited[pred->id] = i;
+            stack[sp++] = pred;
+          }
+        }
+      }
+    }
+  }
+}
+
+// 生きている区間を求める。intervals は値の番号で引く
+// 位置は出力の順に命令ごとに 2 ずつ振り、ブロックの出口はその最後の命令の次の奇数にする
+static void build_intervals(IrFunc *f, Interval *intervals) {
+  for (int i = 0; i < f->num_values; i++) {
+    intervals[i].start = INT32_MAX;
+    intervals[i].end = -1;
+  }
+
+  // 関数呼び出しの位置
+  int num_calls = 0;
+  int cap_calls = 16;
+  int *calls = arena_alloc(cur_arena, sizeof(int) * cap_calls);
+
+  // 各ブロックの入口と出口の位置
+  int *block_start = arena_alloc(cur_arena, sizeof(int) * f->num_blocks);
+  int *block_end = arena_alloc(cur_arena, sizeof(int) * f->num_blocks);
+  int pos = 0;
+  for (Block *b = f->entry; b; b = b->next) {
+    block_start[b->id] = pos;
+    for (Inst *inst = b->first; inst; inst = inst->next)
+      pos += 2;
+    block_end[b->id] = pos - 1;
+  }
+
+  pos = 0;
+  for (Block *b = f->entry; b; b = b->next) {
+    for (Inst *inst = b->first; inst; inst = inst->next, pos += 2) {
+      if (inst->op != IR_PHI)
+        for (int j = 0; j < inst->num_args; j++)
+          if (needs_reg(inst->args[j]))
+            extend(&intervals[inst->args[j]->id], pos);
+      if (needs_reg(inst)) {
+        intervals[inst->id].val = inst;
+        // 仮引数は関数の入口でレジスターに入っているので、入口から生きている
+        extend(&intervals[inst->id], inst->op == IR_PARAM ? -1 : pos);
+      }
+      // phi の値は前のブロックの出口で移すので、そこから生きている
+      if (inst->op == IR_PHI)
+        for (int j = 0; j < inst->num_args; j++)
+          extend(&intervals[inst->id], block_end[inst->phi_preds[j]->id]);
+      if (inst->op == IR_CALL) {
+        if (num_calls == cap_calls) {
+          int *buf = arena_alloc(cur_arena, sizeof(int) * cap_calls * 2);
+          memcpy(buf, calls, sizeof(int) * num_calls);
+          calls = buf;
+          cap_calls *= 2;
+        }
+        calls[num_calls++] = pos;
+      }
+    }
+  }
+  extend_live_ranges(f, intervals, block_start, block_end);
+
+  // 区間の内側に関数呼び出しがあるかを、呼び出しの位置の二分探索で調べる
+  for (int i = 0; i < f->num_values; i++) {
+    Interval *iv = &intervals[i];
+    if (!iv->val)
+      continue;
+    int lo = 0, hi = num_calls;
+    while (lo < hi) {
+      int mid = (lo + hi) / 2;
+      if (calls[mid] <= iv->start)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    iv->across_call = lo < num_calls && calls[lo] < iv->end;
+  }
+}
+
+// 区間を始まりの順に並べる
+static int compare_start(const void *a, const void *b) {
+  Interval *x = *(Interval **)a;
+  Interval *y = *(Interval **)b;
+  if (x->start != y->start)
+    return x->start < y->start ? -1 : 1;
+  return x->val->id - y->val->id;
+}
+
+// レジスター r を区間 iv の値に使えるか
+static bool reg_allowed(Interval *iv, int r) {
+  if (!iv->across_call)
+    return true;
+  for (int i = 0; i < NUM_CALLEE_SAVED; i++)
+    if (callee_saved[i] == r)
+      return true;
+  return false;
+}
+
+// 関数の値にレジスターを割り当てる。割り当てられなかった値の reg は -1 にする
+void allocate_registers(IrFunc *f) {
+  Interval *intervals = arena_alloc(cur_arena, sizeof(Interval) * f->num_values);
+  build_intervals(f, intervals);
+
+  int num_sorted = 0;
+  Interval **sorted = arena_alloc(cur_arena, sizeof(Interval *) * f->num_values);
+  for (int i = 0; i < f->num_values; i++)
+    if (intervals[i].val)
+      sorted[num_sorted++] = &intervals[i];
+  qsort(sorted, num_sorted, sizeof(Interval *), compare_start);
+
+  for (Block *b = f->entry; b; b = b->next)
+    for (Inst *inst = b->first; inst; inst = inst->next)
+      inst->reg = -1;
+
+  // いまレジスターを使っている区間。終わりの順に並べておく
+  Interval *active[NUM_REGS];
+  int num_active = 0;
+  bool used[NUM_REGS] = {false};
+
+  for (int i = 0; i < num_sorted; i++) {
+    Interval *cur = sorted[i];
+
+    // 終わった区間のレジスターを空ける
+    // 最後に使う位置で定義する値は、その命令のオペランドと同じレジスターでよい
+    int n = 0;
+    for (int j = 0; j < num_active; j++) {
+      if (active[j]->end <= cur->start)
+        used[active[j]->val->reg] = false;
+      else
+        active[n++] = active[j];
+    }
+    num_active = n;
+
+    // 空いているレジスターを探す。呼び出しをまたがなければ caller-saved から使う
+    // 仮引数は、渡されたレジスターが空いていればそのまま使う
+    int r = -1;
+    Inst *val = cur->val;
+    if (val->op == IR_PARAM && val->imm < NUM_PARAM_REGS) {
+      int hint = param_regs[val->imm];
+      if (hint != RDX && !used[hint] && reg_allowed(cur, hint))
+        r = hint;
+    }
+    if (!cur->across_call)
+      for (int j = 0; j < NUM_CALLER_SAVED && r < 0; j++)
+        if (!used[caller_saved[j]])
+          r = caller_saved[j];
+    for (int j = 0; j < NUM_CALLEE_SAVED && r < 0; j++)
+      if (!used[callee_saved[j]])
+        r = callee_saved[j];
+
+    if (r < 0) {
+      // 空きがなければ、使えるレジスターを持つ区間のうち、もっとも遠くまで続くものを追い出す
+      int victim = -1;
+      for (int j = num_active - 1; j >= 0; j--) {
+        if (reg_allowed(cur, active[j]->val->reg)) {
+          victim = j;
+          break;
+        }
+      }
+      if (victim < 0 || active[victim]->end <= cur->end) {
+        // 自分がもっとも遠くまで続くなら、自分をスタックに置く
+        continue;
+      }
+      r = active[victim]->val->reg;
+      active[victim]->val->reg = -1;
+      memmove(&active[victim], &active[victim + 1],
+              sizeof(Interval *) * (num_active - victim - 1));
+      num_active--;
+    }
+
+    cur->val->reg = r;
+    used[r] = true;
+    // 終わりの順になるように入れる
+    int j = num_active;
+    while (j > 0 && active[j - 1]->end > cur->end) {
+      active[j] = active[j - 1];
+      j--;
+    }
+    active[j] = cur;
+    num_active++;
+  }
+}
@@ -0,0 +1,220 @@
+#include "nanocc.h"
+
+// トークナイザーの内側のループで使う、文字の並びを読み飛ばす関数群。
+// 16 バイト (SSE2) または 32 バイト (AVX2) ずつまとめて調べて、
+// 止まるべき文字の位置を返す。どの種類も '\0' では必ず止まる。
+//
+// SIMD 版はブロックの境界に揃えて読む。揃えて読めばページをまたがないので、
+// 入力の終わりの '\0' を越えて読んでも落ちることはない。
+
+#ifdef __x86_64__
+#include <immintrin.h>
+#include <x86intrin.h>
+#endif
+
+// 1バイトずつ調べる版。どの CPU でも動く
+static char *scan_scalar(char *p, ScanKind kind) {
+  switch (kind) {
+  case SCAN_SPACE:
+    while (*p == ' ' || ('\t' <= *p && *p <= '\r'))
+      p++;
+    return p;
+  case SCAN_LINE:
+    while (*p && *p != '\n')
+      p++;
+    return p;
+  case SCAN_COMMENT:
+    while (*p && *p != '*')
+      p++;
+    return p;
+  case SCAN_LOWER:
+    while ('a' <= *p && *p <= 'z')
+      p++;
+    return p;
+  case SCAN_STRING:
+    while (*p && *p != '"' && *p != '\\')
+      p++;
+    return p;
+  }
+  error("unreachable: scan_scalar");
+}
+
+#ifdef __x86_64__
+// 16 バイトのうち、止まるべき文字の位置のビットを立てたマスクを返す
+static inline __attribute__((always_inline))
+unsigned sse2_stop_mask(__m128i v, ScanKind kind) {
+  __m128i zero = _mm_cmpeq_epi8(v, _mm_setzero_si128());
+  __m128i hit;
+  switch (kind) {
+  case SCAN_SPACE: {
+    // ' ' か '\t'..'\r' 以外で止まる
+    __m128i sp = _mm_cmpeq_epi8(v, _mm_set1_epi8(' '));
+    __m128i d = _mm_sub_epi8(v, _mm_set1_epi8('\t'));
+    __m128i ctl = _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(4)), d);
+    return ~_mm_movemask_epi8(_mm_or_si128(sp, ctl)) & 0xffff;
+  }
+  case SCAN_LOWER: {
+    // 'a'..'z' 以外で止まる
+    __m128i d = _mm_sub_epi8(v, _mm_set1_epi8('a'));
+    __m128i lower = _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(25)), d);
+    return ~_mm_movemask_epi8(lower) & 0xffff;
+  }
+  case SCAN_LINE:
+    hit = _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'));
+    break;
+  case SCAN_COMMENT:
+    hit = _mm_cmpeq_epi8(v, _mm_set1_epi8('*'));
+    break;
+  case SCAN_STRING:
+    hit = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')),
+                       _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+    break;
+  }
+  return _mm_movemask_epi8(_mm_or_si128(hit, zero));
+}
+
+// 16 バイトずつ調べる。kind は定数で渡して、種類ごとに展開させる
+static inline __attribute__((always_inline))
+char *sse2_loop(char *p, ScanKind kind) {
+  // 16 バイト境界に揃えて、p より前の部分はマスクで捨てる
+  int off = (uintptr_t)p & 15;
+  char *q = p - off;
+  unsigned mask = sse2_stop_mask(_mm_load_si128((__m128i *)q), kind) >> off << off;
+  while (!mask) {
+    q += 16;
+    mask = sse2_stop_mask(_mm_load_si128((__m128i *)q), kind);
+  }
+  return q + __builtin_ctz(mask);
+}
+
+// 16 バイトずつ調べる版。x86-64 なら必ず使える
+static char *scan_sse2(char *p, ScanKind kind) {
+  switch (kind) {
+  case SCAN_SPACE: return sse2_loop(p, SCAN_SPACE);
+  case SCAN_LINE: return sse2_loop(p, SCAN_LINE);
+  case SCAN_COMMENT: return sse2_loop(p, SCAN_COMMENT);
+  case SCAN_LOWER: return sse2_loop(p, SCAN_LOWER);
+  case SCAN_STRING: return sse2_loop(p, SCAN_STRING);
+  }
+  error("unreachable: scan_sse2");
+}
+
+// 32 バイトのうち、止まるべき文字の位置のビットを立てたマスクを返す
+static inline __attribute__((always_inline, target("avx2")))
+unsigned avx2_stop_mask(__m256i v, ScanKind kind) {
+  __m256i zero = _mm256_cmpeq_epi8(v, _mm256_setzero_si256());
+  __m256i hit;
+  switch (kind) {
+  case SCAN_SPACE: {
+    __m256i sp = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' '));
+    __m256i d = _mm256_sub_epi8(v, _mm256_set1_epi8('\t'));
+    __m256i ctl = _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(4)), d);
+    return ~_mm256_movemask_epi8(_mm256_or_si256(sp, ctl));
+  }
+  case SCAN_LOWER: {
+    __m256i d = _mm256_sub_epi8(v, _mm256_set1_epi8('a'));
+    __m256i lower = _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(25)), d);
+    return ~_mm256_movemask_epi8(lower);
+  }
+  case SCAN_LINE:
+    hit = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'));
+    break;
+  case SCAN_COMMENT:
+    hit = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('*'));
+    break;
+  case SCAN_STRING:
+    hit = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')),
+                          _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')));
+    break;
+  }
+  return _mm256_movemask_epi8(_mm256_or_si256(hit, zero));
+}
+
+// 32 バイトずつ調べる。kind は定数で渡して、種類ごとに展開させる
+static inline __attribute__((always_inline, target("avx2")))
+char *avx2_loop(char *p, ScanKind kind) {
+  int off = (uintptr_t)p & 31;
+  char *q = p - off;
+  unsigned mask = avx2_stop_mask(_mm256_load_si256((__m256i *)q), kind) >> off << off;
+  while (!mask) {
+    q += 32;
+    mask = avx2_stop_mask(_mm256_load_si256((__m256i *)q), kind);
+  }
+  return q + __builtin_ctz(mask);
+}
+
+// 32 バイトずつ調べる版。CPU が AVX2 に対応しているときだけ使う
+__attribute__((target("avx2")))
+static char *scan_avx2(char *p, ScanKind kind) {
+  switch (kind) {
+  case SCAN_SPACE: return avx2_loop(p, SCAN_SPACE);
+  case SCAN_LINE: return avx2_loop(p, SCAN_LINE);
+  case SCAN_COMMENT: return avx2_loop(p, SCAN_COMMENT);
+  case SCAN_LOWER: return avx2_loop(p, SCAN_LOWER);
+  case SCAN_STRING: return avx2_loop(p, SCAN_STRING);
+  }
+  error("unreachable: scan_avx2");
+}
+#endif
+
+// 実際に使う版。select_scan で切り替える
+char *(*scan)(char *p, ScanKind kind) = scan_scalar;
+
+// 各版の名前
+static char *scan_names[] = {"scalar", "sse2", "avx2"};
+
+// 指定した版に切り替える。CPU が対応していなければ偽を返す
+// level は 0 が 1 バイトずつ、1 が SSE2、2 が AVX2
+bool select_scan(int level) {
+  switch (level) {
+  case 0:
+    scan = scan_scalar;
+    return true;
+#ifdef __x86_64__
+  case 1:
+    scan = scan_sse2;
+    return true;
+  case 2:
+    if (!__builtin_cpu_supports("avx2"))
+      return false;
+    scan = scan_avx2;
+    return true;
+#endif
+  }
+  return false;
+}
+
+// CPU が対応しているうちで一番速い版を選ぶ
+void init_scan() {
+  for (int level = 2; level >= 0; level--)
+    if (select_scan(level))
+      return;
+}
+
+// 入力の終わりまでトークンを読み進める
+static void lex_all(char *input) {
+  tokenize(input);
+  while (!at_eof())
+    token_pos++;
+}
+
+// トークナイザーを各版で何回か動かして、1サイクルあたりに読めたバイト数を表示する
+void bench_tokenize(char *input) {
+  size_t size = strlen(input);
+  int repeat = 10;
+  for (int level = 0; level < 3; level++) {
+    if (!select_scan(level))
+      continue;
+    // 1回目はページフォルトなどが入るので捨てる
+    lex_all(input);
+#ifdef __x86_64__
+    unsigned long long start = __rdtsc();
+    for (int i = 0; i < repeat; i++)
+      lex_all(input);
+    unsigned long long cycles = __rdtsc() - start;
+    printf("%-6s %.3f bytes/cycle\n", scan_names[level],
+           (double)size * repeat / cycles);
+#endif
+  }
+  init_scan();
+}
@@ -0,0 +1,201 @@
+#include "nanocc.h"
+
+// 強さの低減 (strength reduction)
+// 定数との掛け算と割り算を、より速い命令の並びに置き換える。
+// - 2 のべき乗を掛けるのは左シフトにする
+// - 3, 5, 9 に 2 のべき乗を掛けた数を掛けるのは、3, 5, 9 倍 (出力で lea になる) と左シフトにする
+// - 2 のべき乗より 1 大きい数や 1 小さい数を掛けるのは、左シフトと足し算か引き算にする
+// - 2 のべき乗で割るのは、負の数が 0 の方向に切り捨てになるように足してから右シフトにする
+// - そのほかの数で int を割るのは、逆数にあたる数 (magic number) を掛けた上位を右シフトにする
+//   (Hacker's Delight 10 章の方法)
+// 置き換える命令は並びの最後の命令に書き換えるので、その値を使う命令はそのままでよい
+
+// 書き換えている関数
+static IrFunc *cur_ir;
+
+// 命令 pos の直前に、オペランドが arg で imm を持つ命令を入れる
+static Inst *insert_unary(Inst *pos, IrOp op, Inst *arg, int64_t imm) {
+  Inst *inst = new_inst(op, pos->size);
+  inst->id = cur_ir->num_values++;
+  inst->imm = imm;
+  add_arg(inst, arg);
+  insert_before(pos, inst);
+  return inst;
+}
+
+// 命令 pos の直前に、二項演算の命令を入れる
+static Inst *insert_binary(Inst *pos, IrOp op, Inst *lhs, Inst *rhs) {
+  Inst *inst = new_inst(op, pos->size);
+  inst->id = cur_ir->num_values++;
+  add_arg(inst, lhs);
+  add_arg(inst, rhs);
+  insert_before(pos, inst);
+  return inst;
+}
+
+// 命令 pos の直前に、pos と同じ大きさの定数を入れる
+static Inst *insert_const(Inst *pos, int64_t val) {
+  Inst *inst = new_inst(IR_CONST, pos->size);
+  inst->id = cur_ir->num_values++;
+  inst->imm = val;
+  insert_before(pos, inst);
+  return inst;
+}
+
+// 命令 inst を、オペランドが lhs と rhs の op の命令に書き換える
+// rhs が NULL なら、オペランドは lhs だけで imm を持つ
+static void rewrite(Inst *inst, IrOp op, Inst *lhs, Inst *rhs, int64_t imm) {
+  for (int i = 0; i < inst->num_args; i++)
+    inst->args[i]->num_uses--;
+  inst->num_args = 0;
+  inst->op = op;
+  inst->imm = imm;
+  add_arg(inst, lhs);
+  if (rhs)
+    add_arg(inst, rhs);
+}
+
+// c が 2 の k 乗なら k を返す。そうでなければ -1
+static int exact_log2(int64_t c) {
+  if (c <= 0 || (c & (c - 1)))
+    return -1;
+  int k = 0;
+  while (c > 1) {
+    c >>= 1;
+    k++;
+  }
+  return k;
+}
+
+// 定数との掛け算
+static void reduce_mul(Inst *inst) {
+  Inst *x = inst->args[0];
+  Inst *c = inst->args[1];
+  if (x->op == IR_CONST) {
+    x = inst->args[1];
+    c = inst->args[0];
+  }
+  if (c->op != IR_CONST || c->imm <= 1)
+    return;
+
+  // c = m * 2^k にする
+  int64_t m = c->imm;
+  int k = 0;
+  while (m % 2 == 0) {
+    m /= 2;
+    k++;
+  }
+  if (m == 1) {
+    rewrite(inst, IR_SHL, x, NULL, k);
+    return;
+  }
+  if (m == 3 || m == 5 || m == 9) {
+    if (k == 0)
+      return;
+    Inst *t = insert_binary(inst, IR_MUL, x, insert_const(inst, m));
+    rewrite(inst, IR_SHL, t, NULL, k);
+    return;
+  }
+  int p = exact_log2(c->imm - 1);
+  if (p > 0) {
+    rewrite(inst, IR_ADD, insert_unary(inst, IR_SHL, x, p), x, 0);
+    return;
+  }
+  p = exact_log2(c->imm + 1);
+  if (p > 0)
+    rewrite(inst, IR_SUB, insert_unary(inst, IR_SHL, x, p), x, 0);
+}
+
+// 32 ビットの符号つき整数を d で割るときに掛ける数 *m とずらす幅 *s
+// Hacker's Delight 10-1 の方法。d は 0, 1, -1 以外
+static void magic32(int32_t d, int32_t *m, int *s) {
+  const uint32_t two31 = 0x80000000u;
+  uint32_t ad = d < 0 ? -(uint32_t)d : (uint32_t)d;
+  uint32_t t = two31 + ((uint32_t)d >> 31);
+  uint32_t anc = t - 1 - t % ad;
+  uint32_t q1 = two31 / anc;
+  uint32_t r1 = two31 - q1 * anc;
+  uint32_t q2 = two31 / ad;
+  uint32_t r2 = two31 - q2 * ad;
+  uint32_t delta;
+  int p = 31;
+  do {
+    p++;
+    q1 *= 2;
+    r1 *= 2;
+    if (r1 >= anc) {
+      q1++;
+      r1 -= anc;
+    }
+    q2 *= 2;
+    r2 *= 2;
+    if (r2 >= ad) {
+      q2++;
+      r2 -= ad;
+    }
+    delta = ad - r2;
+  } while (q1 < delta || (q1 == delta && r1 == 0));
+  *m = (int32_t)(q2 + 1);
+  if (d < 0)
+    *m = -*m;
+  *s = p - 32;
+}
+
+// 定数での割り算。C の割り算は 0 の方向に切り捨てる
+static void reduce_div(Inst *inst) {
+  Inst *x = inst->args[0];
+  Inst *c = inst->args[1];
+  if (c->op != IR_CONST)
+    return;
+  int64_t d = c->imm;
+  int bits = inst->size * 8;
+  // 0 で割るのは idiv に任せる
+  if (d == 0 || d == 1 || d == -1)
+    return;
+
+  int k = exact_log2(d < 0 ? -d : d);
+  if (k > 0) {
+    // 負の数なら 2^k - 1 を足してから算術シフトする
+    // 符号を上位に広げた値を論理シフトすると、負の数のときだけ 2^k - 1 になる
+    Inst *sign = k == 1 ? x : insert_unary(inst, IR_SAR, x, bits - 1);
+    Inst *bias = insert_unary(inst, IR_SHR, sign, bits - k);
+    Inst *t = insert_binary(inst, IR_ADD, x, bias);
+    if (d > 0) {
+      rewrite(inst, IR_SAR, t, NULL, k);
+      return;
+    }
+    Inst *q = insert_unary(inst, IR_SAR, t, k);
+    rewrite(inst, IR_SUB, insert_const(inst, 0), q, 0);
+    return;
+  }
+
+  // 64 ビットの値を割るのはポインターの差を要素の大きさで割るときだけなので、idiv のままにする
+  if (inst->size != 4)
+    return;
+  int32_t m;
+  int s;
+  magic32(d, &m, &s);
+  Inst *q = insert_unary(inst, IR_MULHI, x, m);
+  if (d > 0 && m < 0)
+    q = insert_binary(inst, IR_ADD, q, x);
+  if (d < 0 && m > 0)
+    q = insert_binary(inst, IR_SUB, q, x);
+  if (s > 0)
+    q = insert_unary(inst, IR_SAR, q, s);
+  // 商が負なら 1 を足して、0 の方向に切り捨てる
+  rewrite(inst, IR_ADD, q, insert_unary(inst, IR_SHR, q, bits - 1), 0);
+}
+
+// 関数の定数との掛け算と割り算を置き換える
+void reduce_strength(IrFunc *f) {
+  cur_ir = f;
+  for (Block *b = f->entry; b; b = b->next) {
+    for (Inst *inst = b->first; inst; inst = inst->next) {
+      if (inst->op == IR_MUL)
+        reduce_mul(inst);
+      else if (inst->op == IR_DIV)
+        reduce_div(inst);
+    }
+  }
+  cur_ir = NULL;
+}
@@ -0,0 +1,82 @@
+#include "nanocc.h"
+
+// 名前の atom から定義を引く記号表
+// オープンアドレス法のハッシュ表で、ブロックのスコープに入るたびに
+// enter_scope、出るたびに leave_scope を呼ぶと、そのスコープで足した
+// 定義が見えなくなり、外側の定義が見えるように戻る
+
+// atom をハッシュ表の位置に散らす
+static int sym_hash(int name, int cap) {
+  return ((uint32_t)name * 2654435769u) & (cap - 1);
+}
+
+// name のスロットの位置を返す。なければ入れるべき空きスロットの位置を返す
+static int find_slot(SymTable *t, int name) {
+  int i = sym_hash(name, t->cap);
+  while (t->slots[i].key && t->slots[i].key != name + 1)
+    i = (i + 1) & (t->cap - 1);
+  return i;
+}
+
+// ハッシュ表を倍の大きさにして作り直す
+static void grow_slots(SymTable *t) {
+  SymSlot *old = t->slots;
+  int old_cap = t->cap;
+  t->cap = old_cap ? old_cap * 2 : 64;
+  t->slots = calloc(t->cap, sizeof(SymSlot));
+  for (int i = 0; i < old_cap; i++) {
+    if (old[i].key)
+      t->slots[find_slot(t, old[i].key - 1)] = old[i];
+  }
+  free(old);
+}
+
+// name に対応する、いま見えている定義を返す。見つからなければ NULL を返す
+void *find_sym(SymTable *t, int name) {
+  if (!t->cap)
+    return NULL;
+  return t->slots[find_slot(t, name)].sym;
+}
+
+// いまのスコープに name の定義 sym を足す。外側の同じ名前の定義は隠れる
+void add_sym(SymTable *t, int name, void *sym) {
+  // 表の半分が埋まったら広げる
+  if (t->used * 2 >= t->cap)
+    grow_slots(t);
+
+  int i = find_slot(t, name);
+  if (!t->slots[i].key) {
+    t->slots[i].key = name + 1;
+    t->used++;
+  }
+  // スコープの中では、スコープを出るときに戻せるように前の定義を覚えておく
+  if (t->depth) {
+    if (t->num_undo == t->cap_undo) {
+      t->cap_undo = t->cap_undo ? t->cap_undo * 2 : 64;
+      t->undo = realloc(t->undo, sizeof(SymUndo) * t->cap_undo);
+    }
+    t->undo[t->num_undo].name = name;
+    t->undo[t->num_undo].prev = t->slots[i].sym;
+    t->num_undo++;
+  }
+  t->slots[i].sym = sym;
+}
+
+// 新しいスコープに入る
+void enter_scope(SymTable *t) {
+  if (t->depth == t->cap_scopes) {
+    t->cap_scopes = t->cap_scopes ? t->cap_scopes * 2 : 16;
+    t->scopes = realloc(t->scopes, sizeof(int) * t->cap_scopes);
+  }
+  // このスコープで足した定義は、undo のこの位置から後ろに記録される
+  t->scopes[t->depth++] = t->num_undo;
+}
+
+// スコープを出る。そのスコープで足した定義を、足した順と逆順に取り消す
+void leave_scope(SymTable *t) {
+  int start = t->scopes[--t->depth];
+  while (t->num_undo > start) {
+    SymUndo *u = &t->undo[--t->num_undo];
+    t->slots[find_slot(t, u->name)].sym = u->prev;
+  }
+}
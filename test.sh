@@ -1,11 +1,53 @@
 #!/bin/bash
 
-./nanocc test.nanoc > tmp.s
-cc -o tmp tmp.s
-./tmp
-
-if [ $? = 0 ]; then 
-  echo OK
-else
-  echo NG
-fi
\ No newline at end of file
+# IR を経由しない -O0 と、IR を経由する -O1 の両方で確かめる
+# ピープホール最適化をかけない出力も確かめる
+# CPU が1つのマシンでも関数の本体を並列にパーズするように、-j4 も確かめる
+# -f -j1 では関数ごとにパーズしてすぐコードを生成し、関数のアリーナと入力のページを捨てていく
+# -p では字句解析、構文解析、コード生成を別々のスレッドで動かす
+for opt in "-O0 -fno-peephole" -O0 -O1 "-O1 -j4" "-O1 -f -j1" "-O0 -p" "-O1 -p"; do
+  ./nanocc test.nanoc $opt > tmp.s
+  # アセンブラーの警告 (はみ出した即値など) も失敗にする
+  cc -c -o tmp.o tmp.s 2> tmp.log
+  if [ $? != 0 ] || [ -s tmp.log ]; then
+    cat tmp.log
+    echo "NG ($opt): assembler"
+    exit 1
+  fi
+  cc -o tmp tmp.o
+  ./tmp
+
+  if [ $? != 0 ]; then
+    echo "NG ($opt)"
+    exit 1
+  fi
+done
+
+# 並列にパーズしても、出力はスレッドの数によらず同じになる
+./nanocc test.nanoc -O1 -j1 > tmp1.s
+./nanocc test.nanoc -O1 -j4 > tmp4.s
+if ! cmp -s tmp1.s tmp4.s; then
+  echo "NG (-j1 と -j4 の出力が違います)"
+  exit 1
+fi
+
+# main から呼ばれない関数の本体はパーズせず、出力もしない。main から間接に呼ばれる関数は出力する
+# -f ならすべての関数を出力し、main がなければすべての関数を出力する
+printf 'int mid() { return used(); }\nint unused() { return 2; }\nint main() { return mid(); }\nint used() { return 1; }\n' > tmplazy.nanoc
+./nanocc tmplazy.nanoc > tmplazy.s
+if grep -q '^unused:' tmplazy.s || ! grep -q '^used:' tmplazy.s; then
+  echo "NG (main から呼ばれる関数だけを出力していません)"
+  exit 1
+fi
+./nanocc tmplazy.nanoc -f > tmplazy.s
+if ! grep -q '^unused:' tmplazy.s; then
+  echo "NG (-f で main から呼ばれない関数を出力していません)"
+  exit 1
+fi
+printf 'int foo() { return 1; }\nint bar() { return 2; }\n' > tmplazy.nanoc
+./nanocc tmplazy.nanoc > tmplazy.s
+if ! grep -q '^foo:' tmplazy.s || ! grep -q '^bar:' tmplazy.s; then
+  echo "NG (main のないファイルの関数を出力していません)"
+  exit 1
+fi
+echo OK
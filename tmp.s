@@ -0,0 +1,2547 @@
+.intel_syntax noprefix
+.globl assert
+assert:
+  push rbp
+  mov rbp, rsp
+  sub rsp, 48
+  mov -24[rbp], rbx
+  mov -32[rbp], r12
+  mov -40[rbp], r13
+  mov rbx, rdi
+  mov r12, rsi
+  mov r13, rdx
+.Lassert_0:
+  cmp ebx, r12d
+  jne .Lassert_2
+.Lassert_1:
+  lea rdi, .LC0[rip]
+  mov rsi, r13
+  mov rdx, r12
+  mov eax, 0
+  call printf
+  mov rcx, rax
+  jmp .Lassert_3
+.Lassert_2:
+  lea rdi, .LC1[rip]
+  mov rsi, r13
+  mov rdx, rbx
+  mov rcx, r12
+  mov eax, 0
+  call printf
+  mov rcx, rax
+  mov DWORD PTR ng[rip], 1
+.Lassert_3:
+  mov eax, 0
+  mov rbx, -24[rbp]
+  mov r12, -32[rbp]
+  mov r13, -40[rbp]
+  leave
+  ret
+.globl main
+main:
+  push rbp
+  mov rbp, rsp
+  sub rsp, 272
+  mov -232[rbp], rbx
+  mov -240[rbp], r12
+  mov -248[rbp], r13
+  mov -256[rbp], r14
+  mov -264[rbp], r15
+.Lmain_0:
+  mov DWORD PTR ng[rip], 0
+  mov edi, 42
+  mov esi, 42
+  lea rdx, .LC2[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 31
+  mov esi, 31
+  lea rdx, .LC3[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 0
+  mov esi, 0
+  lea rdx, .LC4[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 1
+  mov esi, 1
+  lea rdx, .LC5[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 1
+  mov esi, 1
+  lea rdx, .LC6[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 0
+  mov esi, 0
+  lea rdx, .LC7[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 0
+  mov esi, 0
+  lea rdx, .LC8[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 1
+  mov esi, 1
+  lea rdx, .LC9[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 0
+  mov esi, 0
+  lea rdx, .LC10[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 1
+  mov esi, 1
+  lea rdx, .LC11[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 1
+  mov esi, 1
+  lea rdx, .LC12[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 25
+  mov esi, 25
+  lea rdx, .LC13[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 21
+  mov esi, 21
+  lea rdx, .LC14[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 7
+  mov esi, 7
+  lea rdx, .LC15[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 5
+  mov esi, 5
+  lea rdx, .LC16[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 2
+  mov esi, 2
+  lea rdx, .LC17[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 14
+  mov esi, 14
+  lea rdx, .LC18[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 94
+  mov esi, 94
+  lea rdx, .LC19[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 2
+  mov esi, 2
+  lea rdx, .LC20[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 2
+  mov esi, 2
+  lea rdx, .LC21[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 5
+  mov esi, 5
+  lea rdx, .LC22[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 1
+  mov esi, 1
+  lea rdx, .LC23[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 0
+  mov esi, 0
+  lea rdx, .LC24[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 1
+  mov esi, 1
+  lea rdx, .LC25[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 0
+  mov esi, 0
+  lea rdx, .LC26[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 0
+  mov esi, 0
+  lea rdx, .LC27[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 0
+  mov esi, 0
+  lea rdx, .LC28[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 1
+  mov esi, 1
+  lea rdx, .LC29[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov eax, 0
+  cmp eax, 0
+  je .Lmain_2
+.Lmain_1:
+  mov DWORD PTR -4[rbp], 3
+  jmp .Lmain_3
+.Lmain_2:
+  mov DWORD PTR -4[rbp], 4
+.Lmain_3:
+  mov ecx, DWORD PTR -4[rbp]
+  mov edi, 4
+  mov rsi, rcx
+  lea rdx, .LC30[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov eax, 0
+  cmp eax, 0
+  je .Lmain_5
+.Lmain_4:
+  mov DWORD PTR -4[rbp], 3
+  jmp .Lmain_6
+.Lmain_5:
+  mov DWORD PTR -4[rbp], 4
+.Lmain_6:
+  mov ecx, DWORD PTR -4[rbp]
+  mov edi, 4
+  mov rsi, rcx
+  lea rdx, .LC31[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov eax, 1
+  cmp eax, 0
+  je .Lmain_8
+.Lmain_7:
+  mov DWORD PTR -4[rbp], 3
+.Lmain_8:
+  mov ecx, DWORD PTR -4[rbp]
+  mov edi, 3
+  mov rsi, rcx
+  lea rdx, .LC32[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov DWORD PTR -4[rbp], 1
+.Lmain_9:
+  mov ecx, DWORD PTR -4[rbp]
+  cmp ecx, 5
+  jge .Lmain_11
+.Lmain_10:
+  mov ecx, DWORD PTR -4[rbp]
+  mov esi, DWORD PTR -4[rbp]
+  add ecx, esi
+  mov DWORD PTR -4[rbp], ecx
+  jmp .Lmain_9
+.Lmain_11:
+  mov ecx, DWORD PTR -4[rbp]
+  mov edi, 8
+  mov rsi, rcx
+  lea rdx, .LC33[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov DWORD PTR -8[rbp], 0
+  mov DWORD PTR -4[rbp], 0
+.Lmain_12:
+  mov ecx, DWORD PTR -4[rbp]
+  cmp ecx, 10
+  jge .Lmain_14
+.Lmain_13:
+  mov ecx, DWORD PTR -8[rbp]
+  mov esi, DWORD PTR -4[rbp]
+  add ecx, esi
+  mov DWORD PTR -8[rbp], ecx
+  mov ecx, DWORD PTR -4[rbp]
+  add ecx, 1
+  mov DWORD PTR -4[rbp], ecx
+  jmp .Lmain_12
+.Lmain_14:
+  mov ecx, DWORD PTR -8[rbp]
+  mov edi, 45
+  mov rsi, rcx
+  lea rdx, .LC34[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov DWORD PTR -4[rbp], 0
+  mov DWORD PTR -8[rbp], 0
+.Lmain_15:
+  mov ecx, DWORD PTR -4[rbp]
+  cmp ecx, 9
+  jge .Lmain_17
+.Lmain_16:
+  mov ecx, DWORD PTR -4[rbp]
+  add ecx, 1
+  mov DWORD PTR -4[rbp], ecx
+  mov ecx, DWORD PTR -8[rbp]
+  mov esi, DWORD PTR -4[rbp]
+  add ecx, esi
+  mov DWORD PTR -8[rbp], ecx
+  jmp .Lmain_15
+.Lmain_17:
+  mov ecx, DWORD PTR -8[rbp]
+  mov edi, 45
+  mov rsi, rcx
+  lea rdx, .LC35[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov eax, 0
+  call fourtytwo
+  mov rcx, rax
+  mov edi, 42
+  mov rsi, rcx
+  lea rdx, .LC36[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 9
+  mov eax, 0
+  call fib
+  mov rcx, rax
+  mov edi, 55
+  mov rsi, rcx
+  lea rdx, .LC37[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 10
+  mov esi, 20
+  mov eax, 0
+  call add
+  mov rcx, rax
+  mov edi, 30
+  mov rsi, rcx
+  lea rdx, .LC38[rip]
+  mov eax, 0
+  call assert
+  mov DWORD PTR -16[rbp], 1
+  mov DWORD PTR -12[rbp], 2
+  mov ecx, DWORD PTR -16[rbp]
+  mov esi, DWORD PTR -12[rbp]
+  add ecx, esi
+  mov edi, 3
+  mov rsi, rcx
+  lea rdx, .LC39[rip]
+  mov eax, 0
+  call assert
+  mov DWORD PTR -16[rbp], 42
+  mov DWORD PTR -12[rbp], 43
+  mov ecx, DWORD PTR -12[rbp]
+  mov edi, 43
+  mov rsi, rcx
+  lea rdx, .LC40[rip]
+  mov eax, 0
+  call assert
+  mov DWORD PTR -16[rbp], 42
+  mov ecx, DWORD PTR -16[rbp]
+  mov edi, 42
+  mov rsi, rcx
+  lea rdx, .LC41[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 42
+  mov eax, 0
+  call double
+  mov rcx, rax
+  mov edi, 84
+  mov rsi, rcx
+  lea rdx, .LC42[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 42
+  mov eax, 0
+  call idy
+  mov rcx, rax
+  mov edi, 42
+  mov rsi, rcx
+  lea rdx, .LC43[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 42
+  mov eax, 0
+  call id
+  mov rcx, rax
+  mov edi, 42
+  mov rsi, rcx
+  lea rdx, .LC44[rip]
+  mov eax, 0
+  call assert
+  mov DWORD PTR -20[rbp], 42
+  mov ecx, DWORD PTR -20[rbp]
+  mov edi, 42
+  mov rsi, rcx
+  lea rdx, .LC45[rip]
+  mov eax, 0
+  call assert
+  lea rax, -20[rbp]
+  mov QWORD PTR -28[rbp], rax
+  mov rcx, QWORD PTR -28[rbp]
+  mov DWORD PTR [rcx], 3
+  mov ecx, DWORD PTR -20[rbp]
+  mov edi, 3
+  mov rsi, rcx
+  lea rdx, .LC46[rip]
+  mov eax, 0
+  call assert
+  mov DWORD PTR -20[rbp], 3
+  lea rax, -20[rbp]
+  mov QWORD PTR -28[rbp], rax
+  mov rcx, QWORD PTR -28[rbp]
+  mov ecx, DWORD PTR [rcx]
+  mov edi, 3
+  mov rsi, rcx
+  lea rdx, .LC47[rip]
+  mov eax, 0
+  call assert
+  mov DWORD PTR -32[rbp], 3
+  mov DWORD PTR -36[rbp], 5
+  mov ecx, 1
+  movsxd rcx, ecx
+  shl rcx, 2
+  lea r11, -36[rbp]
+  add rcx, r11
+  mov QWORD PTR -44[rbp], rcx
+  mov rcx, QWORD PTR -44[rbp]
+  mov ecx, DWORD PTR [rcx]
+  mov edi, 3
+  mov rsi, rcx
+  lea rdx, .LC48[rip]
+  mov eax, 0
+  call assert
+  mov DWORD PTR -32[rbp], 3
+  mov DWORD PTR -36[rbp], 5
+  lea rax, -36[rbp]
+  mov QWORD PTR -44[rbp], rax
+  mov rcx, QWORD PTR -44[rbp]
+  mov ecx, DWORD PTR 4[rcx]
+  mov edi, 3
+  mov rsi, rcx
+  lea rdx, .LC49[rip]
+  mov eax, 0
+  call assert
+  mov DWORD PTR -52[rbp], 1
+  mov DWORD PTR -48[rbp], 2
+  lea rax, -52[rbp]
+  mov QWORD PTR -60[rbp], rax
+  mov rcx, QWORD PTR -60[rbp]
+  mov ecx, DWORD PTR [rcx]
+  mov rsi, QWORD PTR -60[rbp]
+  mov esi, DWORD PTR 4[rsi]
+  add ecx, esi
+  mov edi, 3
+  mov rsi, rcx
+  lea rdx, .LC50[rip]
+  mov eax, 0
+  call assert
+  mov DWORD PTR -52[rbp], 1
+  mov DWORD PTR -48[rbp], 2
+  mov ecx, DWORD PTR -48[rbp]
+  mov edi, 2
+  mov rsi, rcx
+  lea rdx, .LC51[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov DWORD PTR -52[rbp], 42
+  mov edi, 42
+  mov esi, 42
+  lea rdx, .LC52[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 4
+  mov esi, 4
+  lea rdx, .LC53[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 4
+  mov esi, 4
+  lea rdx, .LC54[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 8
+  mov esi, 8
+  lea rdx, .LC55[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 4
+  mov esi, 4
+  lea rdx, .LC56[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 8
+  mov esi, 8
+  lea rdx, .LC57[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 4
+  mov esi, 4
+  lea rdx, .LC58[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 4
+  mov esi, 4
+  lea rdx, .LC59[rip]
+  mov eax, 0
+  call assert
+  mov DWORD PTR xs[rip], 10
+  mov DWORD PTR xs+4[rip], 20
+  mov ecx, DWORD PTR xs[rip]
+  mov esi, DWORD PTR xs+4[rip]
+  add ecx, esi
+  mov edi, 30
+  mov rsi, rcx
+  lea rdx, .LC60[rip]
+  mov eax, 0
+  call assert
+  mov BYTE PTR -63[rbp], -1
+  mov BYTE PTR -62[rbp], 2
+  mov DWORD PTR -67[rbp], 4
+  movsx ecx, BYTE PTR -63[rbp]
+  add ecx, 4
+  mov edi, 3
+  mov rsi, rcx
+  lea rdx, .LC61[rip]
+  mov eax, 0
+  call assert
+  lea rax, .LC62[rip]
+  mov QWORD PTR -75[rbp], rax
+  mov rcx, QWORD PTR -75[rbp]
+  movsx ecx, BYTE PTR [rcx]
+  mov edi, 97
+  mov rsi, rcx
+  lea rdx, .LC63[rip]
+  mov eax, 0
+  call assert
+  mov rcx, QWORD PTR -75[rbp]
+  movsx ecx, BYTE PTR 1[rcx]
+  mov edi, 98
+  mov rsi, rcx
+  lea rdx, .LC64[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov DWORD PTR -79[rbp], 10
+  mov edi, 10
+  mov esi, 10
+  lea rdx, .LC65[rip]
+  mov eax, 0
+  call assert
+  mov DWORD PTR -87[rbp], 4
+  mov DWORD PTR -83[rbp], 5
+  mov ecx, DWORD PTR -83[rbp]
+  mov edi, 5
+  mov rsi, rcx
+  lea rdx, .LC66[rip]
+  mov eax, 0
+  call assert
+  mov DWORD PTR -99[rbp], 4
+  mov DWORD PTR -95[rbp], 5
+  mov DWORD PTR -91[rbp], 6
+  mov ecx, DWORD PTR -91[rbp]
+  mov edi, 6
+  mov rsi, rcx
+  lea rdx, .LC67[rip]
+  mov eax, 0
+  call assert
+  mov DWORD PTR -119[rbp], 4
+  mov DWORD PTR -115[rbp], 5
+  mov DWORD PTR -111[rbp], 6
+  mov DWORD PTR -107[rbp], 0
+  mov DWORD PTR -103[rbp], 0
+  mov ecx, DWORD PTR -103[rbp]
+  mov edi, 0
+  mov rsi, rcx
+  lea rdx, .LC68[rip]
+  mov eax, 0
+  call assert
+  mov DWORD PTR -123[rbp], 1
+  mov DWORD PTR -127[rbp], 2
+  mov ecx, DWORD PTR -127[rbp]
+  add ecx, 1
+  mov DWORD PTR -127[rbp], ecx
+  mov edi, 1
+  mov esi, 1
+  lea rdx, .LC69[rip]
+  mov eax, 0
+  call assert
+  push 8
+  push 7
+  mov edi, 1
+  mov esi, 2
+  mov edx, 3
+  mov ecx, 4
+  mov r8d, 5
+  mov r9d, 6
+  mov eax, 0
+  call weighted
+  add rsp, 16
+  mov rcx, rax
+  mov edi, 204
+  mov rsi, rcx
+  lea rdx, .LC70[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, -3
+  mov esi, -3
+  lea rdx, .LC71[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, -3
+  mov esi, -3
+  lea rdx, .LC72[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 3
+  mov esi, 3
+  lea rdx, .LC73[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, -12
+  mov esi, -12
+  lea rdx, .LC74[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 16
+  mov esi, 16
+  lea rdx, .LC75[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov DWORD PTR -131[rbp], 3
+  mov DWORD PTR -135[rbp], 14
+  mov edi, 14
+  mov esi, 14
+  lea rdx, .LC76[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov BYTE PTR -136[rbp], 44
+  mov edi, 44
+  mov esi, 44
+  lea rdx, .LC77[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov BYTE PTR -137[rbp], -56
+  mov edi, -56
+  mov esi, -56
+  lea rdx, .LC78[rip]
+  mov eax, 0
+  call assert
+  mov BYTE PTR -61[rbp], 1
+  movsx ecx, BYTE PTR -61[rbp]
+  mov edi, 1
+  mov rsi, rcx
+  lea rdx, .LC79[rip]
+  mov eax, 0
+  call assert
+  mov BYTE PTR -61[rbp], 127
+  movsx ecx, BYTE PTR -61[rbp]
+  mov edi, 127
+  mov rsi, rcx
+  lea rdx, .LC80[rip]
+  mov eax, 0
+  call assert
+  mov DWORD PTR -141[rbp], 1
+  mov ecx, DWORD PTR -141[rbp]
+  add ecx, 1
+  mov DWORD PTR -141[rbp], ecx
+  mov ecx, DWORD PTR -141[rbp]
+  mov edi, 2
+  mov rsi, rcx
+  lea rdx, .LC81[rip]
+  mov eax, 0
+  call assert
+  mov DWORD PTR -145[rbp], 5
+  lea rax, -145[rbp]
+  mov QWORD PTR -153[rbp], rax
+  mov rcx, QWORD PTR -153[rbp]
+  mov DWORD PTR [rcx], 6
+  mov ecx, DWORD PTR -145[rbp]
+  mov edi, 6
+  mov rsi, rcx
+  lea rdx, .LC82[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 7
+  mov eax, 0
+  call id
+  mov rcx, rax
+  mov edi, 7
+  mov rsi, rcx
+  lea rdx, .LC83[rip]
+  mov eax, 0
+  call assert
+  mov edi, 1
+  mov esi, 2
+  mov edx, 3
+  mov ecx, 4
+  mov r8d, 5
+  mov r9d, 6
+  mov eax, 0
+  call rot
+  mov rcx, rax
+  mov edi, 111
+  mov rsi, rcx
+  lea rdx, .LC84[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 1
+  mov eax, 0
+  call id
+  mov DWORD PTR -168[rbp], eax
+  mov edi, 2
+  mov eax, 0
+  call id
+  mov DWORD PTR -176[rbp], eax
+  mov edi, 3
+  mov eax, 0
+  call id
+  mov DWORD PTR -184[rbp], eax
+  mov edi, 4
+  mov eax, 0
+  call id
+  mov DWORD PTR -192[rbp], eax
+  mov edi, 5
+  mov eax, 0
+  call id
+  mov DWORD PTR -200[rbp], eax
+  mov edi, 6
+  mov eax, 0
+  call id
+  mov DWORD PTR -208[rbp], eax
+  mov edi, 7
+  mov eax, 0
+  call id
+  mov DWORD PTR -216[rbp], eax
+  mov edi, 8
+  mov eax, 0
+  call id
+  mov DWORD PTR -224[rbp], eax
+  mov edi, 9
+  mov eax, 0
+  call id
+  mov r14, rax
+  mov edi, 10
+  mov eax, 0
+  call id
+  mov r15, rax
+  mov edi, 11
+  mov eax, 0
+  call id
+  mov rbx, rax
+  mov edi, 12
+  mov eax, 0
+  call id
+  mov r12, rax
+  mov edi, 13
+  mov eax, 0
+  call id
+  mov r13, rax
+  mov edi, 14
+  mov eax, 0
+  call id
+  mov rcx, rax
+  add ecx, r13d
+  imul ecx, r12d
+  add ecx, ebx
+  imul ecx, r15d
+  add ecx, r14d
+  imul ecx, DWORD PTR -224[rbp]
+  add ecx, DWORD PTR -216[rbp]
+  imul ecx, DWORD PTR -208[rbp]
+  add ecx, DWORD PTR -200[rbp]
+  imul ecx, DWORD PTR -192[rbp]
+  add ecx, DWORD PTR -184[rbp]
+  imul ecx, DWORD PTR -176[rbp]
+  add ecx, DWORD PTR -168[rbp]
+  mov edi, 1290239
+  mov rsi, rcx
+  lea rdx, .LC85[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 10
+  mov eax, 0
+  call sumto
+  mov rcx, rax
+  mov edi, 55
+  mov rsi, rcx
+  lea rdx, .LC86[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 1
+  mov esi, 2
+  mov edx, 3
+  mov eax, 0
+  call swaploop
+  mov rcx, rax
+  mov edi, 21
+  mov rsi, rcx
+  lea rdx, .LC87[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 3
+  mov eax, 0
+  call charwrap
+  mov rcx, rax
+  mov edi, 44
+  mov rsi, rcx
+  lea rdx, .LC88[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  lea rdi, .LC89[rip]
+  mov eax, 0
+  call strlennano
+  mov rcx, rax
+  mov edi, 5
+  mov rsi, rcx
+  lea rdx, .LC90[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 3
+  mov esi, 9
+  mov edx, 4
+  mov eax, 0
+  call maxthree
+  mov rcx, rax
+  mov edi, 9
+  mov rsi, rcx
+  lea rdx, .LC91[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 5
+  mov eax, 0
+  call rotatemany
+  mov rcx, rax
+  mov edi, 559
+  mov rsi, rcx
+  lea rdx, .LC92[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 3
+  mov eax, 0
+  call addrmodes
+  mov rcx, rax
+  mov edi, 20414
+  mov rsi, rcx
+  lea rdx, .LC93[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, -7
+  mov eax, 0
+  call mulsmall
+  mov rcx, rax
+  mov edi, -119
+  mov rsi, rcx
+  lea rdx, .LC94[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, -100
+  mov eax, 0
+  call divseven
+  mov rcx, rax
+  mov edi, -14
+  mov rsi, rcx
+  lea rdx, .LC95[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, -7
+  mov eax, 0
+  call halve
+  mov rcx, rax
+  mov edi, -3
+  mov rsi, rcx
+  lea rdx, .LC96[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 0
+  mov eax, 0
+  call divcheck
+  mov rbx, rax
+  mov edi, 1
+  mov eax, 0
+  call divcheck
+  mov rcx, rax
+  add ebx, ecx
+  mov edi, -1
+  mov eax, 0
+  call divcheck
+  mov rcx, rax
+  add ebx, ecx
+  mov edi, 7
+  mov eax, 0
+  call divcheck
+  mov rcx, rax
+  add ebx, ecx
+  mov edi, -7
+  mov eax, 0
+  call divcheck
+  mov rcx, rax
+  add ebx, ecx
+  mov edi, 99
+  mov eax, 0
+  call divcheck
+  mov rcx, rax
+  add ebx, ecx
+  mov edi, -99
+  mov eax, 0
+  call divcheck
+  mov rcx, rax
+  add ebx, ecx
+  mov edi, 100
+  mov eax, 0
+  call divcheck
+  mov rcx, rax
+  add ebx, ecx
+  mov edi, -100
+  mov eax, 0
+  call divcheck
+  mov rcx, rax
+  add ebx, ecx
+  mov edi, 12345
+  mov eax, 0
+  call divcheck
+  mov rcx, rax
+  add ebx, ecx
+  mov edi, -12345
+  mov eax, 0
+  call divcheck
+  mov rcx, rax
+  add ebx, ecx
+  mov edi, 65535
+  mov eax, 0
+  call divcheck
+  mov rcx, rax
+  add ebx, ecx
+  mov edi, -65537
+  mov eax, 0
+  call divcheck
+  mov rcx, rax
+  add ebx, ecx
+  mov edi, 1000000
+  mov eax, 0
+  call divcheck
+  mov rcx, rax
+  add ebx, ecx
+  mov edi, -1000001
+  mov eax, 0
+  call divcheck
+  mov rcx, rax
+  add ebx, ecx
+  mov edi, 2147483647
+  mov eax, 0
+  call divcheck
+  mov rcx, rax
+  add ebx, ecx
+  mov edi, -2147483647
+  mov eax, 0
+  call divcheck
+  mov rcx, rax
+  add ebx, ecx
+  mov edi, -2147483648
+  mov eax, 0
+  call divcheck
+  mov rcx, rax
+  add ecx, ebx
+  mov edi, 0
+  mov rsi, rcx
+  lea rdx, .LC97[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 0
+  mov eax, 0
+  call mulcheck
+  mov rbx, rax
+  mov edi, 1
+  mov eax, 0
+  call mulcheck
+  mov rcx, rax
+  add ebx, ecx
+  mov edi, -1
+  mov eax, 0
+  call mulcheck
+  mov rcx, rax
+  add ebx, ecx
+  mov edi, 13
+  mov eax, 0
+  call mulcheck
+  mov rcx, rax
+  add ebx, ecx
+  mov edi, -13
+  mov eax, 0
+  call mulcheck
+  mov rcx, rax
+  add ebx, ecx
+  mov edi, 123456
+  mov eax, 0
+  call mulcheck
+  mov rcx, rax
+  add ebx, ecx
+  mov edi, -123456
+  mov eax, 0
+  call mulcheck
+  mov rcx, rax
+  add ecx, ebx
+  mov edi, 0
+  mov rsi, rcx
+  lea rdx, .LC98[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 10
+  mov eax, 0
+  call branches
+  mov rcx, rax
+  mov edi, 10288
+  mov rsi, rcx
+  lea rdx, .LC99[rip]
+  mov eax, 0
+  call assert
+  mov rcx, rax
+  mov edi, 0
+  mov eax, 0
+  call branches
+  mov rcx, rax
+  mov edi, 0
+  mov rsi, rcx
+  lea rdx, .LC100[rip]
+  mov eax, 0
+  call assert
+  mov eax, DWORD PTR ng[rip]
+  mov rbx, -232[rbp]
+  mov r12, -240[rbp]
+  mov r13, -248[rbp]
+  mov r14, -256[rbp]
+  mov r15, -264[rbp]
+  leave
+  ret
+.globl id
+id:
+  push rbp
+  mov rbp, rsp
+  sub rsp, 16
+.Lid_0:
+  mov rax, rdi
+  leave
+  ret
+.globl idy
+idy:
+  push rbp
+  mov rbp, rsp
+  sub rsp, 16
+.Lidy_0:
+  mov rax, rdi
+  leave
+  ret
+.globl double
+double:
+  push rbp
+  mov rbp, rsp
+  sub rsp, 16
+.Ldouble_0:
+  mov rcx, rdi
+  shl ecx, 1
+  mov rax, rcx
+  leave
+  ret
+.globl add
+add:
+  push rbp
+  mov rbp, rsp
+  sub rsp, 16
+.Ladd_0:
+  lea eax, [rdi+rsi]
+  leave
+  ret
+.globl weighted
+weighted:
+  push rbp
+  mov rbp, rsp
+  sub rsp, 48
+  mov -40[rbp], rbx
+  mov -48[rbp], r12
+  mov r10, r9
+  mov ebx, DWORD PTR 16[rbp]
+  mov r12d, DWORD PTR 24[rbp]
+  mov r9, r8
+  mov r8, rcx
+  mov rcx, rdx
+.Lweighted_0:
+  shl esi, 1
+  add esi, edi
+  lea ecx, [rcx+rcx*2]
+  add ecx, esi
+  mov rsi, r8
+  shl esi, 2
+  add ecx, esi
+  lea esi, [r9+r9*4]
+  add ecx, esi
+  lea esi, [r10+r10*2]
+  shl esi, 1
+  add ecx, esi
+  mov rsi, rbx
+  shl esi, 3
+  sub esi, ebx
+  add ecx, esi
+  mov rsi, r12
+  shl esi, 3
+  add ecx, esi
+  mov rax, rcx
+  mov rbx, -40[rbp]
+  mov r12, -48[rbp]
+  leave
+  ret
+.globl rot
+rot:
+  push rbp
+  mov rbp, rsp
+  sub rsp, 32
+  mov r10, r9
+  mov r9, r8
+  mov r8, rcx
+  mov rcx, rdx
+.Lrot_0:
+  push r10
+  push rdi
+  mov rdx, r8
+  mov r8, rsi
+  mov rsi, r9
+  mov r9, rdi
+  mov rdi, r10
+  mov eax, 0
+  call weighted
+  add rsp, 16
+  leave
+  ret
+.globl sumto
+sumto:
+  push rbp
+  mov rbp, rsp
+  sub rsp, 16
+.Lsumto_0:
+  mov esi, 0
+  mov ecx, 1
+.Lsumto_1:
+  cmp ecx, edi
+  jg .Lsumto_3
+.Lsumto_2:
+  lea r8d, [rsi+rcx]
+  lea r9d, 1[rcx]
+  mov rsi, r8
+  mov rcx, r9
+  jmp .Lsumto_1
+.Lsumto_3:
+  mov rax, rsi
+  leave
+  ret
+.globl swaploop
+swaploop:
+  push rbp
+  mov rbp, rsp
+  sub rsp, 32
+  mov rcx, rdx
+.Lswaploop_0:
+  mov r8, rdi
+  mov rdi, rsi
+  mov esi, 0
+.Lswaploop_1:
+  cmp esi, ecx
+  jge .Lswaploop_3
+.Lswaploop_2:
+  lea r9d, 1[rsi]
+  mov rsi, r9
+  mov rax, rdi
+  mov rdi, r8
+  mov r8, rax
+  jmp .Lswaploop_1
+.Lswaploop_3:
+  lea ecx, [r8+r8*4]
+  shl ecx, 1
+  add ecx, edi
+  mov rax, rcx
+  leave
+  ret
+.globl charwrap
+charwrap:
+  push rbp
+  mov rbp, rsp
+  sub rsp, 16
+.Lcharwrap_0:
+  mov esi, 0
+  mov ecx, 0
+.Lcharwrap_1:
+  cmp ecx, edi
+  jge .Lcharwrap_3
+.Lcharwrap_2:
+  lea r8d, 100[rsi]
+  movsx r8d, r8b
+  lea r9d, 1[rcx]
+  mov rsi, r8
+  mov rcx, r9
+  jmp .Lcharwrap_1
+.Lcharwrap_3:
+  mov rax, rsi
+  leave
+  ret
+.globl strlennano
+strlennano:
+  push rbp
+  mov rbp, rsp
+  sub rsp, 16
+.Lstrlennano_0:
+  mov rsi, rdi
+  mov ecx, 0
+.Lstrlennano_1:
+  movsx edi, BYTE PTR [rsi]
+  cmp edi, 0
+  je .Lstrlennano_3
+.Lstrlennano_2:
+  mov edi, 1
+  movsxd rdi, edi
+  add rdi, rsi
+  lea r8d, 1[rcx]
+  mov rsi, rdi
+  mov rcx, r8
+  jmp .Lstrlennano_1
+.Lstrlennano_3:
+  mov rax, rcx
+  leave
+  ret
+.globl maxthree
+maxthree:
+  push rbp
+  mov rbp, rsp
+  sub rsp, 16
+  mov rcx, rdx
+.Lmaxthree_0:
+  cmp esi, edi
+  jge .Lmaxthree_2
+.Lmaxthree_1:
+  jmp .Lmaxthree_3
+.Lmaxthree_2:
+  mov rdi, rsi
+.Lmaxthree_3:
+  cmp edi, ecx
+  jge .Lmaxthree_5
+.Lmaxthree_4:
+  jmp .Lmaxthree_6
+.Lmaxthree_5:
+  mov rcx, rdi
+.Lmaxthree_6:
+  mov rax, rcx
+  leave
+  ret
+.globl rotatemany
+rotatemany:
+  push rbp
+  mov rbp, rsp
+  sub rsp, 192
+  mov -152[rbp], rbx
+  mov -160[rbp], r12
+  mov -168[rbp], r13
+  mov -176[rbp], r14
+  mov -184[rbp], r15
+  mov rbx, rdi
+.Lrotatemany_0:
+  mov r13d, 1
+  mov r15d, 2
+  mov r14d, 3
+  mov DWORD PTR -72[rbp], 4
+  mov DWORD PTR -80[rbp], 5
+  mov DWORD PTR -88[rbp], 6
+  mov DWORD PTR -96[rbp], 7
+  mov DWORD PTR -104[rbp], 8
+  mov DWORD PTR -112[rbp], 9
+  mov DWORD PTR -120[rbp], 10
+  mov DWORD PTR -128[rbp], 11
+  mov DWORD PTR -136[rbp], 12
+  mov r11d, 13
+  mov DWORD PTR -144[rbp], r11d
+  mov r12d, 0
+.Lrotatemany_1:
+  cmp r12d, ebx
+  jge .Lrotatemany_3
+.Lrotatemany_2:
+  mov rdi, r12
+  mov eax, 0
+  call id
+  lea ecx, 1[r12]
+  mov r12, rcx
+  mov rax, r15
+  mov r15, r14
+  mov r14d, DWORD PTR -72[rbp]
+  mov r11d, DWORD PTR -80[rbp]
+  mov DWORD PTR -72[rbp], r11d
+  mov r11d, DWORD PTR -88[rbp]
+  mov DWORD PTR -80[rbp], r11d
+  mov r11d, DWORD PTR -96[rbp]
+  mov DWORD PTR -88[rbp], r11d
+  mov r11d, DWORD PTR -104[rbp]
+  mov DWORD PTR -96[rbp], r11d
+  mov r11d, DWORD PTR -112[rbp]
+  mov DWORD PTR -104[rbp], r11d
+  mov r11d, DWORD PTR -120[rbp]
+  mov DWORD PTR -112[rbp], r11d
+  mov r11d, DWORD PTR -128[rbp]
+  mov DWORD PTR -120[rbp], r11d
+  mov r11d, DWORD PTR -136[rbp]
+  mov DWORD PTR -128[rbp], r11d
+  mov r11d, DWORD PTR -144[rbp]
+  mov DWORD PTR -136[rbp], r11d
+  mov DWORD PTR -144[rbp], r13d
+  mov r13, rax
+  jmp .Lrotatemany_1
+.Lrotatemany_3:
+  mov rcx, r13
+  imul ecx, 1
+  mov rsi, r15
+  shl esi, 1
+  add ecx, esi
+  lea esi, [r14+r14*2]
+  add ecx, esi
+  mov esi, DWORD PTR -72[rbp]
+  shl esi, 2
+  add ecx, esi
+  mov esi, DWORD PTR -80[rbp]
+  lea esi, [rsi+rsi*4]
+  add ecx, esi
+  mov esi, DWORD PTR -88[rbp]
+  lea esi, [rsi+rsi*2]
+  shl esi, 1
+  add ecx, esi
+  mov esi, DWORD PTR -96[rbp]
+  shl esi, 3
+  sub esi, DWORD PTR -96[rbp]
+  add ecx, esi
+  mov esi, DWORD PTR -104[rbp]
+  shl esi, 3
+  add ecx, esi
+  mov esi, DWORD PTR -112[rbp]
+  lea esi, [rsi+rsi*8]
+  add ecx, esi
+  mov esi, DWORD PTR -120[rbp]
+  lea esi, [rsi+rsi*4]
+  shl esi, 1
+  add ecx, esi
+  mov esi, DWORD PTR -128[rbp]
+  imul esi, 11
+  add ecx, esi
+  mov esi, DWORD PTR -136[rbp]
+  lea esi, [rsi+rsi*2]
+  shl esi, 2
+  add ecx, esi
+  mov esi, DWORD PTR -144[rbp]
+  imul esi, 13
+  add ecx, esi
+  mov rax, rcx
+  mov rbx, -152[rbp]
+  mov r12, -160[rbp]
+  mov r13, -168[rbp]
+  mov r14, -176[rbp]
+  mov r15, -184[rbp]
+  leave
+  ret
+.globl fib
+fib:
+  push rbp
+  mov rbp, rsp
+  sub rsp, 32
+  mov -16[rbp], rbx
+  mov -24[rbp], r12
+  mov rbx, rdi
+.Lfib_0:
+  cmp ebx, 2
+  jge .Lfib_2
+.Lfib_1:
+  mov eax, 1
+  mov rbx, -16[rbp]
+  mov r12, -24[rbp]
+  leave
+  ret
+.Lfib_2:
+  lea ecx, -1[rbx]
+  mov rdi, rcx
+  mov eax, 0
+  call fib
+  mov r12, rax
+  lea ecx, -2[rbx]
+  mov rdi, rcx
+  mov eax, 0
+  call fib
+  mov rcx, rax
+  add ecx, r12d
+  mov rax, rcx
+  mov rbx, -16[rbp]
+  mov r12, -24[rbp]
+  leave
+  ret
+.globl fourtytwo
+fourtytwo:
+  push rbp
+  mov rbp, rsp
+.Lfourtytwo_0:
+  mov eax, 42
+  leave
+  ret
+.globl arrsum
+arrsum:
+  push rbp
+  mov rbp, rsp
+  sub rsp, 32
+.Larrsum_0:
+  mov r8d, 0
+  mov ecx, 0
+.Larrsum_1:
+  cmp ecx, esi
+  jge .Larrsum_3
+.Larrsum_2:
+  movsxd r9, ecx
+  mov r9d, DWORD PTR [rdi+r9*4]
+  add r9d, r8d
+  lea r10d, 1[rcx]
+  mov r8, r9
+  mov rcx, r10
+  jmp .Larrsum_1
+.Larrsum_3:
+  mov rax, r8
+  leave
+  ret
+.globl addrmodes
+addrmodes:
+  push rbp
+  mov rbp, rsp
+  sub rsp, 96
+  mov -80[rbp], rbx
+  mov -88[rbp], r12
+  mov -96[rbp], r13
+  mov rbx, rdi
+.Laddrmodes_0:
+  mov ecx, 0
+.Laddrmodes_1:
+  cmp ecx, 10
+  jge .Laddrmodes_3
+.Laddrmodes_2:
+  movsxd rsi, ecx
+  lea edi, [rcx+rcx*2]
+  mov DWORD PTR -44[rbp+rsi*4], edi
+  movsxd rsi, ecx
+  lea edi, [rcx+rcx*4]
+  lea r11, garr[rip]
+  mov DWORD PTR [r11+rsi*4], edi
+  movsxd rsi, ecx
+  lea edi, [rcx+rcx*8]
+  mov BYTE PTR -54[rbp+rsi*1], dil
+  lea esi, 1[rcx]
+  mov rcx, rsi
+  jmp .Laddrmodes_1
+.Laddrmodes_3:
+  mov ecx, 4
+  movsxd rcx, ecx
+  shl rcx, 2
+  lea r12, -44[rbp]
+  add r12, rcx
+  lea rdi, -44[rbp]
+  mov esi, 10
+  mov eax, 0
+  call arrsum
+  mov r13, rax
+  lea rdi, garr[rip]
+  mov esi, 10
+  mov eax, 0
+  call arrsum
+  mov rcx, rax
+  add ecx, r13d
+  movsxd rsi, ebx
+  movsx esi, BYTE PTR -54[rbp+rsi*1]
+  add ecx, esi
+  mov esi, DWORD PTR 8[r12]
+  add ecx, esi
+  mov esi, DWORD PTR -4[r12]
+  add ecx, esi
+  lea esi, 1[rbx]
+  movsxd rsi, esi
+  lea r11, garr[rip]
+  mov esi, DWORD PTR [r11+rsi*4]
+  imul esi, 1000
+  add ecx, esi
+  mov rax, rcx
+  mov rbx, -80[rbp]
+  mov r12, -88[rbp]
+  mov r13, -96[rbp]
+  leave
+  ret
+.globl mulsmall
+mulsmall:
+  push rbp
+  mov rbp, rsp
+  sub rsp, 16
+.Lmulsmall_0:
+  lea ecx, [rdi+rdi*2]
+  lea esi, [rdi+rdi*4]
+  add ecx, esi
+  lea esi, [rdi+rdi*8]
+  add ecx, esi
+  mov rax, rcx
+  leave
+  ret
+.globl divseven
+divseven:
+  push rbp
+  mov rbp, rsp
+  sub rsp, 16
+.Ldivseven_0:
+  movsxd rcx, edi
+  imul rcx, rcx, -1840700269
+  sar rcx, 32
+  add ecx, edi
+  sar ecx, 2
+  mov rsi, rcx
+  shr esi, 31
+  add ecx, esi
+  mov rax, rcx
+  leave
+  ret
+.globl halve
+halve:
+  push rbp
+  mov rbp, rsp
+  sub rsp, 16
+.Lhalve_0:
+  mov rcx, rdi
+  shr ecx, 31
+  add ecx, edi
+  sar ecx, 1
+  mov rax, rcx
+  leave
+  ret
+.globl divcheck
+divcheck:
+  push rbp
+  mov rbp, rsp
+  sub rsp, 32
+  mov -16[rbp], rbx
+  mov -24[rbp], r12
+  mov -32[rbp], r13
+  mov rbx, rdi
+.Ldivcheck_0:
+  mov rcx, rbx
+  shr ecx, 31
+  add ecx, ebx
+  mov r12, rcx
+  sar r12d, 1
+  mov edi, 2
+  mov eax, 0
+  call id
+  mov rcx, rax
+  mov rax, rbx
+  cdq
+  idiv ecx
+  mov rcx, rax
+  cmp r12d, ecx
+  setne r12b
+  movzx r12d, r12b
+  movsxd rcx, ebx
+  imul rcx, rcx, 1431655766
+  sar rcx, 32
+  mov rsi, rcx
+  shr esi, 31
+  lea r13d, [rcx+rsi]
+  mov edi, 3
+  mov eax, 0
+  call id
+  mov rcx, rax
+  mov rax, rbx
+  cdq
+  idiv ecx
+  mov rcx, rax
+  cmp r13d, ecx
+  setne cl
+  movzx ecx, cl
+  add r12d, ecx
+  mov rcx, rbx
+  sar ecx, 31
+  shr ecx, 30
+  add ecx, ebx
+  mov r13, rcx
+  sar r13d, 2
+  mov edi, 4
+  mov eax, 0
+  call id
+  mov rcx, rax
+  mov rax, rbx
+  cdq
+  idiv ecx
+  mov rcx, rax
+  cmp r13d, ecx
+  setne cl
+  movzx ecx, cl
+  add r12d, ecx
+  movsxd rcx, ebx
+  imul rcx, rcx, 1717986919
+  sar rcx, 32
+  sar ecx, 1
+  mov rsi, rcx
+  shr esi, 31
+  lea r13d, [rcx+rsi]
+  mov edi, 5
+  mov eax, 0
+  call id
+  mov rcx, rax
+  mov rax, rbx
+  cdq
+  idiv ecx
+  mov rcx, rax
+  cmp r13d, ecx
+  setne cl
+  movzx ecx, cl
+  add r12d, ecx
+  movsxd rcx, ebx
+  imul rcx, rcx, 715827883
+  sar rcx, 32
+  mov rsi, rcx
+  shr esi, 31
+  lea r13d, [rcx+rsi]
+  mov edi, 6
+  mov eax, 0
+  call id
+  mov rcx, rax
+  mov rax, rbx
+  cdq
+  idiv ecx
+  mov rcx, rax
+  cmp r13d, ecx
+  setne cl
+  movzx ecx, cl
+  add r12d, ecx
+  movsxd rcx, ebx
+  imul rcx, rcx, -1840700269
+  sar rcx, 32
+  add ecx, ebx
+  sar ecx, 2
+  mov rsi, rcx
+  shr esi, 31
+  lea r13d, [rcx+rsi]
+  mov edi, 7
+  mov eax, 0
+  call id
+  mov rcx, rax
+  mov rax, rbx
+  cdq
+  idiv ecx
+  mov rcx, rax
+  cmp r13d, ecx
+  setne cl
+  movzx ecx, cl
+  add r12d, ecx
+  mov rcx, rbx
+  sar ecx, 31
+  shr ecx, 29
+  add ecx, ebx
+  mov r13, rcx
+  sar r13d, 3
+  mov edi, 8
+  mov eax, 0
+  call id
+  mov rcx, rax
+  mov rax, rbx
+  cdq
+  idiv ecx
+  mov rcx, rax
+  cmp r13d, ecx
+  setne cl
+  movzx ecx, cl
+  add r12d, ecx
+  movsxd rcx, ebx
+  imul rcx, rcx, 1717986919
+  sar rcx, 32
+  sar ecx, 2
+  mov rsi, rcx
+  shr esi, 31
+  lea r13d, [rcx+rsi]
+  mov edi, 10
+  mov eax, 0
+  call id
+  mov rcx, rax
+  mov rax, rbx
+  cdq
+  idiv ecx
+  mov rcx, rax
+  cmp r13d, ecx
+  setne cl
+  movzx ecx, cl
+  add r12d, ecx
+  mov rcx, rbx
+  sar ecx, 31
+  shr ecx, 28
+  add ecx, ebx
+  mov r13, rcx
+  sar r13d, 4
+  mov edi, 16
+  mov eax, 0
+  call id
+  mov rcx, rax
+  mov rax, rbx
+  cdq
+  idiv ecx
+  mov rcx, rax
+  cmp r13d, ecx
+  setne cl
+  movzx ecx, cl
+  add r12d, ecx
+  movsxd rcx, ebx
+  imul rcx, rcx, 1374389535
+  sar rcx, 32
+  sar ecx, 3
+  mov rsi, rcx
+  shr esi, 31
+  lea r13d, [rcx+rsi]
+  mov edi, 25
+  mov eax, 0
+  call id
+  mov rcx, rax
+  mov rax, rbx
+  cdq
+  idiv ecx
+  mov rcx, rax
+  cmp r13d, ecx
+  setne cl
+  movzx ecx, cl
+  add r12d, ecx
+  movsxd rcx, ebx
+  imul rcx, rcx, 1374389535
+  sar rcx, 32
+  sar ecx, 5
+  mov rsi, rcx
+  shr esi, 31
+  lea r13d, [rcx+rsi]
+  mov edi, 100
+  mov eax, 0
+  call id
+  mov rcx, rax
+  mov rax, rbx
+  cdq
+  idiv ecx
+  mov rcx, rax
+  cmp r13d, ecx
+  setne cl
+  movzx ecx, cl
+  add r12d, ecx
+  movsxd rcx, ebx
+  imul rcx, rcx, 6700417
+  sar rcx, 32
+  mov rsi, rcx
+  shr esi, 31
+  lea r13d, [rcx+rsi]
+  mov edi, 641
+  mov eax, 0
+  call id
+  mov rcx, rax
+  mov rax, rbx
+  cdq
+  idiv ecx
+  mov rcx, rax
+  cmp r13d, ecx
+  setne cl
+  movzx ecx, cl
+  add r12d, ecx
+  movsxd rcx, ebx
+  imul rcx, rcx, 274877907
+  sar rcx, 32
+  sar ecx, 6
+  mov rsi, rcx
+  shr esi, 31
+  lea r13d, [rcx+rsi]
+  mov edi, 1000
+  mov eax, 0
+  call id
+  mov rcx, rax
+  mov rax, rbx
+  cdq
+  idiv ecx
+  mov rcx, rax
+  cmp r13d, ecx
+  setne cl
+  movzx ecx, cl
+  add r12d, ecx
+  mov rcx, rbx
+  sar ecx, 31
+  shr ecx, 16
+  add ecx, ebx
+  mov r13, rcx
+  sar r13d, 16
+  mov edi, 65536
+  mov eax, 0
+  call id
+  mov rcx, rax
+  mov rax, rbx
+  cdq
+  idiv ecx
+  mov rcx, rax
+  cmp r13d, ecx
+  setne cl
+  movzx ecx, cl
+  add r12d, ecx
+  movsxd rcx, ebx
+  imul rcx, rcx, 1125899907
+  sar rcx, 32
+  sar ecx, 18
+  mov rsi, rcx
+  shr esi, 31
+  lea r13d, [rcx+rsi]
+  mov edi, 1000000
+  mov eax, 0
+  call id
+  mov rcx, rax
+  mov rax, rbx
+  cdq
+  idiv ecx
+  mov rcx, rax
+  cmp r13d, ecx
+  setne cl
+  movzx ecx, cl
+  add r12d, ecx
+  movsxd rcx, ebx
+  imul rcx, rcx, 1073741825
+  sar rcx, 32
+  sar ecx, 29
+  mov rsi, rcx
+  shr esi, 31
+  lea r13d, [rcx+rsi]
+  mov edi, 2147483647
+  mov eax, 0
+  call id
+  mov rcx, rax
+  mov rax, rbx
+  cdq
+  idiv ecx
+  mov rcx, rax
+  cmp r13d, ecx
+  setne cl
+  movzx ecx, cl
+  add r12d, ecx
+  mov rcx, rbx
+  sar ecx, 31
+  shr ecx, 2
+  add ecx, ebx
+  mov r13, rcx
+  sar r13d, 30
+  mov edi, 1073741824
+  mov eax, 0
+  call id
+  mov rcx, rax
+  mov rax, rbx
+  cdq
+  idiv ecx
+  mov rcx, rax
+  cmp r13d, ecx
+  setne cl
+  movzx ecx, cl
+  add r12d, ecx
+  mov rcx, rbx
+  shr ecx, 31
+  add ecx, ebx
+  sar ecx, 1
+  mov r13d, 0
+  sub r13d, ecx
+  mov edi, -2
+  mov eax, 0
+  call id
+  mov rcx, rax
+  mov rax, rbx
+  cdq
+  idiv ecx
+  mov rcx, rax
+  cmp r13d, ecx
+  setne cl
+  movzx ecx, cl
+  add r12d, ecx
+  movsxd rcx, ebx
+  imul rcx, rcx, 1431655765
+  sar rcx, 32
+  sub ecx, ebx
+  sar ecx, 1
+  mov rsi, rcx
+  shr esi, 31
+  lea r13d, [rcx+rsi]
+  mov edi, -3
+  mov eax, 0
+  call id
+  mov rcx, rax
+  mov rax, rbx
+  cdq
+  idiv ecx
+  mov rcx, rax
+  cmp r13d, ecx
+  setne cl
+  movzx ecx, cl
+  add r12d, ecx
+  mov rcx, rbx
+  sar ecx, 31
+  shr ecx, 30
+  add ecx, ebx
+  sar ecx, 2
+  mov r13d, 0
+  sub r13d, ecx
+  mov edi, -4
+  mov eax, 0
+  call id
+  mov rcx, rax
+  mov rax, rbx
+  cdq
+  idiv ecx
+  mov rcx, rax
+  cmp r13d, ecx
+  setne cl
+  movzx ecx, cl
+  add r12d, ecx
+  movsxd rcx, ebx
+  imul rcx, rcx, 1840700269
+  sar rcx, 32
+  sub ecx, ebx
+  sar ecx, 2
+  mov rsi, rcx
+  shr esi, 31
+  lea r13d, [rcx+rsi]
+  mov edi, -7
+  mov eax, 0
+  call id
+  mov rcx, rax
+  mov rax, rbx
+  cdq
+  idiv ecx
+  mov rcx, rax
+  cmp r13d, ecx
+  setne cl
+  movzx ecx, cl
+  add r12d, ecx
+  mov rcx, rbx
+  sar ecx, 31
+  shr ecx, 29
+  add ecx, ebx
+  sar ecx, 3
+  mov r13d, 0
+  sub r13d, ecx
+  mov edi, -8
+  mov eax, 0
+  call id
+  mov rcx, rax
+  mov rax, rbx
+  cdq
+  idiv ecx
+  mov rcx, rax
+  cmp r13d, ecx
+  setne cl
+  movzx ecx, cl
+  add r12d, ecx
+  movsxd rcx, ebx
+  imul rcx, rcx, -1717986919
+  sar rcx, 32
+  sar ecx, 2
+  mov rsi, rcx
+  shr esi, 31
+  lea r13d, [rcx+rsi]
+  mov edi, -10
+  mov eax, 0
+  call id
+  mov rcx, rax
+  mov rax, rbx
+  cdq
+  idiv ecx
+  mov rcx, rax
+  cmp r13d, ecx
+  setne cl
+  movzx ecx, cl
+  add r12d, ecx
+  movsxd rcx, ebx
+  imul rcx, rcx, -1374389535
+  sar rcx, 32
+  sar ecx, 5
+  mov rsi, rcx
+  shr esi, 31
+  lea r13d, [rcx+rsi]
+  mov edi, -100
+  mov eax, 0
+  call id
+  mov rcx, rax
+  mov rax, rbx
+  cdq
+  idiv ecx
+  mov rcx, rax
+  cmp r13d, ecx
+  setne cl
+  movzx ecx, cl
+  add r12d, ecx
+  movsxd rcx, ebx
+  imul rcx, rcx, -1125899907
+  sar rcx, 32
+  sar ecx, 18
+  mov rsi, rcx
+  shr esi, 31
+  lea r13d, [rcx+rsi]
+  mov edi, -1000000
+  mov eax, 0
+  call id
+  mov rcx, rax
+  mov rax, rbx
+  cdq
+  idiv ecx
+  mov rcx, rax
+  cmp r13d, ecx
+  setne cl
+  movzx ecx, cl
+  add r12d, ecx
+  movsxd rcx, ebx
+  imul rcx, rcx, -1073741825
+  sar rcx, 32
+  sar ecx, 29
+  mov rsi, rcx
+  shr esi, 31
+  lea r13d, [rcx+rsi]
+  mov edi, -2147483647
+  mov eax, 0
+  call id
+  mov rcx, rax
+  mov rax, rbx
+  cdq
+  idiv ecx
+  mov rcx, rax
+  cmp r13d, ecx
+  setne cl
+  movzx ecx, cl
+  add ecx, r12d
+  mov rax, rcx
+  mov rbx, -16[rbp]
+  mov r12, -24[rbp]
+  mov r13, -32[rbp]
+  leave
+  ret
+.globl mulcheck
+mulcheck:
+  push rbp
+  mov rbp, rsp
+  sub rsp, 32
+  mov -16[rbp], rbx
+  mov -24[rbp], r12
+  mov -32[rbp], r13
+  mov rbx, rdi
+.Lmulcheck_0:
+  mov r12, rbx
+  shl r12d, 1
+  mov edi, 2
+  mov eax, 0
+  call id
+  mov rcx, rax
+  imul ecx, ebx
+  cmp r12d, ecx
+  setne r12b
+  movzx r12d, r12b
+  mov r13, rbx
+  shl r13d, 2
+  mov edi, 4
+  mov eax, 0
+  call id
+  mov rcx, rax
+  imul ecx, ebx
+  cmp r13d, ecx
+  setne cl
+  movzx ecx, cl
+  add r12d, ecx
+  lea ecx, [rbx+rbx*2]
+  mov r13, rcx
+  shl r13d, 1
+  mov edi, 6
+  mov eax, 0
+  call id
+  mov rcx, rax
+  imul ecx, ebx
+  cmp r13d, ecx
+  setne cl
+  movzx ecx, cl
+  add r12d, ecx
+  mov rcx, rbx
+  shl ecx, 3
+  mov r13, rcx
+  sub r13d, ebx
+  mov edi, 7
+  mov eax, 0
+  call id
+  mov rcx, rax
+  imul ecx, ebx
+  cmp r13d, ecx
+  setne cl
+  movzx ecx, cl
+  add r12d, ecx
+  lea ecx, [rbx+rbx*4]
+  mov r13, rcx
+  shl r13d, 1
+  mov edi, 10
+  mov eax, 0
+  call id
+  mov rcx, rax
+  imul ecx, ebx
+  cmp r13d, ecx
+  setne cl
+  movzx ecx, cl
+  add r12d, ecx
+  lea ecx, [rbx+rbx*2]
+  mov r13, rcx
+  shl r13d, 2
+  mov edi, 12
+  mov eax, 0
+  call id
+  mov rcx, rax
+  imul ecx, ebx
+  cmp r13d, ecx
+  setne cl
+  movzx ecx, cl
+  add r12d, ecx
+  mov rcx, rbx
+  shl ecx, 4
+  lea r13d, [rcx+rbx]
+  mov edi, 17
+  mov eax, 0
+  call id
+  mov rcx, rax
+  imul ecx, ebx
+  cmp r13d, ecx
+  setne cl
+  movzx ecx, cl
+  add r12d, ecx
+  mov rcx, rbx
+  shl ecx, 5
+  mov r13, rcx
+  sub r13d, ebx
+  mov edi, 31
+  mov eax, 0
+  call id
+  mov rcx, rax
+  imul ecx, ebx
+  cmp r13d, ecx
+  setne cl
+  movzx ecx, cl
+  add r12d, ecx
+  lea ecx, [rbx+rbx*4]
+  mov r13, rcx
+  shl r13d, 3
+  mov edi, 40
+  mov eax, 0
+  call id
+  mov rcx, rax
+  imul ecx, ebx
+  cmp r13d, ecx
+  setne cl
+  movzx ecx, cl
+  add r12d, ecx
+  lea ecx, [rbx+rbx*8]
+  mov r13, rcx
+  shl r13d, 3
+  mov edi, 72
+  mov eax, 0
+  call id
+  mov rcx, rax
+  imul ecx, ebx
+  cmp r13d, ecx
+  setne cl
+  movzx ecx, cl
+  add r12d, ecx
+  mov r13, rbx
+  shl r13d, 10
+  mov edi, 1024
+  mov eax, 0
+  call id
+  mov rcx, rax
+  imul ecx, ebx
+  cmp r13d, ecx
+  setne cl
+  movzx ecx, cl
+  add r12d, ecx
+  mov r13, rbx
+  imul r13d, 11
+  mov edi, 11
+  mov eax, 0
+  call id
+  mov rcx, rax
+  imul ecx, ebx
+  cmp r13d, ecx
+  setne cl
+  movzx ecx, cl
+  add ecx, r12d
+  mov rax, rcx
+  mov rbx, -16[rbp]
+  mov r12, -24[rbp]
+  mov r13, -32[rbp]
+  leave
+  ret
+.globl branches
+branches:
+  push rbp
+  mov rbp, rsp
+  sub rsp, 32
+  mov -24[rbp], rbx
+.Lbranches_0:
+  mov esi, 0
+  mov ecx, 0
+.Lbranches_1:
+  cmp ecx, edi
+  jge .Lbranches_3
+.Lbranches_2:
+  mov r9, rsi
+  mov r8d, 0
+  jmp .Lbranches_4
+.Lbranches_3:
+  cmp esi, 0
+  jle .Lbranches_18
+  jmp .Lbranches_19
+.Lbranches_4:
+  cmp r8d, ecx
+  jg .Lbranches_6
+.Lbranches_5:
+  cmp ecx, r8d
+  je .Lbranches_7
+.Lbranches_22:
+  mov r10, r9
+  jmp .Lbranches_8
+.Lbranches_6:
+  lea ebx, 1[rcx]
+  mov rsi, r9
+  mov rcx, rbx
+  jmp .Lbranches_1
+.Lbranches_7:
+  lea ebx, 1000[r9]
+  mov r10, rbx
+.Lbranches_8:
+  cmp ecx, r8d
+  jne .Lbranches_9
+.Lbranches_23:
+  mov rbx, r10
+  jmp .Lbranches_10
+.Lbranches_9:
+  add r10d, 1
+  mov rbx, r10
+.Lbranches_10:
+  cmp r8d, 3
+  jge .Lbranches_12
+.Lbranches_11:
+  lea r10d, 2[rbx]
+  jmp .Lbranches_13
+.Lbranches_12:
+  sub ebx, 1
+  mov r10, rbx
+.Lbranches_13:
+  lea ebx, -1[rcx]
+  cmp ebx, r8d
+  jle .Lbranches_14
+.Lbranches_24:
+  mov rbx, r10
+  jmp .Lbranches_15
+.Lbranches_14:
+  add r10d, 3
+  mov rbx, r10
+.Lbranches_15:
+  cmp r8d, 5
+  jl .Lbranches_16
+.Lbranches_25:
+  mov r10, rbx
+  jmp .Lbranches_17
+.Lbranches_16:
+  add ebx, 4
+  mov r10, rbx
+.Lbranches_17:
+  lea ebx, 1[r8]
+  mov r9, r10
+  mov r8, rbx
+  jmp .Lbranches_4
+.Lbranches_18:
+  mov eax, 0
+  mov rbx, -24[rbp]
+  leave
+  ret
+.Lbranches_19:
+  mov rax, rsi
+  mov rbx, -24[rbp]
+  leave
+  ret
+  .bss
+garr:
+  .zero 52
+ng:
+  .zero 12
+xs:
+  .zero 8
+	.text
+  # 0 string literals deduplicated
+  .section .rodata.str1.1,"aMS",@progbits,1
+.LC100:
+  .string "branches(0)"
+.LC99:
+  .string "int branches(int n){...nested for and while, if (i == j), if (j < 3) else, j >= i - 1, 5 > j...} branches(10)"
+.LC98:
+  .string "int mulcheck(int x){...x * 7 != x * id(7)...} for negative and positive x"
+.LC97:
+  .string "int divcheck(int x){...x / 7 != x / id(7)...} for negative and positive x"
+.LC96:
+  .string "int halve(int x){ return x / 2; } halve(-7)"
+.LC95:
+  .string "int divseven(int x){ return x / 7; } divseven(-100)"
+.LC94:
+  .string "int mulsmall(int x){ return x * 3 + x * 5 + x * 9; } mulsmall(-7)"
+.LC93:
+  .string "int addrmodes(int k){...a[i] = i * 3; garr[i] = i * 5; c[i] = i * 9;...} addrmodes(3)"
+.LC92:
+  .string "int rotatemany(int count){...13 locals rotated around a call...} rotatemany(5)"
+.LC91:
+  .string "int maxthree(int a, int b, int c){if (a > b) m = a; else m = b; ...} maxthree(3, 9, 4)"
+.LC90:
+  .string "int strlennano(char *s){...s = s + 1;...} strlennano(hello)"
+.LC89:
+  .string "hello"
+.LC88:
+  .string "int charwrap(int n){ char c; ... c = c + 100; ...} charwrap(3)"
+.LC87:
+  .string "int swaploop(int a, int b, int n){...{ t = a; a = b; b = t; }...} swaploop(1, 2, 3)"
+.LC86:
+  .string "int sumto(int n){...for (i = 1; i <= n; i = i + 1) s = s + i;...} sumto(10)"
+.LC85:
+  .string "id(1)+(id(2)*(id(3)+(id(4)*(id(5)+(id(6)*(id(7)+(id(8)*(id(9)+(id(10)*(id(11)+(id(12)*(id(13)+id(14)))))))))))))"
+.LC84:
+  .string "int rot(int a, ..., int f){return weighted(f, e, d, c, b, a, a, f);} rot(1, 2, 3, 4, 5, 6)"
+.LC83:
+  .string "int a = 3; int b = 14; id(a + b / 3)"
+.LC82:
+  .string "int e = 5; int *p = &e; *p = 6; e"
+.LC81:
+  .string "int d = 1; d = d + 1; d"
+.LC80:
+  .string "char x[3]; x[2] = -129; x[2]"
+.LC79:
+  .string "char x[3]; x[2] = 257; x[2]"
+.LC78:
+  .string "char c = 200; c"
+.LC77:
+  .string "char c = 300; c"
+.LC76:
+  .string "int a = 3; int b = a * 4 + 2; b"
+.LC75:
+  .string "int x[2]; sizeof x * 2"
+.LC74:
+  .string "3 * -4"
+.LC73:
+  .string "-7 / -2"
+.LC72:
+  .string "7 / -2"
+.LC71:
+  .string "-7 / 2"
+.LC70:
+  .string "int weighted(int a, ..., int h){return a+2*b+...+8*h;} weighted(1, 2, 3, 4, 5, 6, 7, 8)"
+.LC69:
+  .string "int x = 1; { int x = 2; x = x + 1; } x"
+.LC68:
+  .string "int x[5] = {4, 5, 6}; x[4]"
+.LC67:
+  .string "int x[] = {4, 5, 6}; x[2]"
+.LC66:
+  .string "int x[2] = {4, 5}; x[1]"
+.LC65:
+  .string "int x = 10; x"
+.LC64:
+  .string "char *x; x = \"abc\"; x[1];"
+.LC63:
+  .string "char *x; x = \"abc\"; x[0];"
+.LC62:
+  .string "abc"
+.LC61:
+  .string "char x[3]; x[0] = -1; x[1] = 2; int y; y = 4; x[0] + y;"
+.LC60:
+  .string "int x[2]; int main(){ x[0] = 10; x[1] = 20; return x[0] + x[1];}"
+.LC59:
+  .string "sizeof 1"
+.LC58:
+  .string "int x; sizeof x;"
+.LC57:
+  .string "int *y; sizeof y;"
+.LC56:
+  .string "int x; sizeof (x+3)"
+.LC55:
+  .string "int *y; sizeof (y+3);"
+.LC54:
+  .string "int *y; sizeof *y;"
+.LC53:
+  .string "sizeof sizeof 1"
+.LC52:
+  .string "int a[1]; a[0] = 42; return a[0];"
+.LC51:
+  .string "int a[2]; a[0] = 1; a[1] = 2; a[1];"
+.LC50:
+  .string "int a[2]; *a = 1; *(a + 1) = 2; int *p; p = a; *p + *(p + 1);"
+.LC49:
+  .string "int x; int y; int *z; x = 3; y = 5; z = &y; *(z+1);"
+.LC48:
+  .string "int x; int y; int *z; x = 3; y = 5; z = &y+1; *z;"
+.LC47:
+  .string "int x; int *y; x = 3; y = &x; *y;"
+.LC46:
+  .string "int x; int *y; y = &x; *y = 3; x"
+.LC45:
+  .string "int x; x = 42; x;"
+.LC44:
+  .string "int id(int x){return x;} int main(){return id(42);}"
+.LC43:
+  .string "int id(int x){int y; return x;} int main(){return id(42);}"
+.LC42:
+  .string "int double(int x){return x*2;} int main(){return double(42);}"
+.LC41:
+  .string "int a[3]; *a = 42; *a;"
+.LC40:
+  .string "int a[2]; *a = 42; *(a + 1) = 43; *(a + 1);"
+.LC39:
+  .string "int a[2]; *a = 1; *(a + 1) = 2; *a + *(a + 1);"
+.LC38:
+  .string "int add(int x,int y){return x+y;} int main(){return add(10,20);}"
+.LC37:
+  .string "int fib(int n){if(n < 2) {return 1;} else {return (fib(n-1) + fib(n-2));}} int main(){return fib(9);}"
+.LC36:
+  .string "int fourtytwo(){return 42;} int main(){return fourtytwo();}"
+.LC35:
+  .string "int a; int b; a = 0; b = 0; while (a < 9) {a = a + 1; b = b + a;} return b;"
+.LC34:
+  .string "int b; b = 0; for (a = 0; a < 10; a = a + 1) b = b + a;"
+.LC33:
+  .string "int a = 1; while (a < 5) a = a + a;"
+.LC32:
+  .string "if (1 < 2) a = 3;"
+.LC31:
+  .string "if (2 < 1) a = 3; else a = 4;"
+.LC30:
+  .string "int a; if (2 < 1) a = 3; else a = 4;"
+.LC29:
+  .string "10 < 11"
+.LC28:
+  .string "10 < 10"
+.LC27:
+  .string "10 < 9"
+.LC26:
+  .string "45!=45"
+.LC25:
+  .string "45!=12"
+.LC24:
+  .string "123==12"
+.LC23:
+  .string "12==12"
+.LC22:
+  .string "-3*+5 + 20"
+.LC21:
+  .string "-(3+5)+10"
+.LC20:
+  .string "-3+5"
+.LC19:
+  .string "2*(3+(4*(5+6)))"
+.LC18:
+  .string "2*(3+4)"
+.LC17:
+  .string "1+2*3/4"
+.LC16:
+  .string "1*2+3"
+.LC15:
+  .string "1+2*3"
+.LC14:
+  .string "5+20-4"
+.LC13:
+  .string "5+20"
+.LC12:
+  .string "10 <= 11"
+.LC11:
+  .string "10 <= 10"
+.LC10:
+  .string "10 <= 9"
+.LC9:
+  .string "10 > 9"
+.LC8:
+  .string "10 > 10"
+.LC7:
+  .string "10 > 11"
+.LC6:
+  .string "10 >= 9"
+.LC5:
+  .string "10 >= 10"
+.LC4:
+  .string "10 >= 11"
+.LC3:
+  .string "5*6+1"
+.LC2:
+  .string "42"
+.LC1:
+  .string "%s => %d expected, but got %d\n"
+.LC0:
+  .string "%s => %d\n"
+  .text
@@ -0,0 +1,17 @@
+.intel_syntax noprefix
+.globl foo
+foo:
+  push rbp
+  mov rbp, rsp
+.Lfoo_0:
+  mov eax, 1
+  leave
+  ret
+.globl bar
+bar:
+  push rbp
+  mov rbp, rsp
+.Lbar_0:
+  mov eax, 2
+  leave
+  ret
@@ -1,25 +1,130 @@
 #include "nanocc.h"
+// 字句解析のスレッド
+#include <threads.h>
+
+// 文字の分類。tokenize はこの表を引いて次に何を読むかを決める
+enum {
+  CC_SPACE = 1, // 空白文字
+  CC_DIGIT = 2, // 数字
+  CC_LOWER = 4, // 識別子に使える文字 (a-z)
+  CC_ALNUM = 8, // 英数字と '_'。予約語の直後に来てはいけない文字
+};
+
+static const unsigned char char_class[256] = {
+  [' '] = CC_SPACE, ['\t'] = CC_SPACE, ['\n'] = CC_SPACE,
+  ['\v'] = CC_SPACE, ['\f'] = CC_SPACE, ['\r'] = CC_SPACE,
+  ['0' ... '9'] = CC_DIGIT | CC_ALNUM,
+  ['a' ... 'z'] = CC_LOWER | CC_ALNUM,
+  ['A' ... 'Z'] = CC_ALNUM,
+  ['_'] = CC_ALNUM,
+};
+
+// 1文字の記号の表。記号でない文字は PU_NONE
+static const unsigned char punct1[256] = {
+  ['+'] = PU_PLUS, ['-'] = PU_MINUS, ['*'] = PU_STAR, ['/'] = PU_SLASH,
+  ['('] = PU_LPAREN, [')'] = PU_RPAREN, ['{'] = PU_LBRACE, ['}'] = PU_RBRACE,
+  ['['] = PU_LBRACKET, [']'] = PU_RBRACKET, ['<'] = PU_LT, ['>'] = PU_GT,
+  ['='] = PU_ASSIGN, [';'] = PU_SEMI, [','] = PU_COMMA, ['&'] = PU_AMP,
+};
+
+// 後ろに '=' が続く2文字の記号の表。1文字目で引く
+static const unsigned char punct2[256] = {
+  ['='] = PU_EQ, ['!'] = PU_NEQ, ['<'] = PU_LTE, ['>'] = PU_GTE,
+};
+
+// エラー表示用の記号の文字列
+static char *punct_str[] = {
+  [PU_NONE] = "", [PU_PLUS] = "+", [PU_MINUS] = "-", [PU_STAR] = "*",
+  [PU_SLASH] = "/", [PU_LPAREN] = "(", [PU_RPAREN] = ")", [PU_LBRACE] = "{",
+  [PU_RBRACE] = "}", [PU_LBRACKET] = "[", [PU_RBRACKET] = "]", [PU_LT] = "<",
+  [PU_GT] = ">", [PU_LTE] = "<=", [PU_GTE] = ">=", [PU_EQ] = "==",
+  [PU_NEQ] = "!=", [PU_ASSIGN] = "=", [PU_SEMI] = ";", [PU_COMMA] = ",",
+  [PU_AMP] = "&",
+};
+
+// 予約語の表。keyword_hash の値で引く完全ハッシュになっている
+typedef struct {
+  char *name;
+  int len;
+  TokenKind kind;
+} Keyword;
+
+static const Keyword keywords[32] = {
+  [6] = {"return", 6, TK_RETURN},
+  [17] = {"if", 2, TK_IF},
+  [14] = {"else", 4, TK_ELSE},
+  [1] = {"while", 5, TK_WHILE},
+  [27] = {"for", 3, TK_FOR},
+  [0] = {"int", 3, TK_INT},
+  [25] = {"char", 4, TK_CHAR},
+  [31] = {"sizeof", 6, TK_SIZEOF},
+};
+
+// 予約語の完全ハッシュ。先頭の文字と末尾の文字と長さだけから求める。
+// 予約語どうしは衝突しないので、表を1回引いて比べれば予約語かどうかがわかる
+static int keyword_hash(char *str, int len) {
+  return ((unsigned char)str[0] + (unsigned char)str[len - 1] + len) & 31;
+}
+
+// str から len 文字が予約語ならそのトークンの種類を、そうでなければ TK_IDENT を返す
+static TokenKind keyword_kind(char *str, int len) {
+  const Keyword *kw = &keywords[keyword_hash(str, len)];
+  if (kw->len == len && memcmp(kw->name, str, len) == 0)
+    return kw->kind;
+  return TK_IDENT;
+}
+
+// 先読みしたトークンを入れておくリングバッファー
+// パーザーは現在のトークンしか見ないので、入力全体のトークンを持つ必要はない。
+// consume_ident などが返したトークンは、そのあと TOKEN_RING_SIZE - 1 個の
+// トークンを読み進めるまで有効
+// 関数の本体はスレッドごとに並行してパーズするので、ここから下の状態はスレッドごとに持つ
+#define TOKEN_RING_SIZE 16
+static _Thread_local Token token_ring[TOKEN_RING_SIZE];
+
+// これまでに作ったトークンの個数
+static _Thread_local int num_tokens;
+
+// 次のトークンを読み始める入力の位置
+static _Thread_local char *lex_pos;
+
+// 真なら、トークンは自分では作らず、字句解析のスレッドから受け取る
+static _Thread_local bool recv_tokens;
+
+static void lex_token();
+static void recv_token();
+
+// 現在着目しているトークンを返す。まだ作っていなければここで作る
+Token *cur_token() {
+  while (num_tokens <= token_pos) {
+    if (recv_tokens)
+      recv_token();
+    else
+      lex_token();
+  }
+  return &token_ring[token_pos & (TOKEN_RING_SIZE - 1)];
+}
+
+// トークンの文字列の開始位置を返す
+char *token_str(Token *tok) {
+  return user_input + tok->offset;
+}
 
 // 次のトークンが期待している記号のときには、トークンを1つ読み進めて
 // 真を返す。それ以外の場合には偽を返す。
-bool consume(char *op) {
-  // トークンの種類がそもそも記号でないか
-  if (token->kind != TK_RESERVED
-    // 記号列の長さがトークン文字列の長さと違うか
-    || strlen(op) != token->len
-    // 記号列がトークン文字列と違う
-    || memcmp(token->str, op, token->len))
-    // なら期待する記号ではない
+bool consume(PunctKind id) {
+  // 記号以外のトークンの id は PU_NONE なので、id の比較だけで済む
+  if (cur_token()->id != id)
     return false;
-  token = token->next;
+  token_pos++;
   return true;
 }
 
 // 次のトークンが期待している予約語のときには、トークンを1つ読み進めて
 // 真を返す。それ以外の場合には偽を返す。
 bool consume_reserved(int kind) {
-  if (token->kind == kind) {
-    token = token->next;
+  if (cur_token()->kind == kind) {
+    token_pos++;
     return true;
   }
   return false;
@@ -28,22 +133,20 @@ bool consume_reserved(int kind) {
 // 次のトークンが指定した予約語の場合、トークンを1つ読み進める。
 // それ以外の場合にはエラーを報告する。
 void expect_rword(int kind, char *rword) {
-  if (token->kind != kind) {
-    char msg[255];
-    strncpy(msg, token->str, token->len);
-    msg[token->len] = '\0';
-    error_at(token->str, "予約語 %s ではありません", rword);
-  }
-  token = token->next;
+  if (cur_token()->kind != kind)
+    error_at(token_str(cur_token()), "予約語 %s ではありません", rword);
+  token_pos++;
 }
 
-String *consume_string() {
-  // トークンの種類が文字列なら、指している文字列を返す
-  if (token->kind == TK_STRING) {
-    String *string = token->string;
+// 次のトークンが文字列リテラルのときには、トークンを1つ読み進めてから
+// そのトークンを返す。そうでない場合には NULL を返す。
+Token *consume_string() {
+  // トークンの種類が文字列なら、そのトークンを返す
+  Token *tok = cur_token();
+  if (tok->kind == TK_STRING) {
     // トークンを読み進める
-    token = token->next;
-    return string;
+    token_pos++;
+    return tok;
   }
   return NULL;
 }
@@ -52,10 +155,10 @@ String *consume_string() {
 // もとの識別子トークンを返す。そうでない場合には NULL を返す。
 Token *consume_ident() {
   // トークンの種類が識別子なら
-  if (token->kind == TK_IDENT) {
-    Token *ident_token = token;
-    token = token->next;
-    return ident_token;
+  Token *tok = cur_token();
+  if (tok->kind == TK_IDENT) {
+    token_pos++;
+    return tok;
   }
 
   return NULL;
@@ -64,11 +167,11 @@ Token *consume_ident() {
 // 次のトークンが識別子の場合、トークンを1つ読み進めてその数値を返す。
 // 識別子トークンを返す。それ以外の場合にはエラーを報告する。
 Token *expect_ident() {
-  if (token->kind != TK_IDENT)
-    error_at(token->str, "識別子ではありません");
-  Token *ident_token = token;
-  token = token->next;
-  return ident_token;
+  Token *tok = cur_token();
+  if (tok->kind != TK_IDENT)
+    error_at(token_str(tok), "識別子ではありません");
+  token_pos++;
+  return tok;
 }
 
 // 次のトークンが型名の場合、トークンを1つ読み進めて型の種類を返す
@@ -80,7 +183,7 @@ int expect_type() {
   } else if (consume_reserved(TK_CHAR)) {
     type_kind = CHAR;
   } else {
-    error_at(token->str, "int または char ではありません");
+    error_at(token_str(cur_token()), "int または char ではありません");
   }
   return type_kind;
 }
@@ -100,184 +203,260 @@ int consume_type() {
 
 // 次のトークンが期待している記号のときには、トークンを1つ読み進める。
 // それ以外の場合にはエラーを報告する。
-void expect(char *op) {
-  // トークンの種類がそもそも記号でないか
-  if (token->kind != TK_RESERVED
-    // 記号列の長さがトークン文字列の長さと違うか
-    || strlen(op) != token->len
-    // 記号列がトークン文字列と違う
-    || memcmp(token->str, op, token->len))
-    // なら期待する記号ではない
-    error_at(token->str, "'%s'ではありません", *op);
-  token = token->next;
+void expect(PunctKind id) {
+  if (cur_token()->id != id)
+    error_at(token_str(cur_token()), "'%s'ではありません", punct_str[id]);
+  token_pos++;
 }
 
 // 次のトークンが数値の場合、トークンを1つ読み進めてその数値を返す。
 // それ以外の場合にはエラーを報告する。
 int expect_number() {
-  if (token->kind != TK_NUM)
-    error_at(token->str, "数ではありません");
-  int val = token->val;
-  token = token->next;
-  return val;
+  Token *tok = cur_token();
+  if (tok->kind != TK_NUM)
+    error_at(token_str(tok), "数ではありません");
+  token_pos++;
+  return tok->val;
 }
 
 bool at_eof() {
-  return token->kind == TK_EOF;
+  return cur_token()->kind == TK_EOF;
 }
 
-bool starts_with(char *p, char *q) {
-  return memcmp(p, q, strlen(q)) == 0;
-}
+// 中身の atom で引く文字列リテラルの表
+// 同じ中身のリテラルは同じ String を共有して、ラベルも1つだけにする
+static String **strings_by_atom;
+static int cap_strings_by_atom;
 
-int is_alnum(char c) {
-  return ('a' <= c && c <= 'z') ||
-         ('A' <= c && c <= 'Z') ||
-         ('0' <= c && c <= '9') ||
-         (c == '_');
-}
+// 中身が atom の文字列リテラルを返す。初めて見る中身なら
+// 新しく作成して string_list につなげる
+String *intern_string(int atom) {
+  if (atom >= cap_strings_by_atom) {
+    int cap = cap_strings_by_atom ? cap_strings_by_atom : 1024;
+    while (cap <= atom)
+      cap *= 2;
+    strings_by_atom = realloc(strings_by_atom, sizeof(String *) * cap);
+    memset(strings_by_atom + cap_strings_by_atom, 0,
+           sizeof(String *) * (cap - cap_strings_by_atom));
+    cap_strings_by_atom = cap;
+  }
+  if (strings_by_atom[atom]) {
+    // 同じ中身のリテラルがすでにある
+    string_dedup_count++;
+    return strings_by_atom[atom];
+  }
 
-// 新しい文字列リテラルを作成して string_list につなげる
-void append_string(char *str, int len) {
-  String *s = calloc(1, sizeof(String));
-  char *string = calloc(len+1, sizeof(char));
-  strncpy(string, str, len+1);
-  string[len+1] = '\0';
-  s->str = string;
+  String *s = arena_alloc(&tu_arena, sizeof(String));
+  // 中身の文字列は atom の表にあるものをそのまま使う
+  s->str = atom_name(atom);
   s->index = string_index;
   string_index++;
   if (string_list) {
     s->next = string_list;
   }
   string_list = s;
+  strings_by_atom[atom] = s;
+  return s;
 }
 
-// 新しいトークンを作成してcurに繋げる
-Token *new_token(TokenKind kind, Token *cur, char *str, int len) {
-  Token *tok = calloc(1, sizeof(Token));
+// 新しいトークンを作成してリングバッファーの末尾に追加する
+Token *new_token(TokenKind kind, char *str, int len) {
+  Token *tok = &token_ring[num_tokens++ & (TOKEN_RING_SIZE - 1)];
   tok->kind = kind;
-  tok->str = str;
+  tok->id = PU_NONE;
+  tok->offset = str - user_input;
   tok->len = len;
-  cur->next = tok;
+  tok->val = 0;
   return tok;
 }
 
-// 想定するキーワードの場合は新しいトークンを作成してリストの末尾につなげ、真を返す
-// そうでない場合は偽を返す
-bool new_token_if_keyword(char *str, TokenKind kind, Token **cur, char **p) {
-  int len = strlen(str);
-  if (strncmp(*p, str, len) == 0 && !is_alnum((*p)[len])) {
-    *cur = new_token(kind, *cur, *p, len);
-    *p += len;
-    return true;
+// 入力文字列pをトークナイズする準備をする
+// トークンはパーザーが読み進めるのに合わせて、lex_token で1つずつ作る
+void tokenize(char *p) {
+  lex_pos = p;
+  num_tokens = 0;
+  token_pos = 0;
+}
+
+// パイプラインでは、字句解析を別のスレッドで動かして、作ったトークンを
+// 塊にまとめてパーザーのスレッドに渡す。塊は決まった数だけ用意しておき、
+// パーザーが読み終わった塊は字句解析のスレッドに返して使い回す
+#define TOKEN_BATCH_SIZE 4096
+#define NUM_TOKEN_BATCHES 8
+
+// トークンの塊
+typedef struct {
+  int len;
+  Token tokens[TOKEN_BATCH_SIZE];
+} TokenBatch;
+
+// トークンを詰めた塊と、空の塊の待ち行列
+static Queue *full_batches;
+static Queue *free_batches;
+
+// パーザーのスレッドが読んでいる塊と、その中で次に読む位置
+static TokenBatch *cur_batch;
+static int batch_pos;
+
+// 字句解析のスレッド
+static thrd_t lexer_thread;
+
+// 字句解析のスレッドで、入力の終わりまでトークンを作って塊で渡す
+static int lexer_main(void *arg) {
+  tokenize(arg);
+  for (;;) {
+    TokenBatch *batch = queue_pop(free_batches);
+    batch->len = 0;
+    while (batch->len < TOKEN_BATCH_SIZE) {
+      lex_token();
+      Token *tok = &token_ring[(num_tokens - 1) & (TOKEN_RING_SIZE - 1)];
+      batch->tokens[batch->len++] = *tok;
+      if (tok->kind == TK_EOF) {
+        queue_push(full_batches, batch);
+        return 0;
+      }
+    }
+    queue_push(full_batches, batch);
   }
-  return false;
 }
 
-// 入力文字列pをトークナイズしてそれを返す
-Token *tokenize(char *p) {
-  Token head;
-  head.next = NULL;
-  Token *cur = &head;
-  string_index = 0;
+// 字句解析のスレッドから受け取ったトークンを1つ、リングバッファーの末尾に追加する
+static void recv_token() {
+  Token *last = &token_ring[(num_tokens - 1) & (TOKEN_RING_SIZE - 1)];
+  // TK_EOF の後にはもう塊は来ないので、TK_EOF を繰り返す
+  if (num_tokens > 0 && last->kind == TK_EOF) {
+    token_ring[num_tokens++ & (TOKEN_RING_SIZE - 1)] = *last;
+    return;
+  }
+  if (!cur_batch || batch_pos == cur_batch->len) {
+    if (cur_batch)
+      queue_push(free_batches, cur_batch);
+    cur_batch = queue_pop(full_batches);
+    batch_pos = 0;
+  }
+  token_ring[num_tokens++ & (TOKEN_RING_SIZE - 1)] = cur_batch->tokens[batch_pos++];
+}
+
+// 入力文字列 p を別のスレッドでトークナイズし始める
+// このスレッドの cur_token は、そのスレッドが作ったトークンを順に返すようになる
+void start_lexer(char *p) {
+  full_batches = new_queue(NUM_TOKEN_BATCHES);
+  free_batches = new_queue(NUM_TOKEN_BATCHES);
+  for (int i = 0; i < NUM_TOKEN_BATCHES; i++)
+    queue_push(free_batches, malloc(sizeof(TokenBatch)));
+  tokenize(p);
+  recv_tokens = true;
+  if (thrd_create(&lexer_thread, lexer_main, p) != thrd_success)
+    error("スレッドを作れません");
+}
+
+// 字句解析のスレッドが終わるのを待つ
+void finish_lexer() {
+  thrd_join(lexer_thread, NULL);
+  recv_tokens = false;
+}
+
+// 入力をトークンを1つ作るところまで読み進める
+static void lex_token() {
+  char *p = lex_pos;
+  Token *tok;
 
   while (*p) {
+    // 文字の分類を表から引く
+    unsigned char c = *p;
+    int cls = char_class[c];
+
     // 空白文字をスキップ
-    if (isspace(*p)) {
-      p++;
+    if (cls & CC_SPACE) {
+      p = scan(p + 1, SCAN_SPACE);
       continue;
     }
     // 行コメントをスキップ
-    if (strncmp(p, "//", 2) == 0) {
-      p += 2;
-      while (*p != '\n')
-        p++;
+    if (c == '/' && p[1] == '/') {
+      p = scan(p + 2, SCAN_LINE);
       continue;
     }
     // ブロックコメントをスキップ
-    if (strncmp(p, "/*", 2) == 0) {
-      char *q = strstr(p + 2, "*/");
-      if (!q)
+    if (c == '/' && p[1] == '*') {
+      // '*' が見つかるたびに、次が '/' かどうかを確かめる
+      char *q = scan(p + 2, SCAN_COMMENT);
+      while (*q == '*' && q[1] != '/')
+        q = scan(q + 1, SCAN_COMMENT);
+      if (!*q)
         error_at(p, "コメントが閉じられていません");
       p = q + 2;
       continue;
     }
     // 2文字の記号
-    if (starts_with(p, "==") || starts_with(p, "!=")
-      || starts_with(p, "<=") || starts_with(p, ">=")
-    ) {
-      cur = new_token(TK_RESERVED, cur, p, 2);
-      p += 2;
-      continue;
+    if (p[1] == '=' && punct2[c]) {
+      tok = new_token(TK_RESERVED, p, 2);
+      tok->id = punct2[c];
+      lex_pos = p + 2;
+      return;
     }
     // 1文字の記号
-    if (strchr("+-*/(){}<>=;,&[]", *p)) {
-      cur = new_token(TK_RESERVED, cur, p++, 1);
-      continue;
+    if (punct1[c]) {
+      tok = new_token(TK_RESERVED, p, 1);
+      tok->id = punct1[c];
+      lex_pos = p + 1;
+      return;
     }
     // '"' が来た場合は次の '"" まで読む
     if (*p == '"') {
       p++;
       char *p0 = p;
-      while (*p != '"') {
-        // \" が来たら読み飛ばす
+      for (;;) {
+        // '"' か '\\' か入力の終わりまで読み飛ばす
+        p = scan(p, SCAN_STRING);
+        if (*p == '"')
+          break;
+        if (!*p)
+          error_at(p0 - 1, "文字列が閉じられていません");
+        // \" のようなエスケープは2文字まとめて読み飛ばす
         // つまり \" という2文字が残ったままとなる
         // 本来は " の1文字だけにして、アセンブリ出力の際に再度エスケープするべき
-        if (strncmp(p, "\\\"", 2) == 0) {
-          p += 2;
-        }
-        p++;
+        p += p[1] ? 2 : 1;
       }
-      int len = p - p0 -1;
-      cur = new_token(TK_STRING, cur, p0, len);
-      cur->len = len;
-      append_string(p0, len);
-      cur->string = string_list;
-      p++;
-      continue;
+      // 中身はここで atom にしておき、同じ中身のリテラルを見分けられるようにする
+      // 文字列リテラルそのものはパーズするときに作る
+      tok = new_token(TK_STRING, p0, p - p0);
+      tok->val = intern(p0, p - p0);
+      lex_pos = p + 1;
+      return;
     }
-    if (new_token_if_keyword("return", TK_RETURN, &cur, &p)) continue;
-    // if だったらそれを返す
-    if (new_token_if_keyword("if", TK_IF, &cur, &p)) continue;
-    // else だったらそれを返す
-    if (new_token_if_keyword("else", TK_ELSE, &cur, &p)) continue;
-    // while 
-    if (new_token_if_keyword("while", TK_WHILE, &cur, &p)) continue;
-    // for
-    if (new_token_if_keyword("for", TK_FOR, &cur, &p)) continue;
-    // int
-    if (new_token_if_keyword("int", TK_INT, &cur, &p)) continue;
-    // char
-    if (new_token_if_keyword("char", TK_CHAR, &cur, &p)) continue;
-    // sizeof
-    if (new_token_if_keyword("sizeof", TK_SIZEOF, &cur, &p)) continue;
-    // 1文字のアルファベットを見つけたら
-    if ('a' <= *p && *p <= 'z') {
+    // 1文字のアルファベットを見つけたら識別子か予約語
+    if (cls & CC_LOWER) {
       // 開始位置を覚えておいて
       char *p0 = p;
-      p++;
       // アルファベットが続く限り読み進める
-      while ('a' <= *p && *p <= 'z') {
-        p++;
-      }
-      // p0 から p - p0 文字の長さの名前の識別子トークンとして追加する
-      cur = new_token(TK_IDENT, cur, p0, p - p0);
-      cur->len = p - p0;
-      continue;
+      p = scan(p + 1, SCAN_LOWER);
+      int len = p - p0;
+      // 予約語は直後に英数字が続かないときだけ予約語とみなす
+      TokenKind kind = TK_IDENT;
+      if (!(char_class[(unsigned char)*p] & CC_ALNUM))
+        kind = keyword_kind(p0, len);
+      tok = new_token(kind, p0, len);
+      // 識別子は名前を atom にしておく
+      if (kind == TK_IDENT)
+        tok->val = intern(p0, len);
+      lex_pos = p;
+      return;
     }
 
-    if (isdigit(*p)) {
-      cur = new_token(TK_NUM, cur, p, 0);
+    if (cls & CC_DIGIT) {
+      tok = new_token(TK_NUM, p, 0);
       char *q = p;
-      cur->val = strtol(p, &p, 10);
+      tok->val = strtol(p, &p, 10);
       // ポインタが進んだ分が桁数
-      cur->len = p - q;
-      continue;
+      tok->len = p - q;
+      lex_pos = p;
+      return;
     }
 
     error_at(p, "トークナイズできません");
   }
 
-  new_token(TK_EOF, cur, p, 0);
-  return head.next;
+  // 入力の終わり。何度呼ばれても TK_EOF を返す
+  new_token(TK_EOF, p, 0);
+  lex_pos = p;
 }
\ No newline at end of file
@@ -1,43 +1,105 @@
 #include "nanocc.h"
+// 型の表を複数のスレッドから使うための排他制御
+#include <threads.h>
 
-// 新しい型の部品を作成する
-Type *new_type(int kind) {
-  // 新しい型をつくる
-  Type *type = calloc(1, sizeof(Type));
-  type->kind = kind;
-  type->ptr_to = NULL;
-  return type;
+// 型は形ごとに1つだけ作って使い回す。同じ形の型は同じポインターになるので、
+// 型が等しいかどうかはポインターの比較で済む。
+// 関数のアリーナを解放した後も使えるように、型はすべて翻訳単位のアリーナに置く。
+// 関数の本体は並行してパーズするので、表と翻訳単位のアリーナはロックしてから使う
+
+// int と char の型
+static Type int_type = {INT, NULL, 0, 4};
+static Type char_type = {CHAR, NULL, 0, 1};
+
+// ポインター型と配列型を (種類, 指す型, 要素数) から引くためのオープンアドレス法のハッシュ表
+static Type **type_table;
+static int type_cap;
+static int type_used;
+static mtx_t type_lock;
+static once_flag type_lock_once = ONCE_FLAG_INIT;
+
+static void init_type_lock() {
+  mtx_init(&type_lock, mtx_plain);
 }
 
-// 新しい型の部品を作成してリスト末尾に繋げる
-Type *append_type(int kind, Type **head, Type **tail) {
-  // 新しい型をつくる
-  Type *type = calloc(1, sizeof(Type));
-  type->kind = kind;
-  // リストが空でないなら末尾に繋げる
-  if (*tail) {
-    (*tail)->ptr_to = type;
-    *tail = type;
-  } else {
-    // リストが空なら head と tail が新しい型を指すようにする
-    *head = type;
-    *tail = type;
+// (種類, 指す型, 要素数) のハッシュ値
+static uint32_t type_hash(int kind, Type *ptr_to, size_t array_size) {
+  uint64_t h = (uintptr_t)ptr_to * 0x9e3779b97f4a7c15ull;
+  h ^= array_size * 0xff51afd7ed558ccdull + kind;
+  return h ^ (h >> 32);
+}
+
+// ハッシュ表を倍の大きさにして作り直す
+static void grow_type_table() {
+  Type **old = type_table;
+  int old_cap = type_cap;
+  type_cap = old_cap ? old_cap * 2 : 256;
+  type_table = calloc(type_cap, sizeof(Type *));
+  for (int i = 0; i < old_cap; i++) {
+    Type *type = old[i];
+    if (!type)
+      continue;
+    int j = type_hash(type->kind, type->ptr_to, type->array_size) & (type_cap - 1);
+    while (type_table[j])
+      j = (j + 1) & (type_cap - 1);
+    type_table[j] = type;
   }
-  return type;
+  free(old);
 }
 
-int type_size (Type *type) {
-  switch (type->kind) {
-    case CHAR:
-      return 1;    
-    case INT:
-      return 4;
-    case PTR:
-      return 8;
-    case ARRAY:
-      return type_size(type->ptr_to) * type->array_size;
+// (種類, 指す型, 要素数) の型を返す。まだなければ作る
+static Type *intern_type(int kind, Type *ptr_to, size_t array_size) {
+  call_once(&type_lock_once, init_type_lock);
+  mtx_lock(&type_lock);
+  // 表の半分が埋まったら広げる
+  if (type_used * 2 >= type_cap)
+    grow_type_table();
+
+  int i = type_hash(kind, ptr_to, array_size) & (type_cap - 1);
+  while (type_table[i]) {
+    Type *type = type_table[i];
+    if (type->kind == kind && type->ptr_to == ptr_to &&
+        type->array_size == array_size) {
+      mtx_unlock(&type_lock);
+      return type;
+    }
+    i = (i + 1) & (type_cap - 1);
   }
-  error("unreachable: type_size");
+
+  Type *type = arena_alloc(&tu_arena, sizeof(Type));
+  type->kind = kind;
+  type->ptr_to = ptr_to;
+  type->array_size = array_size;
+  // 値のサイズは作るときに計算しておく
+  type->size = kind == PTR ? 8 : ptr_to->size * array_size;
+  type_table[i] = type;
+  type_used++;
+  mtx_unlock(&type_lock);
+  return type;
+}
+
+// int または char の型を返す
+Type *basic_type(int kind) {
+  if (kind == INT)
+    return &int_type;
+  if (kind == CHAR)
+    return &char_type;
+  error("unreachable: basic_type");
+}
+
+// base へのポインター型を返す
+Type *pointer_to(Type *base) {
+  return intern_type(PTR, base, 0);
+}
+
+// 要素の型が base で要素数が len の配列型を返す
+Type *array_of(Type *base, size_t len) {
+  return intern_type(ARRAY, base, len);
+}
+
+// その型の値を持つのに必要なサイズ
+int type_size(Type *type) {
+  return type->size;
 }
 
 char *type_name(Type *type) {
@@ -50,4 +112,4 @@ char *type_name(Type *type) {
   } else if (type->kind == ARRAY) {
     return "array of";
   }
-}
\ No newline at end of file
+}
@@ -1,37 +1,57 @@
 #include "nanocc.h"
 
+// ローカル変数、グローバル変数、関数の名前の記号表
+// 関数の本体はスレッドごとに並行してパーズするので、ローカル変数の表はスレッドごとに持つ。
+// グローバル変数と関数の表は、本体をパーズする前にできあがっていて、書き換えない
+static _Thread_local SymTable local_syms;
+static SymTable global_syms;
+static SymTable func_syms;
+
+// これまでに宣言したグローバル変数の個数
+static int num_globals;
+
 // 変数を名前で検索する。見つからなかった場合はNULLを返す。
 LVar *find_lvar(Token *tok) {
-  // 変数名のリストを先頭から順に見ていって
-  for (LVar *var = cur_func->locals; var; var = var->next)
-    // 既存のものと長さが一緒で文字列が一緒ならそれを返す
-    if (var->len == tok->len && !memcmp(tok->str, var->name, var->len))
-      return var;
-  // 見つからなければNULLを返す
-  return NULL;
+  return find_sym(&local_syms, tok->val);
 }
 
 // グローバル変数を名前で検索する。見つからなかった場合はNULLを返す。
 LVar *find_global_var(Token *tok) {
-  // 変数名のリストを先頭から順に見ていって
-  for (LVar *var = global_var_list; var; var = var->next)
-    // 既存のものと長さが一緒で文字列が一緒ならそれを返す
-    if (var->len == tok->len && !memcmp(tok->str, var->name, var->len))
-      return var;
-  // 見つからなければNULLを返す
-  return NULL;
+  LVar *lvar = find_sym(&global_syms, tok->val);
+  // 関数の本体からは、その関数より前に宣言されたグローバル変数しか見えない
+  if (lvar && (!cur_func->globals || lvar->index > cur_func->globals->index))
+    return NULL;
+  return lvar;
+}
+
+// 関数定義を名前で検索する。見つからなかった場合はNULLを返す。
+Node *find_func(int name) {
+  return find_sym(&func_syms, name);
+}
+
+// 関数定義を登録する
+void register_func(Node *node) {
+  add_sym(&func_syms, node->func->name, node);
+}
+
+// ブロックに入る。ここから後に登録したローカル変数は、
+// 対応する leave_block を呼ぶと見えなくなる
+void enter_block() {
+  enter_scope(&local_syms);
+}
+
+// ブロックを出る
+void leave_block() {
+  leave_scope(&local_syms);
 }
 
 // 変数名をリストに追加する
-void register_var(char *str, int len, Type *type) {
-  LVar *lvar = calloc(1, sizeof(LVar));
+void register_var(int name, Type *type) {
+  LVar *lvar = arena_alloc(cur_arena, sizeof(LVar));
   // 新しい要素を先頭につなぐ
   lvar->next = cur_func->locals;
-  // 変数名はトークンが持つ値をそのまま使う
-  strncpy(lvar->name, str, len);
-  lvar->name[len] = '\0';
-  // 変数名の長さも同じ
-  lvar->len = len;
+  // 変数名の atom
+  lvar->name = name;
   // 変数名のスタックベースからのオフセットは、
   // 最後に追加された変数のオフセット + 値のサイズにする
   // 値のサイズは、INT なら 4, PTR なら 8
@@ -45,20 +65,30 @@ void register_var(char *str, int len, Type *type) {
   }
   // 変数の型
   lvar->type = type;
+  // 関数の中で何番目の変数か
+  lvar->index = cur_func->locals ? cur_func->locals->index + 1 : 0;
   // 変数リストの先頭アドレスをいま追加したものとする
   cur_func->locals = lvar;
+  // 名前で引けるようにする
+  add_sym(&local_syms, name, lvar);
+}
+
+// 最後に登録したローカル変数の型を type に差し替える
+// int x[] = {...} のように、初期化式を読むまで大きさがわからない配列に使う
+void retype_last_var(Type *type) {
+  LVar *lvar = cur_func->locals;
+  // 大きさが変わったぶんだけオフセットもずらす
+  lvar->offset += type_size(type) - type_size(lvar->type);
+  lvar->type = type;
 }
 
 // 変数名をグローバル変数のリストに追加する
-void register_global_var(char *str, int len, Type *type) {
-  LVar *lvar = calloc(1, sizeof(LVar));
+void register_global_var(int name, Type *type) {
+  LVar *lvar = arena_alloc(&tu_arena, sizeof(LVar));
   // 新しい要素を先頭につなぐ
   lvar->next = global_var_list;
-  // 変数名はトークンが持つ値をそのまま使う
-  strncpy(lvar->name, str, len);
-  lvar->name[len] = '\0';
-  // 変数名の長さも同じ
-  lvar->len = len;
+  // 変数名の atom
+  lvar->name = name;
   // 変数名のオフセットは、
   // 最後に追加された変数のオフセット + 値のサイズにする
   // 値のサイズは、INT なら 4, PTR なら 8
@@ -72,6 +102,10 @@ void register_global_var(char *str, int len, Type *type) {
   }
   // 変数の型
   lvar->type = type;
+  // 宣言された順番
+  lvar->index = num_globals++;
   // 変数リストの先頭アドレスをいま追加したものとする
   global_var_list = lvar;
+  // 名前で引けるようにする
+  add_sym(&global_syms, name, lvar);
 }
\ No newline at end of file